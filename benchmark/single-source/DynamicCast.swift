@@ -0,0 +1,91 @@
+//===--- DynamicCast.swift ------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This benchmark repeatedly casts values stored as Any to protocol types,
+// which goes through swift_dynamicCast with the same source and target types
+// over and over. Some of the casts succeed and some fail.
+
+import TestsUtils
+
+protocol Shape {
+  var area: Int { get }
+}
+
+protocol Named {
+  var name: String { get }
+}
+
+struct Square : Shape, Named {
+  var side: Int
+  var area: Int { return side * side }
+  var name: String { return "square" }
+}
+
+struct Rectangle : Shape {
+  var width: Int
+  var height: Int
+  var area: Int { return width * height }
+}
+
+struct Label : Named {
+  var name: String
+}
+
+final class Circle : Shape {
+  var radius: Int
+  init(radius: Int) { self.radius = radius }
+  var area: Int { return 3 * radius * radius }
+}
+
+@inline(never)
+func makeValues() -> [Any] {
+  var values: [Any] = []
+  for i in 0..<100 {
+    switch i % 5 {
+    case 0: values.append(Square(side: 2))
+    case 1: values.append(Rectangle(width: 2, height: 3))
+    case 2: values.append(Label(name: "label"))
+    case 3: values.append(Circle(radius: 1))
+    default: values.append(i)
+    }
+  }
+  return values
+}
+
+@inline(never)
+func sumAreas(_ values: [Any]) -> Int {
+  var total = 0
+  for value in values {
+    if let shape = value as? Shape {
+      total += shape.area
+    }
+    if let named = value as? Named {
+      total += named.name.isEmpty ? 0 : 1
+    }
+  }
+  return total
+}
+
+@inline(never)
+public func run_DynamicCast(_ N: Int) {
+  let values = makeValues()
+  var total = 0
+  for _ in 0..<N {
+    for _ in 0..<100 {
+      total = sumAreas(values)
+    }
+  }
+  // 20 each of squares (4 + named), rectangles (6), labels (named) and
+  // circles (3).
+  CheckResults(total == 20 * (4 + 1) + 20 * 6 + 20 * 1 + 20 * 3,
+               "Incorrect results in DynamicCast")
+}
@@ -0,0 +1,48 @@
+//===--- FloatingPointPrinting.swift --------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This benchmark converts Float and Double values to strings with both
+// description and debugDescription, which go through swift_float32ToString
+// and swift_float64ToString.
+
+import TestsUtils
+
+@inline(never)
+func makeDoubles() -> [Double] {
+  var values: [Double] = []
+  var x = 1.0
+  for i in 0..<100 {
+    x = x * 1.7 + 0.1
+    values.append(i % 2 == 0 ? x : 1 / x)
+  }
+  return values
+}
+
+@inline(never)
+public func run_FloatingPointPrinting(_ N: Int) {
+  let doubles = makeDoubles()
+  let floats = doubles.map { Float($0) }
+  var count = 0
+  for _ in 0..<N {
+    for _ in 0..<10 {
+      for x in doubles {
+        count += x.description.utf8.count
+        count += x.debugDescription.utf8.count
+      }
+      for x in floats {
+        count += x.description.utf8.count
+        count += x.debugDescription.utf8.count
+      }
+    }
+  }
+  CheckResults(count > 0, "Incorrect results in FloatingPointPrinting")
+}
@@ -0,0 +1,82 @@
+//===--- GenericMetadataLookup.swift --------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the cost of looking up generic metadata which is already
+// instantiated. All variants do the same number of lookups, in runtime
+// metadata caches of different sizes. The time per lookup should not grow
+// with the number of instantiations.
+import TestsUtils
+
+protocol MetadataChain {
+  static func next() -> MetadataChain.Type
+}
+
+struct Leaf : MetadataChain {
+  static func next() -> MetadataChain.Type {
+    return Box<Leaf>.self
+  }
+}
+
+struct Box<T : MetadataChain> : MetadataChain {
+  // Unspecialized, so that this asks the runtime for the metadata.
+  @inline(never)
+  static func next() -> MetadataChain.Type {
+    return Box<Box<T>>.self
+  }
+}
+
+/// Instantiates Leaf, Box<Leaf>, Box<Box<Leaf>>, and so on.
+func makeChain(_ count: Int) -> [MetadataChain.Type] {
+  var chain: [MetadataChain.Type] = [Leaf.self]
+  for _ in 1..<count {
+    chain.append(chain[chain.count - 1].next())
+  }
+  return chain
+}
+
+let chain1k = makeChain(1 << 10)
+let chain4k = makeChain(1 << 12)
+let chain16k = makeChain(1 << 14)
+
+@inline(never)
+func lookUpChain(_ chain: [MetadataChain.Type], _ N: Int) {
+  let lookups = 1 << 16
+  var found = 0
+  for _ in 1...N {
+    // Stride through the chain, so that consecutive lookups hit different
+    // entries of the cache.
+    var i = 0
+    for _ in 0..<lookups {
+      i = (i + 7919) % (chain.count - 1)
+      if ObjectIdentifier(chain[i].next()) == ObjectIdentifier(chain[i + 1]) {
+        found += 1
+      }
+    }
+  }
+  CheckResults(found == N * lookups,
+               "Incorrect results in GenericMetadataLookup: \(found)")
+}
+
+@inline(never)
+public func run_GenericMetadataLookup1k(_ N: Int) {
+  lookUpChain(chain1k, N)
+}
+
+@inline(never)
+public func run_GenericMetadataLookup4k(_ N: Int) {
+  lookUpChain(chain4k, N)
+}
+
+@inline(never)
+public func run_GenericMetadataLookup16k(_ N: Int) {
+  lookUpChain(chain16k, N)
+}
@@ -0,0 +1,65 @@
+//===--- TupleFunctionMetadata.swift --------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This benchmark measures the per-call cost of looking up tuple and function
+// type metadata from unspecialized generic code, where every use of a type
+// like (T, U) or (T) -> U asks the runtime for its metadata.
+//
+// The generic types are reached through existentials so that the optimizer
+// cannot specialize them away.
+
+import TestsUtils
+
+protocol TypeMaker {
+  func makeTypes() -> Int
+}
+
+struct Maker2<T, U> : TypeMaker {
+  @inline(never)
+  func makeTypes() -> Int {
+    let types: [Any.Type] = [
+      (T, U).self,
+      (T, U, T).self,
+      (T, U, T, U).self,
+      ((T) -> U).self,
+      ((T, U) -> T).self,
+      ((T, U, T) -> U).self,
+      ((T, U, T, U) -> T).self,
+    ]
+    return types.count
+  }
+}
+
+@inline(never)
+func makeTypeMakers() -> [TypeMaker] {
+  return [
+    Maker2<Int, String>(),
+    Maker2<String, Int>(),
+    Maker2<Double, [Int]>(),
+    Maker2<[String], Float>(),
+  ]
+}
+
+@inline(never)
+public func run_TupleFunctionMetadata(_ N: Int) {
+  let makers = makeTypeMakers()
+  var count = 0
+  for _ in 0..<N {
+    for _ in 0..<1_000 {
+      for maker in makers {
+        count += maker.makeTypes()
+      }
+    }
+  }
+  CheckResults(count == N * 1_000 * 4 * 7,
+               "Incorrect results in TupleFunctionMetadata")
+}
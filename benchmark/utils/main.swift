@@ -45,8 +45,11 @@ import DictionaryBridge
 import DictionaryLiteral
 import DictionaryRemove
 import DictionarySwap
+import DynamicCast
 import ErrorHandling
 import Fibonacci
+import FloatingPointPrinting
+import GenericMetadataLookup
 import GlobalClass
 import Hanoi
 import Hash
@@ -92,6 +95,7 @@ import StringInterpolation
 import StringTests
 import StringWalk
 import SuperChars
+import TupleFunctionMetadata
 import TwoSum
 import TypeFlood
 import UTF8Decode
@@ -133,7 +137,12 @@ precommitTests = [
   "DictionaryRemoveOfObjects": run_DictionaryRemoveOfObjects,
   "DictionarySwap": run_DictionarySwap,
   "DictionarySwapOfObjects": run_DictionarySwapOfObjects,
+  "DynamicCast": run_DynamicCast,
   "ErrorHandling": run_ErrorHandling,
+  "FloatingPointPrinting": run_FloatingPointPrinting,
+  "GenericMetadataLookup16k": run_GenericMetadataLookup16k,
+  "GenericMetadataLookup1k": run_GenericMetadataLookup1k,
+  "GenericMetadataLookup4k": run_GenericMetadataLookup4k,
   "GlobalClass": run_GlobalClass,
   "Hanoi": run_Hanoi,
   "HashTest": run_HashTest,
@@ -208,6 +217,7 @@ precommitTests = [
   "StringWalk": run_StringWalk,
   "StringWithCString": run_StringWithCString,
   "SuperChars": run_SuperChars,
+  "TupleFunctionMetadata": run_TupleFunctionMetadata,
   "TwoSum": run_TwoSum,
   "TypeFlood": run_TypeFlood,
   "UTF8Decode": run_UTF8Decode,
@@ -101,6 +101,14 @@ public:
   /// Emit a mapping of profile counters for use in coverage.
   bool EmitProfileCoverageMapping = false;
 
+  /// Make the specializations of this module's generic functions public and
+  /// serialize their declarations, so that importing modules can call them.
+  bool ExportSpecializations = false;
+
+  /// The path to an indexed profile (.profdata) whose execution counts should
+  /// guide optimization, or empty if there is none.
+  std::string UseProfile;
+
   /// Should we use a pass pipeline passed in via a json file? Null by default.
   llvm::StringRef ExternalPassPipelineFilename;
   
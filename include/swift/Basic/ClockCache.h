@@ -0,0 +1,143 @@
+//===--- ClockCache.h - Bounded cache with CLOCK eviction -------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_BASIC_CLOCKCACHE_H
+#define SWIFT_BASIC_CLOCKCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include <cassert>
+#include <vector>
+
+namespace swift {
+
+/// \brief A map with a fixed maximum number of entries, which evicts entries
+/// with the CLOCK algorithm once it is full.
+///
+/// CLOCK approximates least-recently-used eviction: every entry has a
+/// reference bit which is set on each hit. To make room, a "hand" sweeps over
+/// the entries in a circle, clearing reference bits, and evicts the first
+/// entry whose bit is already clear. Unlike a real LRU list, a hit costs no
+/// more than setting a bit.
+///
+/// The hit/miss/eviction counters are meant for statistics and dumpers.
+template <typename KeyT, typename ValueT>
+class ClockCache {
+  struct Entry {
+    KeyT Key;
+    ValueT Value;
+    bool Referenced;
+  };
+
+  /// Maps keys to indices in Entries.
+  llvm::DenseMap<KeyT, unsigned> Map;
+
+  /// The entries. Never grows beyond Capacity.
+  std::vector<Entry> Entries;
+
+  /// The maximum number of entries.
+  unsigned Capacity;
+
+  /// The next entry to consider for eviction.
+  unsigned Hand = 0;
+
+  unsigned NumHits = 0;
+  unsigned NumMisses = 0;
+  unsigned NumEvictions = 0;
+
+  /// Removes the entry at \p Idx by moving the last entry into its slot.
+  void removeEntryAt(unsigned Idx) {
+    Map.erase(Entries[Idx].Key);
+    if (Idx != Entries.size() - 1) {
+      Entries[Idx] = std::move(Entries.back());
+      Map[Entries[Idx].Key] = Idx;
+    }
+    Entries.pop_back();
+    if (Hand >= Entries.size())
+      Hand = 0;
+  }
+
+public:
+  explicit ClockCache(unsigned Capacity) : Capacity(Capacity) {
+    assert(Capacity > 0 && "a cache must be able to hold an entry");
+  }
+
+  /// Returns a pointer to the value cached for \p Key, or null if there is
+  /// none. The pointer is invalidated by any change to the cache.
+  ValueT *lookup(const KeyT &Key) {
+    auto Iter = Map.find(Key);
+    if (Iter == Map.end()) {
+      ++NumMisses;
+      return nullptr;
+    }
+    ++NumHits;
+    Entry &E = Entries[Iter->second];
+    E.Referenced = true;
+    return &E.Value;
+  }
+
+  /// Caches \p Value for \p Key, evicting another entry if the cache is full.
+  void insert(const KeyT &Key, const ValueT &Value) {
+    auto Iter = Map.find(Key);
+    if (Iter != Map.end()) {
+      Entries[Iter->second].Value = Value;
+      return;
+    }
+
+    if (Entries.size() < Capacity) {
+      Map[Key] = Entries.size();
+      Entries.push_back({Key, Value, false});
+      return;
+    }
+
+    // Sweep until we find an entry which was not referenced since the last
+    // sweep. This terminates after at most one full round.
+    while (Entries[Hand].Referenced) {
+      Entries[Hand].Referenced = false;
+      Hand = (Hand + 1) % Entries.size();
+    }
+    ++NumEvictions;
+    Entry &Victim = Entries[Hand];
+    Map.erase(Victim.Key);
+    Map[Key] = Hand;
+    Victim = {Key, Value, false};
+    Hand = (Hand + 1) % Entries.size();
+  }
+
+  /// Removes all entries for which \p Pred(Key, Value) returns true.
+  template <typename PredTy> void remove_if(PredTy Pred) {
+    for (unsigned Idx = 0; Idx < Entries.size();) {
+      if (Pred(Entries[Idx].Key, Entries[Idx].Value))
+        removeEntryAt(Idx);
+      else
+        ++Idx;
+    }
+  }
+
+  /// Removes all entries. The statistics are kept.
+  void clear() {
+    Map.clear();
+    Entries.clear();
+    Hand = 0;
+  }
+
+  unsigned size() const { return Entries.size(); }
+  bool empty() const { return Entries.empty(); }
+  unsigned capacity() const { return Capacity; }
+
+  unsigned getNumHits() const { return NumHits; }
+  unsigned getNumMisses() const { return NumMisses; }
+  unsigned getNumEvictions() const { return NumEvictions; }
+};
+
+} // end namespace swift
+
+#endif // SWIFT_BASIC_CLOCKCACHE_H
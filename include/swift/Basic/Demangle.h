@@ -18,6 +18,7 @@
 #include <vector>
 #include <cassert>
 #include <cstdint>
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/StringRef.h"
 #include "swift/Basic/Malloc.h"
 
@@ -67,7 +68,14 @@ struct DemangleOptions {
 };
 
 class Node;
-typedef std::shared_ptr<Node> NodePointer;
+
+/// A reference to a node of a demangling tree.
+///
+/// Nodes are reference-counted intrusively and non-atomically: a tree is only
+/// ever built and used by one thread at a time, and demangling large numbers
+/// of symbols shouldn't pay for a separately-allocated, atomically-updated
+/// control block per node.
+typedef llvm::IntrusiveRefCntPtr<Node> NodePointer;
 
 enum class FunctionSigSpecializationParamKind : unsigned {
   // Option Flags use bits 0-5. This give us 6 bits implying 64 entries to
@@ -133,7 +141,7 @@ enum class Directness {
   Direct, Indirect
 };
 
-class Node : public std::enable_shared_from_this<Node> {
+class Node : public llvm::RefCountedBase<Node> {
 public:
   enum class Kind : uint16_t {
 #define NODE(ID) ID,
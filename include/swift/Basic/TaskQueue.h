@@ -18,9 +18,11 @@
 #include "llvm/Config/config.h"
 #include "llvm/Support/Program.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <queue>
+#include <vector>
 
 namespace swift {
 namespace sys {
@@ -38,10 +40,47 @@ enum class TaskFinishedResponse {
   StopExecution,
 };
 
+/// \brief A queue of tasks which yields the task with the highest priority
+/// first, and tasks with equal priority in the order they were added.
+template <typename T>
+class TaskPriorityQueue {
+  struct Entry {
+    uint64_t Priority;
+    uint64_t Sequence;
+    std::unique_ptr<T> Task;
+  };
+
+  /// A max-heap on (Priority, -Sequence).
+  std::vector<Entry> Heap;
+  uint64_t NextSequence = 0;
+
+  static bool comesAfter(const Entry &lhs, const Entry &rhs) {
+    if (lhs.Priority != rhs.Priority)
+      return lhs.Priority < rhs.Priority;
+    return lhs.Sequence > rhs.Sequence;
+  }
+
+public:
+  bool empty() const { return Heap.empty(); }
+
+  void push(std::unique_ptr<T> Task, uint64_t Priority) {
+    Heap.push_back({Priority, NextSequence++, std::move(Task)});
+    std::push_heap(Heap.begin(), Heap.end(), comesAfter);
+  }
+
+  std::unique_ptr<T> pop() {
+    assert(!empty() && "no tasks to pop");
+    std::pop_heap(Heap.begin(), Heap.end(), comesAfter);
+    std::unique_ptr<T> Result = std::move(Heap.back().Task);
+    Heap.pop_back();
+    return Result;
+  }
+};
+
 /// \brief A class encapsulating the execution of multiple tasks in parallel.
 class TaskQueue {
   /// Tasks which have not begun execution.
-  std::queue<std::unique_ptr<Task>> QueuedTasks;
+  TaskPriorityQueue<Task> QueuedTasks;
 
   /// The number of tasks to execute in parallel.
   unsigned NumberOfParallelTasks;
@@ -120,9 +159,11 @@ public:
   /// \param Env the environment which should be used for the task;
   /// must be null-terminated. If empty, inherits the parent's environment.
   /// \param Context an optional context which will be associated with the task
+  /// \param Priority tasks with a higher priority begin execution first;
+  /// tasks with equal priority begin in the order they were added
   virtual void addTask(const char *ExecPath, ArrayRef<const char *> Args,
                        ArrayRef<const char *> Env = llvm::None,
-                       void *Context = nullptr);
+                       void *Context = nullptr, uint64_t Priority = 0);
 
   /// \brief Synchronously executes the tasks in the TaskQueue.
   ///
@@ -159,7 +200,7 @@ class DummyTaskQueue : public TaskQueue {
       : ExecPath(ExecPath), Args(Args), Env(Env), Context(Context) {}
   };
 
-  std::queue<std::unique_ptr<DummyTask>> QueuedTasks;
+  TaskPriorityQueue<DummyTask> QueuedTasks;
 
 public:
   /// \brief Create a new DummyTaskQueue instance.
@@ -168,7 +209,7 @@ public:
 
   virtual void addTask(const char *ExecPath, ArrayRef<const char *> Args,
                        ArrayRef<const char *> Env = llvm::None,
-                       void *Context = nullptr);
+                       void *Context = nullptr, uint64_t Priority = 0);
 
   virtual bool
   execute(TaskBeganCallback Began = TaskBeganCallback(),
@@ -14,12 +14,68 @@
 #define SWIFT_BASIC_TIMER_H
 
 #include "swift/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/Support/Timer.h"
 
 namespace swift {
+  /// Records spans of time spent in the phases of a compilation, to be
+  /// written as a trace file in Chrome's trace event format (which can be
+  /// viewed with chrome://tracing).
+  ///
+  /// Times are in microseconds since the Unix epoch, so that the traces of
+  /// the driver and of each frontend process line up when merged.
+  class CompilationTrace {
+    static bool Enabled;
+
+  public:
+    /// Starts recording spans for this process.
+    static void enable() { Enabled = true; }
+    static bool isEnabled() { return Enabled; }
+
+    /// Returns the current time, in microseconds since the Unix epoch.
+    static uint64_t now();
+
+    /// Records a span from \p start to \p end.
+    ///
+    /// \p thread identifies the row the span is shown in, within this
+    /// process's part of the trace; by default, it is the calling thread.
+    static void addSpan(StringRef name, StringRef category, uint64_t start,
+                        uint64_t end, Optional<uint64_t> thread = None);
+
+    /// Writes the spans recorded so far to \p path, followed by the spans in
+    /// each of the trace files \p merged (such as those written by other
+    /// processes). Trace files which don't exist are skipped.
+    ///
+    /// \returns true on error
+    static bool write(StringRef path, ArrayRef<std::string> merged = {});
+  };
+
+  /// Records the time between its construction and destruction as a span in
+  /// the compilation trace, if tracing is enabled.
+  class TraceSpan {
+    StringRef Name;
+    StringRef Category;
+    uint64_t Start = 0;
+
+  public:
+    TraceSpan(StringRef name, StringRef category)
+        : Name(name), Category(category) {
+      if (CompilationTrace::isEnabled())
+        Start = CompilationTrace::now();
+    }
+
+    ~TraceSpan() {
+      if (Start)
+        CompilationTrace::addSpan(Name, Category, Start,
+                                  CompilationTrace::now());
+    }
+  };
+
   /// A convenience class for declaring a timer that's part of the Swift
   /// compilation timers group.
+  ///
+  /// Each timer is also recorded in the compilation trace, if enabled.
   class SharedTimer {
     enum class State {
       Initial,
@@ -28,10 +84,11 @@ namespace swift {
     };
     static State CompilationTimersEnabled;
 
+    TraceSpan Span;
     Optional<llvm::NamedRegionTimer> Timer;
 
   public:
-    explicit SharedTimer(StringRef name) {
+    explicit SharedTimer(StringRef name) : Span(name, "phase") {
       if (CompilationTimersEnabled == State::Enabled)
         Timer.emplace(name, StringRef("Swift compilation"));
       else
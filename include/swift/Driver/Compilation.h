@@ -40,6 +40,7 @@ namespace swift {
 
 namespace driver {
   class Driver;
+  class OutputInfo;
   class ToolChain;
 
 /// An enum providing different levels of output which should be produced
@@ -132,6 +133,24 @@ private:
   /// rebuilt.
   bool ShowIncrementalBuildDecisions = false;
 
+  /// When non-null, compile jobs that are ready to run at the same time are
+  /// combined into BatchJobs built by this ToolChain.
+  ///
+  /// \sa enableBatchMode
+  const ToolChain *BatchModeToolChain = nullptr;
+
+  /// The OutputInfo used to build BatchJobs.
+  std::unique_ptr<OutputInfo> BatchModeOutputInfo;
+
+  /// When non-empty, a trace of the jobs run by this Compilation is written
+  /// to this path, merged with the traces written by each frontend job.
+  ///
+  /// \sa swift::CompilationTrace
+  std::string TraceFilePath;
+
+  /// The paths frontend jobs write their own traces to.
+  std::vector<std::string> JobTraceFilePaths;
+
   static const Job *unwrap(const std::unique_ptr<const Job> &p) {
     return p.get();
   }
@@ -198,6 +217,29 @@ public:
     LastBuildTime = time;
   }
 
+  void setTraceFilePath(StringRef path) {
+    assert(TraceFilePath.empty() && "already set");
+    TraceFilePath = path;
+  }
+  StringRef getTraceFilePath() const { return TraceFilePath; }
+
+  /// Records that a job writes a trace to \p path, to be merged into the
+  /// Compilation's trace once all jobs have finished.
+  void addJobTraceFile(StringRef path) {
+    JobTraceFilePaths.push_back(path.str());
+  }
+
+  /// Compile several primary files per frontend process.
+  ///
+  /// Batches are formed while the Compilation runs, out of the batchable
+  /// compile jobs that are ready at the same time, and split into at most
+  /// one batch per parallel command. Each combined job is still scheduled and
+  /// marked finished individually, so incremental builds keep their per-file
+  /// granularity.
+  ///
+  /// \sa ToolChain::constructBatchJob
+  void enableBatchMode(const ToolChain &TC, const OutputInfo &OI);
+
   /// Requests the path to a file containing all input source files. This can
   /// be shared across jobs.
   ///
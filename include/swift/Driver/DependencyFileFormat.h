@@ -0,0 +1,155 @@
+//===--- DependencyFileFormat.h - Swift reference dependency files -*- C++ -*-//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Describes the two encodings of a ".swiftdeps" file: the original YAML
+// format, and a compact binary format with an interned string table that the
+// driver can load without parsing.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_DRIVER_DEPENDENCYFILEFORMAT_H
+#define SWIFT_DRIVER_DEPENDENCYFILEFORMAT_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <vector>
+
+namespace swift {
+namespace dependency_file {
+
+/// The sections of a dependency file, in the order the frontend emits them.
+///
+/// These values are part of the binary format and must not be renumbered.
+enum class Section : uint8_t {
+  ProvidesTopLevel,
+  ProvidesNominal,
+  ProvidesMember,
+  ProvidesDynamicLookup,
+  DependsTopLevel,
+  DependsMember,
+  DependsNominal,
+  DependsDynamicLookup,
+  DependsExternal,
+  Last_Section = DependsExternal
+};
+
+/// Returns the YAML key used for \p section, e.g. "provides-top-level".
+StringRef getSectionName(Section section);
+
+/// The first four bytes of a binary dependency file. These can never begin a
+/// valid YAML document.
+const char BinaryMagic[4] = { '\xDE', 'S', 'D', 'F' };
+
+/// Bumped whenever the binary layout changes.
+const uint32_t BinaryVersion = 1;
+
+/// Used for the member field of entries that are not member entries, and for
+/// a missing interface hash.
+const uint32_t NoStringIndex = ~0U;
+
+/// The binary layout, all in little-endian 32-bit words after the magic:
+///
+/// \code
+///   magic, version, numStrings, numSections, numEntries, interfaceHash,
+///   stringDataSize
+///   stringOffsets[numStrings]           // into stringData
+///   { kind, numEntries }[numSections]
+///   { name, member, isCascading }[numEntries]
+///   stringData[stringDataSize]          // not null-terminated
+/// \endcode
+///
+/// String lengths are implied by the following string's offset, or by
+/// stringDataSize for the last string. Entries are listed section by section.
+enum : unsigned {
+  HeaderWords = 6,
+  SectionWords = 2,
+  EntryWords = 3
+};
+
+/// Returns true if \p data starts with the binary magic number.
+inline bool isBinaryDependencyFile(StringRef data) {
+  return data.size() >= sizeof(BinaryMagic) &&
+         data.startswith(StringRef(BinaryMagic, sizeof(BinaryMagic)));
+}
+
+/// Accumulates the contents of a dependency file and writes it in either
+/// format.
+class Writer {
+  struct Entry {
+    uint32_t name;
+    uint32_t member;
+    bool isCascading;
+  };
+
+  struct SectionEntries {
+    Section kind;
+    std::vector<Entry> entries;
+  };
+
+  llvm::StringMap<uint32_t> StringIndices;
+  std::vector<StringRef> Strings;
+  std::vector<SectionEntries> Sections;
+  uint32_t InterfaceHash = NoStringIndex;
+
+  uint32_t intern(StringRef string);
+
+public:
+  Writer() = default;
+  Writer(Writer &&) = default;
+  Writer &operator=(Writer &&) = default;
+
+  // Strings refers to the keys of StringIndices, so a copy would dangle.
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+
+  /// Starts a new section. Following entries are added to it.
+  ///
+  /// Sections are written even if they end up empty.
+  void beginSection(Section kind) {
+    Sections.push_back({kind, {}});
+  }
+
+  /// Adds \p name to the current section.
+  void addName(StringRef name, bool isCascading = true) {
+    assert(!Sections.empty() && "no current section");
+    Sections.back().entries.push_back({intern(name), NoStringIndex,
+                                       isCascading});
+  }
+
+  /// Adds the pair (\p base, \p member) to the current section, which must be
+  /// a member section.
+  void addMember(StringRef base, StringRef member, bool isCascading = true) {
+    assert(!Sections.empty() && "no current section");
+    assert((Sections.back().kind == Section::ProvidesMember ||
+            Sections.back().kind == Section::DependsMember) &&
+           "not a member section");
+    Sections.back().entries.push_back({intern(base), intern(member),
+                                       isCascading});
+  }
+
+  void setInterfaceHash(StringRef hash) {
+    InterfaceHash = intern(hash);
+  }
+
+  /// Writes the dependencies in the original YAML format.
+  void writeYAML(raw_ostream &out) const;
+
+  /// Writes the dependencies in the binary format.
+  void writeBinary(raw_ostream &out) const;
+};
+
+} // end namespace dependency_file
+} // end namespace swift
+
+#endif
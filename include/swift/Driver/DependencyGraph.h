@@ -129,8 +129,6 @@ private:
   /// \sa SourceFile::getInterfaceHash
   llvm::DenseMap<const void *, std::string> InterfaceHashes;
 
-  LoadResult loadFromBuffer(const void *node, llvm::MemoryBuffer &buffer);
-
   // FIXME: We should be able to use llvm::mapped_iterator for this, but
   // StringMapConstIterator isn't quite an InputIterator (no ->).
   class StringSetIterator {
@@ -161,6 +159,7 @@ private:
 protected:
   LoadResult loadFromString(const void *node, StringRef data);
   LoadResult loadFromPath(const void *node, StringRef path);
+  LoadResult loadFromBuffer(const void *node, llvm::MemoryBuffer &buffer);
 
   void addIndependentNode(const void *node) {
     bool newlyInserted = Provides.insert({node, {}}).second;
@@ -183,6 +182,13 @@ protected:
   }
 
 public:
+  /// Re-encodes the dependencies file in \p buffer in the binary format,
+  /// which loads without parsing YAML.
+  ///
+  /// Returns false if the file is malformed, in which case loading it would
+  /// have produced LoadResult::HadError.
+  static bool encodeAsBinary(llvm::MemoryBuffer &buffer, raw_ostream &out);
+
   llvm::iterator_range<StringSetIterator> getExternalDependencies() const {
     return llvm::make_range(StringSetIterator(ExternalDependencies.begin()),
                             StringSetIterator(ExternalDependencies.end()));
@@ -248,6 +254,15 @@ public:
                                              path);
   }
 
+  /// Load "depends" and "provides" data for \p node from the contents of a
+  /// dependencies file that has already been read into memory.
+  ///
+  /// \sa loadFromPath
+  LoadResult loadFromBuffer(T node, llvm::MemoryBuffer &buffer) {
+    return DependencyGraphImpl::loadFromBuffer(Traits::getAsVoidPointer(node),
+                                               buffer);
+  }
+
   /// Load "depends" and "provides" data for \p node from a plain string.
   ///
   /// This is only intended for testing purposes.
@@ -0,0 +1,96 @@
+//===--- DependencyGraphCache.h - Persisted dependency data -----*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_DRIVER_DEPENDENCYGRAPHCACHE_H
+#define SWIFT_DRIVER_DEPENDENCYGRAPHCACHE_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TimeValue.h"
+#include <memory>
+#include <vector>
+
+namespace swift {
+
+/// Persists the dependencies of every ".swiftdeps" file that went into a
+/// DependencyGraph, so that the next incremental build can rebuild the graph
+/// from a single file instead of opening and reading one file per input.
+///
+/// The dependencies are stored in the binary format of DependencyFileFormat.h
+/// whatever the format of the original file, so unchanged inputs are loaded
+/// without parsing YAML. The cache only holds entries for the files used in
+/// the last build, and is only rewritten if one of them changed.
+///
+/// Each entry remembers the size and modification time of the file it came
+/// from, and is only used if the file still matches. Because timestamps can
+/// be coarse, an entry is also ignored if the file was modified after the
+/// build that wrote the cache started; such files are read again and the
+/// fresh contents are cached by the following build.
+class DependencyGraphCache {
+  struct Entry {
+    llvm::sys::TimeValue ModTime;
+    uint64_t Size;
+    StringRef Data;
+    /// Whether the entry was looked up or updated since the cache was loaded.
+    bool Used;
+  };
+
+  llvm::StringMap<Entry> Entries;
+
+  /// The start time of the build that wrote the loaded cache.
+  llvm::sys::TimeValue LoadedBuildTime = llvm::sys::TimeValue::MinTime();
+
+  /// Whether an entry was added or updated since the cache was loaded.
+  bool Changed = false;
+
+  /// Backing storage for the loaded cache file and for any dependency files
+  /// read since.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> Buffers;
+
+  void writeContents(raw_ostream &out, llvm::sys::TimeValue buildTime) const;
+
+public:
+  /// Loads the cache written by a previous build.
+  ///
+  /// Returns false and leaves the cache empty if the file is missing, was
+  /// written by a different compiler, or is malformed.
+  bool loadFromPath(StringRef path);
+
+  /// Returns the cached dependencies of the dependency file at \p path, in
+  /// the binary format, or an empty buffer if there is no usable entry for
+  /// the file as it currently exists on disk.
+  std::unique_ptr<llvm::MemoryBuffer> lookup(StringRef path);
+
+  /// Records \p buffer, the binary encoding of the dependency file at
+  /// \p path whose status is \p status.
+  ///
+  /// \sa DependencyGraphImpl::encodeAsBinary
+  void update(StringRef path, const llvm::sys::fs::file_status &status,
+              std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+  /// Returns true if writeToPath would write a different cache than the one
+  /// loaded: an entry was added or updated, or an entry was not used.
+  bool isOutOfDate() const;
+
+  /// Writes the cache to \p path if it is out of date, dropping the entries
+  /// that were not used since it was loaded; those belong to inputs that are
+  /// no longer part of the build. \p buildTime should be the time the current
+  /// build started.
+  void writeToPath(StringRef path, llvm::sys::TimeValue buildTime);
+};
+
+} // end namespace swift
+
+#endif
@@ -181,6 +181,31 @@ public:
                              const llvm::opt::ArgStringList &Args);
 };
 
+/// A frontend invocation that compiles the primary files of several compile
+/// Jobs at once.
+///
+/// BatchJobs are formed by the Compilation out of Jobs that are ready to run
+/// at the same time, so each of the combined Jobs still tracks its own
+/// dependencies and is marked finished individually.
+///
+/// \sa ToolChain::constructBatchJob
+class BatchJob : public Job {
+  SmallVector<const Job *, 4> CombinedJobs;
+
+public:
+  BatchJob(const JobAction &Source,
+           std::unique_ptr<CommandOutput> Output,
+           const char *Executable,
+           llvm::opt::ArgStringList Arguments,
+           FilelistInfo Info,
+           ArrayRef<const Job *> Combined)
+      : Job(Source, SmallVector<const Job *, 1>(), std::move(Output),
+            Executable, std::move(Arguments), {}, std::move(Info)),
+        CombinedJobs(Combined.begin(), Combined.end()) {}
+
+  ArrayRef<const Job *> getCombinedJobs() const { return CombinedJobs; }
+};
+
 } // end namespace driver
 } // end namespace swift
 
@@ -34,12 +34,18 @@ using swift::sys::ProcessId;
 void emitBeganMessage(raw_ostream &os, const Job &Cmd, ProcessId Pid);
 
 /// \brief Emits a "finished" message to the given stream.
+///
+/// \param WallTime if present, the time in seconds the task took to run
 void emitFinishedMessage(raw_ostream &os, const Job &Cmd, ProcessId Pid,
-                         int ExitStatus, StringRef Output);
+                         int ExitStatus, StringRef Output,
+                         Optional<double> WallTime = None);
 
 /// \brief Emits a "signalled" message to the given stream.
+///
+/// \param WallTime if present, the time in seconds the task took to run
 void emitSignalledMessage(raw_ostream &os, const Job &Cmd, ProcessId Pid,
-                          StringRef ErrorMsg, StringRef Output);
+                          StringRef ErrorMsg, StringRef Output,
+                          Optional<double> WallTime = None);
 
 /// \brief Emits a "skipped" message to the given stream.
 void emitSkippedMessage(raw_ostream &os, const Job &Cmd);
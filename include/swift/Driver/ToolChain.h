@@ -23,6 +23,7 @@
 
 namespace swift {
 namespace driver {
+  class BatchJob;
   class CommandOutput;
   class Compilation;
   class Driver;
@@ -83,6 +84,13 @@ protected:
     /// arguments.
     const char *getTemporaryFilePath(const llvm::Twine &name,
                                      StringRef suffix = "") const;
+
+    /// Creates a new temporary file for a frontend job to write its trace
+    /// to, if the Compilation is writing a trace.
+    ///
+    /// \returns the path, with the same lifetime as other arguments, or null
+    /// if no trace is being written.
+    const char *getTraceFilePath() const;
   };
 
   /// Packs together information chosen by toolchains to create jobs.
@@ -101,6 +109,17 @@ protected:
   virtual InvocationInfo
   constructInvocation(const CompileJobAction &job,
                       const JobContext &context) const;
+
+  /// Shared implementation of compile invocations for both single Jobs and
+  /// BatchJobs.
+  ///
+  /// In standard compile mode, \p primaryOutputs holds the outputs for each
+  /// of \p context.InputActions, which are the primary files. In whole-module
+  /// mode it holds just \p context.Output.
+  InvocationInfo
+  constructCompileInvocation(const JobContext &context,
+                             ArrayRef<const CommandOutput *> primaryOutputs)
+    const;
   virtual InvocationInfo
   constructInvocation(const InterpretJobAction &job,
                       const JobContext &context) const;
@@ -160,6 +179,16 @@ public:
                                     std::unique_ptr<CommandOutput> output,
                                     const OutputInfo &OI) const;
 
+  /// Returns true if \p job is a compile job that can be combined with others
+  /// by constructBatchJob.
+  bool jobIsBatchable(const Job *job) const;
+
+  /// Construct a single frontend Job that compiles the primary files of all
+  /// of \p jobs, each of which must be batchable.
+  std::unique_ptr<BatchJob> constructBatchJob(ArrayRef<const Job *> jobs,
+                                              Compilation &C,
+                                              const OutputInfo &OI) const;
+
   /// Return the default language type to use for the given extension.
   virtual types::ID lookupTypeForExtension(StringRef Ext) const;
 };
@@ -41,6 +41,7 @@
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MemoryBuffer.h"
 
+#include <algorithm>
 #include <memory>
 
 namespace swift {
@@ -290,7 +291,10 @@ class CompilerInstance {
   std::unique_ptr<SILModule> TheSILModule;
 
   DependencyTracker *DepTracker = nullptr;
-  ReferencedNameTracker *NameTracker = nullptr;
+
+  /// One tracker per primary source file, in the order of
+  /// FrontendOptions::BatchPrimaries when there is more than one.
+  MutableArrayRef<ReferencedNameTracker> NameTrackers;
 
   Module *MainModule = nullptr;
   SerializedModuleLoader *SML = nullptr;
@@ -309,13 +313,27 @@ class CompilerInstance {
 
   enum : unsigned { NO_SUCH_BUFFER = ~0U };
   unsigned MainBufferID = NO_SUCH_BUFFER;
-  unsigned PrimaryBufferID = NO_SUCH_BUFFER;
 
-  SourceFile *PrimarySourceFile = nullptr;
+  /// The buffers of the primary inputs, in the order of
+  /// FrontendOptions::BatchPrimaries when there is more than one. Empty if
+  /// the whole module is being compiled.
+  SmallVector<unsigned, 1> PrimaryBufferIDs;
+
+  /// The primary source files, in the same order as PrimaryBufferIDs.
+  SmallVector<SourceFile *, 1> PrimarySourceFiles;
 
   void createSILModule(bool WholeModule = false);
   void setPrimarySourceFile(SourceFile *SF);
 
+  bool isPrimaryBuffer(unsigned BufferID) const {
+    return std::find(PrimaryBufferIDs.begin(), PrimaryBufferIDs.end(),
+                     BufferID) != PrimaryBufferIDs.end();
+  }
+  bool isPrimarySourceFile(const SourceFile *SF) const {
+    return std::find(PrimarySourceFiles.begin(), PrimarySourceFiles.end(),
+                     SF) != PrimarySourceFiles.end();
+  }
+
 public:
   SourceManager &getSourceMgr() { return SourceMgr; }
 
@@ -342,11 +360,21 @@ public:
   }
 
   void setReferencedNameTracker(ReferencedNameTracker *tracker) {
-    assert(!PrimarySourceFile && "must be called before performSema()");
-    NameTracker = tracker;
+    assert(PrimarySourceFiles.empty() && "must be called before performSema()");
+    if (tracker)
+      NameTrackers = *tracker;
+    else
+      NameTrackers = None;
+  }
+  /// Sets one tracker for each primary input, in the order of
+  /// FrontendOptions::BatchPrimaries.
+  void
+  setReferencedNameTrackers(MutableArrayRef<ReferencedNameTracker> trackers) {
+    assert(PrimarySourceFiles.empty() && "must be called before performSema()");
+    NameTrackers = trackers;
   }
   ReferencedNameTracker *getReferencedNameTracker() {
-    return NameTracker;
+    return NameTrackers.empty() ? nullptr : &NameTrackers.front();
   }
 
   /// Set the SIL module for this compilation instance.
@@ -384,7 +412,16 @@ public:
 
   /// Gets the SourceFile which is the primary input for this CompilerInstance.
   /// \returns the primary SourceFile, or nullptr if there is no primary input
-  SourceFile *getPrimarySourceFile() { return PrimarySourceFile; }
+  ///
+  /// In batch mode, this is the first of getPrimarySourceFiles().
+  SourceFile *getPrimarySourceFile() {
+    return PrimarySourceFiles.empty() ? nullptr : PrimarySourceFiles.front();
+  }
+
+  /// Gets all the primary source files, in the order of
+  /// FrontendOptions::BatchPrimaries. There is more than one only in batch
+  /// mode.
+  ArrayRef<SourceFile *> getPrimarySourceFiles() { return PrimarySourceFiles; }
 
   /// \brief Returns true if there was an error during setup.
   bool setup(const CompilerInvocation &Invocation);
@@ -74,6 +74,25 @@ public:
   /// be generated for the whole module.
   Optional<SelectedInput> PrimaryInput;
 
+  /// The outputs for one primary input of a batch-mode invocation.
+  struct BatchPrimary {
+    SelectedInput Input;
+    std::string OutputFilename;
+    std::string ModuleOutputPath;
+    std::string ModuleDocOutputPath;
+    std::string DependenciesFilePath;
+    std::string ReferenceDependenciesFilePath;
+
+    BatchPrimary(SelectedInput Input) : Input(Input) {}
+  };
+
+  /// Set when more than one -primary-file is given, in command-line order.
+  ///
+  /// Each primary input is compiled in turn against a single ASTContext, as
+  /// if by a separate invocation with PrimaryInput and the output paths below
+  /// taken from its entry. PrimaryInput refers to the first of them.
+  std::vector<BatchPrimary> BatchPrimaries;
+
   /// The kind of input on which the frontend should operate.
   InputFileKind InputKind = InputFileKind::IFK_Swift;
 
@@ -112,6 +131,12 @@ public:
   /// The path to which we should output a Swift reference dependencies file.
   std::string ReferenceDependenciesFilePath;
 
+  /// Indicates that the reference dependencies file should use the binary
+  /// encoding rather than YAML.
+  ///
+  /// \sa swift::dependency_file
+  bool EmitBinaryReferenceDependencies = false;
+
   /// The path to which we should output a fixits as source edits.
   std::string FixitsOutputPath;
 
@@ -175,6 +200,12 @@ public:
   /// \sa swift::SharedTimer
   bool DebugTimeCompilation = false;
 
+  /// If non-empty, the path to write a trace of the time taken in each
+  /// compilation phase and SIL pass to.
+  ///
+  /// \sa swift::CompilationTrace
+  std::string TraceFilePath;
+
   /// Indicates whether function body parsing should be delayed
   /// until the end of all files.
   bool DelayedFunctionBodyParsing = false;
@@ -248,6 +279,13 @@ public:
   /// Indicates whether the RequestedAction has output.
   bool actionHasOutput() const;
 
+  /// Indicates whether more than one primary input is being compiled.
+  bool isBatchMode() const { return !BatchPrimaries.empty(); }
+
+  /// Returns the options for compiling just the primary input \p primary of
+  /// a batch-mode invocation.
+  FrontendOptions getOptionsForBatchPrimary(const BatchPrimary &primary) const;
+
   /// Indicates whether the RequestedAction will immediately run code.
   bool actionIsImmediate() const;
 
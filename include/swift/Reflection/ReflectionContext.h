@@ -427,6 +427,8 @@ public:
     auto OffsetToGenericArgs
       = sizeof(StoredPointer) * (Descriptor->GenericParams.Offset);
     auto AddressOfGenericArgAddress = MetadataAddress + OffsetToGenericArgs;
+    Reader->prefetch(RemoteAddress(AddressOfGenericArgAddress),
+                     NumGenericParams * sizeof(StoredPointer));
 
     using ArgIndex = decltype(Descriptor->GenericParams.NumPrimaryParams);
     for (ArgIndex i = 0; i < NumGenericParams; ++i,
@@ -507,6 +509,8 @@ public:
       StoredPointer ElementAddress = MetadataAddress +
         sizeof(TargetTupleTypeMetadata<Runtime>);
       using Element = typename TargetTupleTypeMetadata<Runtime>::Element;
+      Reader->prefetch(RemoteAddress(ElementAddress),
+                       TupleMeta->NumElements * sizeof(Element));
       for (StoredPointer i = 0; i < TupleMeta->NumElements; ++i,
            ElementAddress += sizeof(Element)) {
         Element E;
@@ -532,6 +536,8 @@ public:
       TypeRefVector Arguments;
       StoredPointer ArgumentAddress = MetadataAddress +
         sizeof(TargetFunctionTypeMetadata<Runtime>);
+      Reader->prefetch(RemoteAddress(ArgumentAddress),
+                       Function->getNumArguments() * sizeof(StoredPointer));
       for (StoredPointer i = 0; i < Function->getNumArguments(); ++i,
            ArgumentAddress += sizeof(StoredPointer)) {
         StoredPointer FlaggedArgumentAddress;
@@ -663,6 +669,7 @@ public:
     TypeRefCache.clear();
     MetadataCache.clear();
     NominalTypeDescriptorCache.clear();
+    Reader->clearCache();
   }
 
   void addReflectionInfo(ReflectionInfo I) {
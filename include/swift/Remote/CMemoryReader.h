@@ -21,6 +21,9 @@
 #include "swift/SwiftRemoteMirror/MemoryReaderInterface.h"
 #include "swift/Remote/MemoryReader.h"
 
+#include <cassert>
+#include <memory>
+
 namespace swift {
 namespace remote {
 
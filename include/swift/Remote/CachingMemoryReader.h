@@ -0,0 +1,229 @@
+//===- CachingMemoryReader.h - Page cache for remote reads ------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file declares an implementation of MemoryReader that caches the
+//  memory read through another MemoryReader one page at a time.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_REMOTE_CACHINGMEMORYREADER_H
+#define SWIFT_REMOTE_CACHINGMEMORYREADER_H
+
+#include "swift/Remote/MemoryReader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace swift {
+namespace remote {
+
+/// An implementation of MemoryReader which forwards to another reader in
+/// whole pages, and remembers the pages it has read.
+///
+/// Reading another process's memory usually costs a system call or an IPC
+/// round trip, while metadata walks read many small, nearby objects. With
+/// this cache, the header, descriptor and name of a type cost one request
+/// between them, and runs of missing pages are fetched together.
+///
+/// The cache assumes that the remote memory doesn't change; clearCache()
+/// must be called once it may have.
+///
+/// Sizes come from the inspected process and may be garbage, so the amount
+/// of memory read ahead and kept around is bounded.
+class CachingMemoryReader final : public MemoryReader {
+public:
+  static const uint64_t PageSize = 4096;
+
+  /// The most pages a prefetch() hint reads ahead.
+  static const uint64_t MaxPrefetchPages = 4;
+
+  /// Reads spanning more pages than this bypass the cache.
+  static const uint64_t MaxCachedReadPages = 16;
+
+  /// The most pages kept in the cache. Once it is full, it is emptied.
+  static const uint64_t MaxCachedPages = 1024;
+
+private:
+  std::shared_ptr<MemoryReader> Underlying;
+
+  /// The cached pages, keyed by their page-aligned address.
+  std::unordered_map<uint64_t, std::unique_ptr<uint8_t[]>> Pages;
+
+  static uint64_t pageStart(uint64_t address) {
+    return address & ~(PageSize - 1);
+  }
+
+  /// Computes the first page of [address, address + size) and the number of
+  /// pages it overlaps. Returns false if the range is empty or wraps around
+  /// the end of the address space.
+  static bool getPageRange(uint64_t address, uint64_t size,
+                           uint64_t &firstPage, uint64_t &numPages) {
+    if (size == 0 || size - 1 > UINT64_MAX - address)
+      return false;
+    firstPage = pageStart(address);
+    numPages = (pageStart(address + size - 1) - firstPage) / PageSize + 1;
+    return true;
+  }
+
+  const uint8_t *getCachedPage(uint64_t page) const {
+    auto found = Pages.find(page);
+    if (found == Pages.end())
+      return nullptr;
+    return found->second.get();
+  }
+
+  /// Reads the \p count pages starting at \p firstPage with one request,
+  /// falling back to a request per page if that fails, since the range may
+  /// not be entirely mapped.
+  void fetchPages(uint64_t firstPage, uint64_t count) {
+    if (count > 1) {
+      std::unique_ptr<uint8_t[]> run(new uint8_t[count * PageSize]);
+      if (Underlying->readBytes(RemoteAddress(firstPage), run.get(),
+                                count * PageSize)) {
+        for (uint64_t i = 0; i != count; ++i) {
+          std::unique_ptr<uint8_t[]> page(new uint8_t[PageSize]);
+          std::memcpy(page.get(), run.get() + i * PageSize, PageSize);
+          Pages[firstPage + i * PageSize] = std::move(page);
+        }
+        return;
+      }
+    }
+
+    for (uint64_t i = 0; i != count; ++i) {
+      std::unique_ptr<uint8_t[]> page(new uint8_t[PageSize]);
+      uint64_t address = firstPage + i * PageSize;
+      if (Underlying->readBytes(RemoteAddress(address), page.get(), PageSize))
+        Pages[address] = std::move(page);
+    }
+  }
+
+  /// Makes sure that every page in the \p numPages pages starting at
+  /// \p firstPage that can be read is in the cache.
+  void fetchRange(uint64_t firstPage, uint64_t numPages) {
+    assert(numPages <= MaxCachedReadPages && "range too large to cache");
+    uint64_t numMissing = 0;
+    uint64_t page = firstPage;
+    for (uint64_t i = 0; i != numPages; ++i, page += PageSize)
+      if (!getCachedPage(page))
+        ++numMissing;
+    if (numMissing == 0)
+      return;
+    if (Pages.size() + numMissing > MaxCachedPages)
+      Pages.clear();
+
+    uint64_t runStart = 0, runLength = 0;
+    page = firstPage;
+    for (uint64_t i = 0; i != numPages; ++i, page += PageSize) {
+      if (getCachedPage(page)) {
+        if (runLength)
+          fetchPages(runStart, runLength);
+        runLength = 0;
+        continue;
+      }
+      if (!runLength)
+        runStart = page;
+      ++runLength;
+    }
+    if (runLength)
+      fetchPages(runStart, runLength);
+  }
+
+public:
+  explicit CachingMemoryReader(std::shared_ptr<MemoryReader> Underlying)
+    : Underlying(std::move(Underlying)) {}
+
+  uint8_t getPointerSize() override {
+    return Underlying->getPointerSize();
+  }
+
+  uint8_t getSizeSize() override {
+    return Underlying->getSizeSize();
+  }
+
+  RemoteAddress getSymbolAddress(const std::string &name) override {
+    return Underlying->getSymbolAddress(name);
+  }
+
+  bool readBytes(RemoteAddress address, uint8_t *dest,
+                 uint64_t size) override {
+    uint64_t start = address.getAddressData();
+    uint64_t firstPage, numPages;
+    if (!getPageRange(start, size, firstPage, numPages))
+      return size == 0;
+    if (numPages > MaxCachedReadPages)
+      return Underlying->readBytes(address, dest, size);
+    fetchRange(firstPage, numPages);
+
+    uint64_t copied = 0;
+    while (copied != size) {
+      uint64_t current = start + copied;
+      const uint8_t *page = getCachedPage(pageStart(current));
+      if (!page) {
+        // Part of the range couldn't be read a page at a time; let the
+        // underlying reader decide whether the exact range is readable.
+        return Underlying->readBytes(RemoteAddress(current), dest + copied,
+                                     size - copied);
+      }
+      uint64_t offset = current - pageStart(current);
+      uint64_t length = std::min(PageSize - offset, size - copied);
+      std::memcpy(dest + copied, page + offset, length);
+      copied += length;
+    }
+    return true;
+  }
+
+  bool readString(RemoteAddress address, std::string &dest) override {
+    std::string result;
+    uint64_t current = address.getAddressData();
+    while (true) {
+      fetchRange(pageStart(current), 1);
+      const uint8_t *page = getCachedPage(pageStart(current));
+      if (!page)
+        return Underlying->readString(address, dest);
+
+      uint64_t offset = current - pageStart(current);
+      auto begin = reinterpret_cast<const char *>(page + offset);
+      auto terminator = static_cast<const char *>(
+          std::memchr(begin, '\0', PageSize - offset));
+      if (terminator) {
+        result.append(begin, terminator);
+        dest = std::move(result);
+        return true;
+      }
+      result.append(begin, PageSize - offset);
+      current = pageStart(current) + PageSize;
+    }
+  }
+
+  void prefetch(RemoteAddress address, uint64_t size) override {
+    uint64_t firstPage, numPages;
+    if (!getPageRange(address.getAddressData(), size, firstPage, numPages))
+      return;
+    if (numPages > MaxPrefetchPages)
+      numPages = MaxPrefetchPages;
+    fetchRange(firstPage, numPages);
+  }
+
+  void clearCache() override {
+    Pages.clear();
+    Underlying->clearCache();
+  }
+};
+
+} // end namespace remote
+} // end namespace swift
+
+#endif // SWIFT_REMOTE_CACHINGMEMORYREADER_H
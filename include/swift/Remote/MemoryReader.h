@@ -85,6 +85,15 @@ public:
                      sizeof(IntegerType));
   }
 
+  /// Hints that the given range of the remote process's memory is about
+  /// to be read, so that a reader which caches can fetch all of it with
+  /// one request.
+  virtual void prefetch(RemoteAddress address, uint64_t size) {}
+
+  /// Discards anything the reader has cached about the contents of the
+  /// remote process's memory.
+  virtual void clearCache() {}
+
   virtual ~MemoryReader() = default;
 };
 
@@ -123,9 +123,21 @@ template <class ElemTy> struct ConcurrentList {
   std::atomic<ConcurrentListNode<ElemTy> *> First;
 };
 
-/// A concurrent map that is implemented using a binary tree. It supports
-/// concurrent insertions but does not support removals or rebalancing of
-/// the tree.
+/// A concurrent map that is implemented using a binary hash trie. It
+/// supports concurrent insertions but does not support removals.
+///
+/// Rather than ordering nodes by key, the path from the root to an entry is
+/// chosen by successive bits of the (mixed) hash of its key. The expected
+/// depth of the trie is therefore logarithmic in the number of entries no
+/// matter what order the keys are inserted in, and no rebalancing is ever
+/// required, so lookups remain completely lock-free. The full hash is stored
+/// in every node so that most mismatches are rejected without calling
+/// compareWithKey. Only if the hash bits are exhausted (i.e. in the case of
+/// pathological collisions) does the search fall back on the ternary
+/// comparison to pick a direction.
+///
+/// Lookups never write to shared state, so concurrent readers of the same
+/// map do not contend on any cache line.
 ///
 /// The entry type must provide the following operations:
 ///
@@ -136,6 +148,11 @@ template <class ElemTy> struct ConcurrentList {
 ///   /// to find or getOrInsert.
 ///   int compareWithKey(KeyTy key) const;
 ///
+///   /// Hash a key. Keys that compare equal must produce the same hash.
+///   /// The result does not need to be well distributed; the map mixes it
+///   /// before use.
+///   static size_t getKeyHash(KeyTy key);
+///
 ///   /// Return the amount of extra trailing space required by an entry,
 ///   /// where KeyTy is the type of the first argument to getOrInsert and
 ///   /// ArgTys is the type of the remaining arguments.
@@ -144,11 +161,13 @@ template <class EntryTy> class ConcurrentMap {
   struct Node {
     std::atomic<Node*> Left;
     std::atomic<Node*> Right;
+    size_t Hash;
     EntryTy Payload;
 
     template <class... Args>
-    Node(Args &&... args)
-      : Left(nullptr), Right(nullptr), Payload(std::forward<Args>(args)...) {}
+    Node(size_t hash, Args &&... args)
+      : Left(nullptr), Right(nullptr), Hash(hash),
+        Payload(std::forward<Args>(args)...) {}
 
     Node(const Node &) = delete;
     Node &operator=(const Node &) = delete;
@@ -167,7 +186,7 @@ template <class EntryTy> class ConcurrentMap {
       auto R = Right.load(std::memory_order_acquire);
       printf("\"%p\" [ label = \" {<f0> %08lx | {<f1> | <f2>}}\" "
              "style=\"rounded\" shape=\"record\"];\n",
-             this, (long) Payload.getKeyValueForDump());
+             this, (long) Payload.getKeyIntValueForDump());
 
       if (L) {
         L->dump();
@@ -181,16 +200,53 @@ template <class EntryTy> class ConcurrentMap {
 #endif
   };
 
-  /// The root of the tree.
+  /// The number of hash bits available to steer the search before falling
+  /// back on key comparison.
+  static constexpr unsigned NumHashBits = sizeof(size_t) * 8;
+
+  /// The root of the trie.
   std::atomic<Node*> Root;
 
-  /// This member stores the address of the last node that was found by the
-  /// search procedure. We cache the last search to accelerate code that
-  /// searches the same value in a loop.
-  std::atomic<Node*> LastSearch;
+  /// The number of entries in the map. This is only updated when a new node
+  /// is inserted, never on lookup.
+  std::atomic<size_t> NumEntries;
+
+  /// Scramble the bits of a user-provided hash so that the low-order bits
+  /// used near the root of the trie are well distributed even for hashes
+  /// derived from aligned pointers.
+  static size_t mixHash(size_t hash) {
+    uint64_t h = hash;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return size_t(h);
+  }
+
+  /// Select the child edge of \p node to follow for a key with the given
+  /// hash at the given depth.
+  static std::atomic<Node*> *getChildEdge(Node *node, size_t hash,
+                                          unsigned depth,
+                                          int comparisonResult) {
+    bool goLeft;
+    if (depth < NumHashBits)
+      goLeft = ((hash >> depth) & 1) == 0;
+    else
+      goLeft = comparisonResult < 0;
+    return goLeft ? &node->Left : &node->Right;
+  }
+
+  /// Compare the key against a node, consulting the stored hash first.
+  template <class KeyTy>
+  static int compareWithNode(Node *node, size_t hash, const KeyTy &key) {
+    if (node->Hash != hash)
+      return (hash < node->Hash ? -1 : 1);
+    return node->Payload.compareWithKey(key);
+  }
 
 public:
-  constexpr ConcurrentMap() : Root(nullptr), LastSearch(nullptr) {}
+  constexpr ConcurrentMap() : Root(nullptr), NumEntries(0) {}
 
   ConcurrentMap(const ConcurrentMap &) = delete;
   ConcurrentMap &operator=(const ConcurrentMap &) = delete;
@@ -213,29 +269,26 @@ public:
   }
 #endif
 
+  /// Return the number of entries in the map.
+  size_t size() const {
+    return NumEntries.load(std::memory_order_relaxed);
+  }
+
   /// Search for a value by key \p Key.
   /// \returns a pointer to the value or null if the value is not in the map.
   template <class KeyTy>
   EntryTy *find(const KeyTy &key) {
-    // Check if we are looking for the same key that we looked for in the last
-    // time we called this function.
-    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
-      if (last->Payload.compareWithKey(key) == 0)
-        return &last->Payload;
-    }
+    size_t hash = mixHash(EntryTy::getKeyHash(key));
 
-    // Search the tree, starting from the root.
+    // Search the trie, starting from the root.
     Node *node = Root.load(std::memory_order_acquire);
+    unsigned depth = 0;
     while (node) {
-      int comparisonResult = node->Payload.compareWithKey(key);
-      if (comparisonResult == 0) {
-        LastSearch.store(node, std::memory_order_release);
+      int comparisonResult = compareWithNode(node, hash, key);
+      if (comparisonResult == 0)
         return &node->Payload;
-      } else if (comparisonResult < 0) {
-        node = node->Left.load(std::memory_order_acquire);
-      } else {
-        node = node->Right.load(std::memory_order_acquire);
-      }
+      node = getChildEdge(node, hash, depth++, comparisonResult)
+               ->load(std::memory_order_acquire);
     }
 
     return nullptr;
@@ -247,18 +300,14 @@ public:
   ///   or already existed (false)
   template <class KeyTy, class... ArgTys>
   std::pair<EntryTy*, bool> getOrInsert(KeyTy key, ArgTys &&... args) {
-    // Check if we are looking for the same key that we looked for the
-    // last time we called this function.
-    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
-      if (last && last->Payload.compareWithKey(key) == 0)
-        return { &last->Payload, false };
-    }
+    size_t hash = mixHash(EntryTy::getKeyHash(key));
 
     // The node we allocated.
     Node *newNode = nullptr;
 
     // Start from the root.
     auto edge = &Root;
+    unsigned depth = 0;
 
     while (true) {
       // Load the edge.
@@ -270,20 +319,19 @@ public:
       searchFromNode:
 
         // Compare our key against the node's key.
-        int comparisonResult = node->Payload.compareWithKey(key);
+        int comparisonResult = compareWithNode(node, hash, key);
 
         // If it's equal, we can use this node.
         if (comparisonResult == 0) {
           // Destroy the node we allocated before if we're carrying one around.
           ::delete newNode;
 
-          // Cache and report that we found an existing node.
-          LastSearch.store(node, std::memory_order_release);
+          // Report that we found an existing node.
           return { &node->Payload, false };
         }
 
         // Otherwise, select the appropriate child edge and descend.
-        edge = (comparisonResult < 0 ? &node->Left : &node->Right);
+        edge = getChildEdge(node, hash, depth++, comparisonResult);
         continue;
       }
 
@@ -292,15 +340,15 @@ public:
         size_t allocSize =
           sizeof(Node) + EntryTy::getExtraAllocationSize(key, args...);
         void *memory = ::operator new(allocSize);
-        newNode = ::new (memory) Node(key, std::forward<ArgTys>(args)...);
+        newNode = ::new (memory) Node(hash, key, std::forward<ArgTys>(args)...);
       }
 
       // Try to set the edge to the new node.
       if (std::atomic_compare_exchange_strong_explicit(edge, &node, newNode,
                                                   std::memory_order_acq_rel,
                                                   std::memory_order_acquire)) {
-        // If that succeeded, cache and report that we created a new node.
-        LastSearch.store(newNode, std::memory_order_release);
+        // If that succeeded, report that we created a new node.
+        NumEntries.fetch_add(1, std::memory_order_relaxed);
         return { &newNode->Payload, true };
       }
 
@@ -18,5 +18,16 @@
 #define SWIFT_RUNTIME_HEAP_H
 
 #include <llvm/Support/Compiler.h>
+#include <stddef.h>
+
+namespace swift {
+
+#if SWIFT_RUNTIME_SIZE_CLASS_ALLOCATOR
+/// Return the number of bytes that can be used in a block returned by
+/// swift_slowAlloc. This is the size-class-aware equivalent of malloc_size.
+size_t _swift_slowAllocUsableSize(const void *ptr);
+#endif
+
+} // end namespace swift
 
 #endif /* SWIFT_RUNTIME_HEAP_H */
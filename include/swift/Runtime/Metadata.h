@@ -3367,6 +3367,48 @@ extern "C"
 void swift_registerTypeMetadataRecords(const TypeMetadataRecord *begin,
                                        const TypeMetadataRecord *end);
 
+/// The kinds of runtime data whose metadata allocations are accounted for
+/// separately.
+enum class MetadataAllocationKind : unsigned {
+  GenericClass,
+  GenericValue,
+  Tuple,
+  Function,
+  Metatype,
+  ExistentialMetatype,
+  Existential,
+  ObjCClassWrapper,
+  WitnessTable,
+  Box,
+  Other,
+
+  NumKinds
+};
+
+/// Memory usage of the metadata allocator for one kind of runtime data.
+struct MetadataAllocationStats {
+  /// The number of allocations made.
+  size_t NumAllocations;
+
+  /// The number of bytes handed out by those allocations.
+  size_t BytesAllocated;
+
+  /// The number of bytes mapped but never handed out, either because a
+  /// slab was abandoned with too little space left in it or because a
+  /// large allocation was rounded up to whole pages.
+  size_t BytesWasted;
+};
+
+/// Read the metadata allocator's counters for the given kind of runtime data.
+/// Returns false if the kind is out of range.
+///
+/// Setting the environment variable SWIFT_DEBUG_METADATA_ALLOCATION_STATS
+/// additionally prints all of the counters to stderr at exit.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+bool swift_getMetadataAllocationStats(MetadataAllocationKind kind,
+                                      MetadataAllocationStats *stats);
+
 /// Return the type name for a given type metadata.
 std::string nameForMetadata(const Metadata *type,
                             bool qualified = true);
@@ -49,6 +49,10 @@ private:
   /// The ordered set of instructions in the SILBasicBlock.
   InstListType InstList;
 
+  /// The number of times this block ran according to the profile given with
+  /// -profile-use, if known.
+  Optional<uint64_t> ExecutionCount;
+
   friend struct llvm::ilist_sentinel_traits<SILBasicBlock>;
   friend struct llvm::ilist_traits<SILBasicBlock>;
   SILBasicBlock() : Parent(0) {}
@@ -69,6 +73,11 @@ public:
   SILFunction *getParent() { return Parent; }
   const SILFunction *getParent() const { return Parent; }
 
+  /// Returns the number of times this block ran in the profile the module
+  /// was compiled with, or None if there is no profile data for it.
+  Optional<uint64_t> getExecutionCount() const { return ExecutionCount; }
+  void setExecutionCount(Optional<uint64_t> Count) { ExecutionCount = Count; }
+
   SILModule &getModule() const;
 
   /// This method unlinks 'self' from the containing SILFunction and deletes it.
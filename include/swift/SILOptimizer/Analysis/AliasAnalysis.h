@@ -13,6 +13,7 @@
 #ifndef SWIFT_SILOPTIMIZER_ANALYSIS_ALIASANALYSIS_H
 #define SWIFT_SILOPTIMIZER_ANALYSIS_ALIASANALYSIS_H
 
+#include "swift/Basic/ClockCache.h"
 #include "swift/Basic/ValueEnumerator.h"
 #include "swift/SIL/SILInstruction.h"
 #include "swift/SILOptimizer/Analysis/Analysis.h"
@@ -93,6 +94,13 @@ private:
   SideEffectAnalysis *SEA;
   EscapeAnalysis *EA;
 
+  enum {
+    /// The caches must not grow beyond this size. We limit the size of the
+    /// caches to 2**14 entries because we want to limit their memory usage.
+    /// Once a cache is full, the least recently used entries are evicted.
+    MaxCacheSize = 16384
+  };
+
   using TBAACacheKey = std::pair<SILType, SILType>;
 
   /// A cache for the computation of TBAA. True means that the types may
@@ -100,18 +108,37 @@ private:
   ///
   /// We don't need to invalidate this cache because type aliasing relations
   /// never change.
-  llvm::DenseMap<TBAACacheKey, bool> TypesMayAliasCache;
+  ClockCache<TBAACacheKey, bool> TypesMayAliasCache;
+
+  /// A cached query result.
+  template <typename ResultTy> struct CachedResult {
+    ResultTy Result;
+
+    /// The function in which the query was made, if known. All entries of a
+    /// function are dropped when the function is invalidated.
+    SILFunction *F;
+
+    /// True if the result was computed with the help of the side-effect or
+    /// escape analysis. These results depend on the summaries of callees, so
+    /// they are dropped on the invalidation of any function.
+    bool UsedSummaries;
+  };
 
   /// AliasAnalysis value cache.
   ///
   /// The alias() method uses this map to cache queries.
-  llvm::DenseMap<AliasKeyTy, AliasResult> AliasCache;
+  ClockCache<AliasKeyTy, CachedResult<AliasResult>> AliasCache;
 
   using MemoryBehavior = SILInstruction::MemoryBehavior;
   /// MemoryBehavior value cache.
   ///
   /// The computeMemoryBehavior() method uses this map to cache queries.
-  llvm::DenseMap<MemBehaviorKeyTy, MemoryBehavior> MemoryBehaviorCache;
+  ClockCache<MemBehaviorKeyTy, CachedResult<MemoryBehavior>>
+      MemoryBehaviorCache;
+
+  /// Set while computing a query result if the side-effect or escape analysis
+  /// is used, including by nested queries.
+  bool QueryUsedSummaries = false;
 
   /// The AliasAnalysis cache can't directly map a pair of ValueBase pointers
   /// to alias results because we'd like to be able to remove deleted pointers
@@ -151,7 +178,9 @@ private:
 
 public:
   AliasAnalysis(SILModule *M) :
-    SILAnalysis(AnalysisKind::Alias), Mod(M), SEA(nullptr), EA(nullptr) {}
+    SILAnalysis(AnalysisKind::Alias), Mod(M), SEA(nullptr), EA(nullptr),
+    TypesMayAliasCache(MaxCacheSize), AliasCache(MaxCacheSize),
+    MemoryBehaviorCache(MaxCacheSize) {}
 
   static bool classof(const SILAnalysis *S) {
     return S->getKind() == AnalysisKind::Alias;
@@ -258,14 +287,53 @@ public:
   /// Encodes the memory behavior query as a MemBehaviorKeyTy.
   MemBehaviorKeyTy toMemoryBehaviorKey(SILValue V1, SILValue V2, RetainObserveKind K);
 
+  /// Returns the function in which \p V is defined, or null for values which
+  /// are not defined in a function.
+  static SILFunction *getParentFunction(SILValue V) {
+    if (SILBasicBlock *BB = V->getParentBB())
+      return BB->getParent();
+    return nullptr;
+  }
+
   virtual void invalidate(SILAnalysis::InvalidationKind K) override {
     AliasCache.clear();
     MemoryBehaviorCache.clear();
+    // All indices are unused now, so we can start enumerating from scratch.
+    AliasValueBaseToIndex.clear();
+    MemoryBehaviorValueBaseToIndex.clear();
   }
 
-  virtual void invalidate(SILFunction *,
+  /// Drops the results of the queries made in \p F. Results for other
+  /// functions are kept, unless they are derived from the side-effect or
+  /// escape analysis, which may change with \p F.
+  virtual void invalidate(SILFunction *F,
                           SILAnalysis::InvalidationKind K) override {
-    invalidate(K);
+    AliasCache.remove_if(
+        [F](const AliasKeyTy &, const CachedResult<AliasResult> &Entry) {
+          return Entry.F == F || Entry.UsedSummaries;
+        });
+    MemoryBehaviorCache.remove_if(
+        [F](const MemBehaviorKeyTy &,
+            const CachedResult<MemoryBehavior> &Entry) {
+          return Entry.F == F || Entry.UsedSummaries;
+        });
+  }
+
+  /// Statistics about the alias and memory behavior caches, for the AA
+  /// dumper.
+  unsigned getNumAliasCacheHits() const { return AliasCache.getNumHits(); }
+  unsigned getNumAliasCacheMisses() const { return AliasCache.getNumMisses(); }
+  unsigned getNumAliasCacheEvictions() const {
+    return AliasCache.getNumEvictions();
+  }
+  unsigned getNumMemoryBehaviorCacheHits() const {
+    return MemoryBehaviorCache.getNumHits();
+  }
+  unsigned getNumMemoryBehaviorCacheMisses() const {
+    return MemoryBehaviorCache.getNumMisses();
+  }
+  unsigned getNumMemoryBehaviorCacheEvictions() const {
+    return MemoryBehaviorCache.getNumEvictions();
   }
 };
 
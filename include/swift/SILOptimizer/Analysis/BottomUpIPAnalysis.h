@@ -161,6 +161,10 @@ protected:
     /// The number of visited functions.
     unsigned numVisited = 0;
 
+    /// The number of visited functions which are recomputed, i.e. which did
+    /// not have valid analysis data.
+    unsigned numRecomputed = 0;
+
     /// The BottomUpIPAnalysis::CurrentUpdateID.
     int CurrentUpdateID;
 
@@ -199,6 +203,14 @@ protected:
       return Scheduled.end();
     }
 
+    /// Returns the number of functions visited in the current update-cycle.
+    unsigned getNumVisited() const { return numVisited; }
+
+    /// Returns the number of functions which are recomputed in the current
+    /// update-cycle. The other visited functions just reuse their still valid
+    /// analysis data.
+    unsigned getNumRecomputed() const { return numRecomputed; }
+
     /// Returns true if the analysis for \p FInfo was recomputed during the
     /// current update-cycle.
     bool wasRecomputedWithCurrentUpdateID(FunctionInfo *FInfo) {
@@ -222,6 +234,7 @@ protected:
         return true;
       }
       InitiallyUnscheduled.push_back(FInfo);
+      numRecomputed++;
       // Set to valid.
       FInfo->UpdateID = CurrentUpdateID;
       return false;
@@ -289,14 +302,21 @@ protected:
   int getCurrentUpdateID() const { return CurrentUpdateID; }
 
   /// Invalidates \p FInfo, including all analysis data which depend on it, i.e.
-  /// the callers.
+  /// the transitive callers. All other functions keep their analysis data, so
+  /// that the next recomputation only has to visit the invalidated part of the
+  /// call-graph.
+  /// Returns the number of functions whose analysis data was invalidated.
   template<typename FunctionInfo>
-  void invalidateIncludingAllCallers(FunctionInfo *FInfo) {
+  unsigned invalidateIncludingAllCallers(FunctionInfo *FInfo) {
     llvm::SmallVector<FunctionInfo *, 8> WorkList;
     WorkList.push_back(FInfo);
+    unsigned NumInvalidated = 0;
 
     while (!WorkList.empty()) {
       FunctionInfo *FInfo = WorkList.pop_back_val();
+      // A caller may be reachable on multiple paths.
+      if (FInfo->isValid())
+        NumInvalidated++;
       for (const auto &E : FInfo->Callers) {
         if (E.isValid() && E.Caller->isValid())
           WorkList.push_back(E.Caller);
@@ -305,6 +325,7 @@ protected:
       FInfo->Callers.clear();
       FInfo->UpdateID = 0;
     }
+    return NumInvalidated;
   }
 };
 
@@ -61,6 +61,10 @@ public:
   }
 
   bool isCold(const SILBasicBlock *BB) { return isCold(BB, 0); }
+
+  /// \return true if the profile given with -profile-use saw the function
+  /// containing \p BB run, but never reach \p BB.
+  static bool isNeverExecuted(const SILBasicBlock *BB);
 };
 } // end namespace swift
 
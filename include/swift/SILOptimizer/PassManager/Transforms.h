@@ -145,6 +145,12 @@ namespace swift {
       PM->invalidateAnalysis(F, K);
     }
 
+    /// Notify all analysis of the new function \p F. Passes which create
+    /// functions and only invalidate the changed functions must call this.
+    void notifyAnalysisOfFunction(SILFunction *F) {
+      PM->notifyAnalysisOfFunction(F);
+    }
+
     /// Invalidate only the function \p F, using invalidation information \p K.
     /// But we also know this function is going to be dead.
     void invalidateAnalysisForDeadFunction(SILFunction *F,
@@ -232,21 +232,73 @@ public:
     }
   };
 
+  /// A table of entities referenced by a module, indexed by ID, holding the
+  /// offset of each entity's record until it is deserialized.
+  ///
+  /// These tables can be large, and most of their entries are never used by
+  /// any one import, so the index block record listing the offsets is only
+  /// decoded the first time the table is accessed.
+  template <typename T>
+  class LazyOffsetTable {
+    std::vector<T> Entries;
+
+    /// A cursor positioned at the record to decode, if not yet decoded.
+    Optional<llvm::BitstreamCursor> PendingRecord;
+    unsigned PendingAbbrevID = 0;
+
+    void load() {
+      if (!PendingRecord)
+        return;
+      SmallVector<uint64_t, 64> scratch;
+      PendingRecord->readRecord(PendingAbbrevID, scratch);
+      Entries.assign(scratch.begin(), scratch.end());
+      PendingRecord = None;
+    }
+
+  public:
+    /// Defers decoding the offsets to the record at \p cursor's position,
+    /// which uses the abbreviation \p abbrevID.
+    void setRecord(const llvm::BitstreamCursor &cursor, unsigned abbrevID) {
+      Entries.clear();
+      PendingRecord = cursor;
+      PendingAbbrevID = abbrevID;
+    }
+
+    size_t size() {
+      load();
+      return Entries.size();
+    }
+
+    T &operator[](size_t index) {
+      load();
+      return Entries[index];
+    }
+
+    /// Iterates over the entries decoded so far; if the table hasn't been
+    /// loaded, none of its entities have been deserialized.
+    typename std::vector<T>::const_iterator begin() const {
+      return Entries.begin();
+    }
+    typename std::vector<T>::const_iterator end() const {
+      return Entries.end();
+    }
+  };
+
 private:
   /// Decls referenced by this module.
-  std::vector<Serialized<Decl*>> Decls;
+  LazyOffsetTable<Serialized<Decl*>> Decls;
 
   /// DeclContexts referenced by this module.
-  std::vector<Serialized<DeclContext*>> DeclContexts;
+  LazyOffsetTable<Serialized<DeclContext*>> DeclContexts;
 
   /// Local DeclContexts referenced by this module.
-  std::vector<Serialized<DeclContext*>> LocalDeclContexts;
+  LazyOffsetTable<Serialized<DeclContext*>> LocalDeclContexts;
 
   /// Normal protocol conformances referenced by this module.
-  std::vector<Serialized<NormalProtocolConformance *>> NormalConformances;
+  LazyOffsetTable<Serialized<NormalProtocolConformance *>> NormalConformances;
 
   /// Types referenced by this module.
-  std::vector<Serialized<Type>> Types;
+  LazyOffsetTable<Serialized<Type>> Types;
 
   /// Represents an identifier that may or may not have been deserialized yet.
   ///
@@ -264,7 +316,7 @@ private:
   };
 
   /// Identifiers referenced by this module.
-  std::vector<SerializedIdentifier> Identifiers;
+  LazyOffsetTable<SerializedIdentifier> Identifiers;
 
   class DeclTableInfo;
   using SerializedDeclTable =
@@ -20,6 +20,8 @@
 #define SWIFT_SERIALIZATION_MODULEFORMAT_H
 
 #include "swift/AST/Decl.h"
+#include "swift/AST/Module.h"
+#include "swift/Basic/Range.h"
 #include "llvm/Bitcode/RecordLayout.h"
 #include "llvm/Bitcode/BitCodes.h"
 #include "llvm/ADT/PointerEmbeddedInt.h"
@@ -53,7 +55,7 @@ const uint16_t VERSION_MAJOR = 0;
 /// in source control, you should also update the comment to briefly
 /// describe what change you made. The content of this comment isn't important;
 /// it just ensures a conflict if two people change the module format.
-const uint16_t VERSION_MINOR = 248; // Last change: [nonatomic] attribute
+const uint16_t VERSION_MINOR = 249; // Last change: extension table keys
 
 using DeclID = PointerEmbeddedInt<unsigned, 31>;
 using DeclIDField = BCFixed<31>;
@@ -1432,6 +1434,43 @@ static inline decls_block::RecordKind getKindForTable(const Decl *D) {
   }
 }
 
+/// Computes the key under which the extensions of \p nominal are stored in
+/// a module's extension table.
+///
+/// Types declared in Swift are keyed by their module and the types they are
+/// nested in as well as their name, so that loading the extensions of one
+/// type doesn't deserialize those of every other type with the same name.
+/// Imported Clang types are keyed by name alone, since the module a Clang
+/// declaration is attributed to can depend on how it was found.
+static inline void getExtensionTableKey(const NominalTypeDecl *nominal,
+                                        SmallVectorImpl<char> &key) {
+  key.clear();
+  StringRef name = nominal->getName().str();
+  if (nominal->hasClangNode()) {
+    key.append(name.begin(), name.end());
+    return;
+  }
+
+  SmallVector<StringRef, 4> path;
+  path.push_back(name);
+  const DeclContext *DC = nominal->getDeclContext();
+  while (!DC->isModuleScopeContext()) {
+    if (auto *parent = DC->getAsNominalTypeOrNominalTypeExtensionContext()) {
+      path.push_back(parent->getName().str());
+      DC = parent->getDeclContext();
+    } else {
+      DC = DC->getParent();
+    }
+  }
+  path.push_back(DC->getParentModule()->getName().str());
+
+  for (StringRef component : reversed(path)) {
+    if (!key.empty())
+      key.push_back('.');
+    key.append(component.begin(), component.end());
+  }
+}
+
 /// The record types within the identifier block.
 ///
 /// \sa IDENTIFIER_BLOCK_ID
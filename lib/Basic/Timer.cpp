@@ -11,7 +11,132 @@
 //===----------------------------------------------------------------------===//
 
 #include "swift/Basic/Timer.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#if defined(LLVM_ON_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace swift;
 
 SharedTimer::State SharedTimer::CompilationTimersEnabled = State::Initial;
+
+bool CompilationTrace::Enabled = false;
+
+namespace {
+  struct TraceEvent {
+    std::string Name;
+    std::string Category;
+    uint64_t Start;
+    uint64_t Duration;
+    uint64_t Thread;
+  };
+} // end anonymous namespace
+
+static llvm::sys::Mutex TraceMutex;
+static std::vector<TraceEvent> TraceEvents;
+
+uint64_t CompilationTrace::now() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(
+      system_clock::now().time_since_epoch()).count();
+}
+
+void CompilationTrace::addSpan(StringRef name, StringRef category,
+                               uint64_t start, uint64_t end,
+                               Optional<uint64_t> thread) {
+  if (!thread)
+    thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+  llvm::sys::ScopedLock lock(TraceMutex);
+  TraceEvents.push_back({ name.str(), category.str(), start,
+                          end > start ? end - start : 0, *thread });
+}
+
+static void writeJSONString(raw_ostream &out, StringRef string) {
+  out << '"';
+  for (char c : string) {
+    switch (c) {
+    case '"': out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    case '\t': out << "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+        out << llvm::format("\\u%04x", c);
+      else
+        out << c;
+    }
+  }
+  out << '"';
+}
+
+static unsigned getCurrentProcessID() {
+#if defined(LLVM_ON_WIN32)
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+
+bool CompilationTrace::write(StringRef path, ArrayRef<std::string> merged) {
+  std::error_code error;
+  llvm::raw_fd_ostream out(path, error, llvm::sys::fs::F_None);
+  if (error)
+    return true;
+
+  // Chrome's "JSON Array Format": a list of events, which lets the traces of
+  // several processes be merged by concatenating their elements.
+  out << "[\n";
+  bool first = true;
+  auto separate = [&] {
+    if (!first)
+      out << ",\n";
+    first = false;
+  };
+
+  unsigned pid = getCurrentProcessID();
+  {
+    llvm::sys::ScopedLock lock(TraceMutex);
+    for (const TraceEvent &event : TraceEvents) {
+      separate();
+      out << "{\"ph\": \"X\", \"name\": ";
+      writeJSONString(out, event.Name);
+      out << ", \"cat\": ";
+      writeJSONString(out, event.Category);
+      out << ", \"ts\": " << event.Start << ", \"dur\": " << event.Duration
+          << ", \"pid\": " << pid << ", \"tid\": " << event.Thread << "}";
+    }
+  }
+
+  for (const std::string &mergedPath : merged) {
+    auto buffer = llvm::MemoryBuffer::getFile(mergedPath);
+    if (!buffer)
+      continue;
+    StringRef contents = (*buffer)->getBuffer().trim();
+    if (!contents.startswith("[") || !contents.endswith("]"))
+      continue;
+    contents = contents.drop_front().drop_back().trim();
+    if (contents.empty())
+      continue;
+    separate();
+    out << contents;
+  }
+
+  out << "\n]\n";
+  out.close();
+  if (out.has_error()) {
+    out.clear_error();
+    return true;
+  }
+  return false;
+}
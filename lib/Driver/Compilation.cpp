@@ -16,14 +16,18 @@
 #include "swift/AST/DiagnosticsDriver.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/Program.h"
+#include "swift/Basic/Range.h"
 #include "swift/Basic/TaskQueue.h"
+#include "swift/Basic/Timer.h"
 #include "swift/Basic/Version.h"
 #include "swift/Basic/type_traits.h"
 #include "swift/Driver/Action.h"
 #include "swift/Driver/DependencyGraph.h"
+#include "swift/Driver/DependencyGraphCache.h"
 #include "swift/Driver/Driver.h"
 #include "swift/Driver/Job.h"
 #include "swift/Driver/ParseableOutput.h"
+#include "swift/Driver/ToolChain.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringExtras.h"
@@ -33,6 +37,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/YAMLParser.h"
 
 using namespace swift;
@@ -88,6 +93,11 @@ namespace {
 
 Compilation::~Compilation() = default;
 
+void Compilation::enableBatchMode(const ToolChain &TC, const OutputInfo &OI) {
+  BatchModeToolChain = &TC;
+  BatchModeOutputInfo.reset(new OutputInfo(OI));
+}
+
 Job *Compilation::addJob(std::unique_ptr<Job> J) {
   Job *result = J.get();
   Jobs.emplace_back(std::move(J));
@@ -172,9 +182,57 @@ static void checkForOutOfDateInputs(DiagnosticEngine &diags,
   }
 }
 
+/// Reads how long each input took to compile, in microseconds, from the
+/// compilation record of the previous build.
+///
+/// Only the "durations" entry is read; the rest of the record is validated by
+/// the Driver.
+static void readPreviousDurations(StringRef path,
+                                  llvm::StringMap<uint64_t> &durations) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer)
+    return;
+
+  namespace yaml = llvm::yaml;
+  llvm::SourceMgr SM;
+  yaml::Stream stream(buffer.get()->getMemBufferRef(), SM);
+
+  auto I = stream.begin();
+  if (I == stream.end() || !I->getRoot())
+    return;
+  auto *topLevelMap = dyn_cast<yaml::MappingNode>(I->getRoot());
+  if (!topLevelMap)
+    return;
+
+  SmallString<64> keyScratch;
+  SmallString<64> valueScratch;
+  // FIXME: LLVM's YAML support does incremental parsing in such a way that
+  // for-range loops break.
+  for (auto i = topLevelMap->begin(), e = topLevelMap->end(); i != e; ++i) {
+    auto *key = dyn_cast<yaml::ScalarNode>(i->getKey());
+    if (!key || key->getValue(keyScratch) != "durations")
+      continue;
+
+    auto *durationMap = dyn_cast<yaml::MappingNode>(i->getValue());
+    if (!durationMap)
+      return;
+    for (auto i = durationMap->begin(), e = durationMap->end(); i != e; ++i) {
+      auto *input = dyn_cast<yaml::ScalarNode>(i->getKey());
+      auto *value = dyn_cast<yaml::ScalarNode>(i->getValue());
+      if (!input || !value)
+        return;
+      uint64_t duration;
+      if (value->getValue(valueScratch).getAsInteger(10, duration))
+        return;
+      durations[input->getValue(keyScratch)] = duration;
+    }
+  }
+}
+
 static void writeCompilationRecord(StringRef path, StringRef argsHash,
                                    llvm::sys::TimeValue buildTime,
-                                   const InputInfoMap &inputs) {
+                                   const InputInfoMap &inputs,
+                                   const llvm::StringMap<uint64_t> &durations) {
   std::error_code error;
   llvm::raw_fd_ostream out(path, error, llvm::sys::fs::F_None);
   if (out.has_error()) {
@@ -213,6 +271,113 @@ static void writeCompilationRecord(StringRef path, StringRef argsHash,
     writeTimeValue(out, entry.second.previousModTime);
     out << "\n";
   }
+
+  // How long each input took to compile, in microseconds, for scheduling the
+  // next build.
+  bool wroteDurationsKey = false;
+  for (auto &entry : inputs) {
+    auto iter = durations.find(entry.first->getValue());
+    if (iter == durations.end())
+      continue;
+    if (!wroteDurationsKey) {
+      out << "durations:\n";
+      wroteDurationsKey = true;
+    }
+    out << "  \"" << llvm::yaml::escape(entry.first->getValue()) << "\": "
+        << iter->getValue() << "\n";
+  }
+}
+
+/// Returns the input of a compile job for a single primary file, or null for
+/// any other job.
+static const Arg *getPrimaryInputArg(const Job *Cmd) {
+  auto *CJA = dyn_cast<CompileJobAction>(&Cmd->getSource());
+  if (!CJA || CJA->size() != 1)
+    return nullptr;
+  return &cast<InputAction>(CJA->getInputs().front())->getInputArg();
+}
+
+/// Names the span of the trace covering the task that ran \p Jobs: the kind
+/// of job, followed by the primary inputs, if any.
+static std::string getTraceSpanName(ArrayRef<const Job *> Jobs) {
+  std::string Name = Jobs.front()->getSource().getClassName();
+  const char *Separator = " ";
+  for (const Job *Cmd : Jobs) {
+    if (const Arg *Input = getPrimaryInputArg(Cmd)) {
+      Name += Separator;
+      Name += llvm::sys::path::filename(Input->getValue());
+      Separator = ", ";
+    }
+  }
+  return Name;
+}
+
+/// Estimates how long each compile job will take, from the durations recorded
+/// by the previous build or else from the size of its input.
+///
+/// Sizes are converted to times at the rate observed for the inputs that do
+/// have a recorded duration. Without any, the estimates are just the sizes,
+/// which still order the jobs sensibly.
+static void estimateJobCosts(ArrayRef<const Job *> Jobs,
+                             const llvm::StringMap<uint64_t> &Durations,
+                             llvm::DenseMap<const Job *, uint64_t> &Costs) {
+  SmallVector<std::pair<const Job *, uint64_t>, 16> SizeOnly;
+  uint64_t KnownDuration = 0, KnownSize = 0;
+
+  for (const Job *Cmd : Jobs) {
+    const Arg *Input = getPrimaryInputArg(Cmd);
+    if (!Input)
+      continue;
+
+    uint64_t Size = 0;
+    llvm::sys::fs::file_status Status;
+    if (!llvm::sys::fs::status(Input->getValue(), Status))
+      Size = Status.getSize();
+
+    auto iter = Durations.find(Input->getValue());
+    if (iter == Durations.end()) {
+      SizeOnly.push_back({Cmd, Size});
+      continue;
+    }
+    Costs[Cmd] = iter->getValue();
+    KnownDuration += iter->getValue();
+    KnownSize += Size;
+  }
+
+  for (auto &Entry : SizeOnly) {
+    uint64_t Cost = Entry.second;
+    if (KnownSize != 0)
+      Cost = Cost * KnownDuration / KnownSize;
+    Costs[Entry.first] = Cost;
+  }
+}
+
+/// Computes a scheduling priority for each job: the estimated length of the
+/// longest chain of jobs starting with it. Running the jobs with the longest
+/// remaining chains first keeps large files and the jobs feeding
+/// merge-module and link steps from starting last.
+///
+/// Jobs whose cost isn't known (such as links) count as free; they are at the
+/// end of every chain, so they don't change the order.
+static void computeJobPriorities(
+    ArrayRef<const Job *> Jobs,
+    const llvm::DenseMap<const Job *, uint64_t> &Costs,
+    llvm::DenseMap<const Job *, uint64_t> &Priorities) {
+  auto getCost = [&](const Job *Cmd) -> uint64_t {
+    return Costs.lookup(Cmd);
+  };
+
+  // Each job comes after its inputs, so walking backwards visits every
+  // consumer of a job before the job itself.
+  for (const Job *Cmd : reversed(Jobs)) {
+    uint64_t &Priority = Priorities[Cmd];
+    Priority = std::max(Priority, getCost(Cmd));
+    uint64_t ChainCost = Priority;
+    for (const Job *Input : Cmd->getInputs()) {
+      uint64_t &InputPriority = Priorities[Input];
+      InputPriority = std::max(InputPriority, getCost(Input) + ChainCost);
+    }
+  }
 }
 
 static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
@@ -267,6 +432,71 @@ int Compilation::performJobsImpl() {
   SmallPtrSet<const Job *, 16> DeferredCommands;
   SmallVector<const Job *, 16> InitialOutOfDateCommands;
 
+  // In batch mode, batchable jobs are collected here when they become ready,
+  // and combined into BatchJobs before the TaskQueue next gets to run.
+  SmallVector<const Job *, 16> PendingBatchable;
+  SmallVector<std::unique_ptr<BatchJob>, 4> OwnedBatchJobs;
+  SmallPtrSet<const Job *, 4> BatchJobs;
+
+  // The dependencies of every input are kept next to the compilation record,
+  // so that the next build doesn't have to read and parse every file.
+  DependencyGraphCache DepCache;
+  std::string DepCachePath;
+  if (getIncrementalBuildEnabled() && !CompilationRecordPath.empty()) {
+    DepCachePath = CompilationRecordPath + ".graph";
+    DepCache.loadFromPath(DepCachePath);
+  }
+
+  // Load the dependencies file for a job into DepGraph, using the cached
+  // contents if \p AllowCached is set and the file hasn't changed since.
+  auto loadDependencies = [&](const Job *Cmd, StringRef DependenciesFile,
+                              bool AllowCached)
+      -> DependencyGraphImpl::LoadResult {
+    if (AllowCached)
+      if (auto Cached = DepCache.lookup(DependenciesFile))
+        return DepGraph.loadFromBuffer(Cmd, *Cached);
+
+    // Stat before reading, so that a concurrent change can only make the
+    // cache entry look out of date.
+    llvm::sys::fs::file_status Status;
+    bool HaveStatus = !llvm::sys::fs::status(DependenciesFile, Status);
+    auto Buffer = llvm::MemoryBuffer::getFile(DependenciesFile);
+    if (!Buffer)
+      return DependencyGraphImpl::LoadResult::HadError;
+
+    // Parse the file once, into the binary format that is cached, and load
+    // the graph from that.
+    std::string Encoded;
+    {
+      llvm::raw_string_ostream Out(Encoded);
+      if (!DependencyGraphImpl::encodeAsBinary(**Buffer, Out))
+        return DependencyGraphImpl::LoadResult::HadError;
+    }
+    auto EncodedBuffer =
+      llvm::MemoryBuffer::getMemBufferCopy(Encoded, DependenciesFile);
+    auto Result = DepGraph.loadFromBuffer(Cmd, *EncodedBuffer);
+    if (HaveStatus && Result != DependencyGraphImpl::LoadResult::HadError)
+      DepCache.update(DependenciesFile, Status, std::move(EncodedBuffer));
+    return Result;
+  };
+
+  // How long each input took to compile in the previous build, and in this
+  // one, in microseconds.
+  llvm::StringMap<uint64_t> PreviousDurations;
+  llvm::StringMap<uint64_t> Durations;
+  if (!CompilationRecordPath.empty())
+    readPreviousDurations(CompilationRecordPath, PreviousDurations);
+
+  // With more than one job slot, start the jobs on the longest chains first.
+  // With just one, the order doesn't change how long the build takes.
+  llvm::DenseMap<const Job *, uint64_t> JobCosts;
+  llvm::DenseMap<const Job *, uint64_t> JobPriorities;
+  if (NumberOfParallelCommands > 1) {
+    SmallVector<const Job *, 16> AllJobs(getJobs().begin(), getJobs().end());
+    estimateJobCosts(AllJobs, PreviousDurations, JobCosts);
+    computeJobPriorities(AllJobs, JobCosts, JobPriorities);
+  }
+
   DependencyGraph::MarkTracer ActualIncrementalTracer;
   DependencyGraph::MarkTracer *IncrementalTracer = nullptr;
   if (ShowIncrementalBuildDecisions)
@@ -307,8 +537,77 @@ int Compilation::performJobsImpl() {
     assert(Cmd->getExtraEnvironment().empty() &&
            "not implemented for compilations with multiple jobs");
     State.ScheduledCommands.insert(Cmd);
+    if (BatchModeToolChain && BatchModeToolChain->jobIsBatchable(Cmd)) {
+      PendingBatchable.push_back(Cmd);
+      return;
+    }
     TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
-                (void *)Cmd);
+                (void *)Cmd, JobPriorities.lookup(Cmd));
+  };
+
+  // Hand the batchable jobs that have become ready to the TaskQueue, split
+  // into at most one BatchJob per parallel command.
+  auto flushPendingBatchable = [&] {
+    if (PendingBatchable.empty())
+      return;
+
+    size_t NumBatches = std::min<size_t>(std::max(NumberOfParallelCommands, 1U),
+                                         PendingBatchable.size());
+
+    // Give each batch about the same estimated amount of work: take the most
+    // expensive jobs first, and add each to the batch with the least work so
+    // far (or the fewest jobs, if the costs are equal).
+    std::stable_sort(PendingBatchable.begin(), PendingBatchable.end(),
+                     [&](const Job *lhs, const Job *rhs) {
+      return JobCosts.lookup(lhs) > JobCosts.lookup(rhs);
+    });
+    SmallVector<SmallVector<const Job *, 8>, 4> Batches(NumBatches);
+    SmallVector<std::pair<uint64_t, size_t>, 4> BatchSizes(NumBatches);
+    for (const Job *Cmd : PendingBatchable) {
+      size_t Smallest = std::min_element(BatchSizes.begin(), BatchSizes.end()) -
+                        BatchSizes.begin();
+      Batches[Smallest].push_back(Cmd);
+      BatchSizes[Smallest].first += JobCosts.lookup(Cmd);
+      BatchSizes[Smallest].second += 1;
+    }
+
+    for (ArrayRef<const Job *> Batch : Batches) {
+      // A batch is as urgent as its most urgent job, plus the work of the
+      // jobs it runs alongside.
+      uint64_t Priority = 0;
+      uint64_t BatchCost = 0;
+      for (const Job *Cmd : Batch) {
+        uint64_t Cost = JobCosts.lookup(Cmd);
+        BatchCost += Cost;
+        Priority = std::max(Priority, JobPriorities.lookup(Cmd) - Cost);
+      }
+      Priority += BatchCost;
+
+      const Job *Cmd = Batch.front();
+      if (Batch.size() > 1) {
+        auto Combined = BatchModeToolChain->constructBatchJob(
+            Batch, *this, *BatchModeOutputInfo);
+        Cmd = Combined.get();
+        BatchJobs.insert(Cmd);
+        OwnedBatchJobs.push_back(std::move(Combined));
+
+        // FIXME: Failing here should not take down the whole process.
+        bool success = writeFilelistIfNecessary(Cmd, Diags);
+        assert(success && "failed to write filelist");
+        (void)success;
+      }
+      TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
+                  (void *)Cmd, Priority);
+    }
+    PendingBatchable.clear();
+  };
+
+  // Returns the jobs a task performs: the combined jobs of a BatchJob, or
+  // just the task's own job (which must outlive the returned array).
+  auto getCombinedJobs = [&](const Job *const &Cmd) -> ArrayRef<const Job *> {
+    if (BatchJobs.count(Cmd))
+      return static_cast<const BatchJob *>(Cmd)->getCombinedJobs();
+    return Cmd;
   };
 
   // When a task finishes, we need to reevaluate the other commands that
@@ -344,7 +643,8 @@ int Compilation::performJobsImpl() {
       if (Cmd->getCondition() == Job::Condition::NewlyAdded) {
         DepGraph.addIndependentNode(Cmd);
       } else {
-        switch (DepGraph.loadFromPath(Cmd, DependenciesFile)) {
+        switch (loadDependencies(Cmd, DependenciesFile,
+                                 /*AllowCached=*/true)) {
         case DependencyGraphImpl::LoadResult::HadError:
           disableIncrementalBuild();
           for (const Job *Cmd : DeferredCommands)
@@ -422,18 +722,93 @@ int Compilation::performJobsImpl() {
 
   int Result = EXIT_SUCCESS;
 
+  // When each running task started.
+  llvm::DenseMap<const Job *, llvm::sys::TimeValue> TaskStartTimes;
+
+  // Returns how long the task for \p Cmd ran, in microseconds, and records
+  // it in the trace, if any, in the row for its process.
+  auto getTaskDuration = [&](const Job *Cmd, ProcessId Pid) -> uint64_t {
+    auto iter = TaskStartTimes.find(Cmd);
+    assert(iter != TaskStartTimes.end() && "task never began");
+    uint64_t Duration = (llvm::sys::TimeValue::now() - iter->second).usec();
+    TaskStartTimes.erase(iter);
+    if (CompilationTrace::isEnabled()) {
+      uint64_t End = CompilationTrace::now();
+      CompilationTrace::addSpan(getTraceSpanName(getCombinedJobs(Cmd)), "job",
+                                End - std::min(Duration, End), End,
+                                static_cast<uint64_t>(Pid));
+    }
+    return Duration;
+  };
+
+  // The wall time to report in parseable output, in seconds. Tasks that are
+  // only simulated don't report any.
+  auto getReportedWallTime = [&](uint64_t Duration) -> Optional<double> {
+    if (SkipTaskExecution)
+      return None;
+    return Duration / 1e6;
+  };
+
   // Set up a callback which will be called immediately after a task has
   // started. This callback may be used to provide output indicating that the
   // task began.
-  auto taskBegan = [this] (ProcessId Pid, void *Context) {
+  auto taskBegan = [&] (ProcessId Pid, void *Context) {
     // TODO: properly handle task began.
     const Job *BeganCmd = (const Job *)Context;
+    TaskStartTimes[BeganCmd] = llvm::sys::TimeValue::now();
 
     // For verbose output, print out each command as it begins execution.
     if (Level == OutputLevel::Verbose)
       BeganCmd->printCommandLine(llvm::errs());
     else if (Level == OutputLevel::Parseable)
-      parseable_output::emitBeganMessage(llvm::errs(), *BeganCmd, Pid);
+      for (const Job *Cmd : getCombinedJobs(BeganCmd))
+        parseable_output::emitBeganMessage(llvm::errs(), *Cmd, Pid);
+  };
+
+  // Called for each job that ran successfully, including each job combined
+  // into a BatchJob.
+  auto jobFinished = [&] (const Job *FinishedCmd) {
+    // When a task finishes, we need to reevaluate the other commands that
+    // might have been blocked.
+    markFinished(FinishedCmd);
+
+    // In order to handle both old dependencies that have disappeared and new
+    // dependencies that have arisen, we need to reload the dependency file.
+    if (getIncrementalBuildEnabled()) {
+      const CommandOutput &Output = FinishedCmd->getOutput();
+      StringRef DependenciesFile =
+        Output.getAdditionalOutputForType(types::TY_SwiftDeps);
+      if (!DependenciesFile.empty()) {
+        SmallVector<const Job *, 16> Dependents;
+        bool wasCascading = DepGraph.isMarked(FinishedCmd);
+
+        // The job has just rewritten this file, possibly within the
+        // resolution of its timestamp, so don't trust the cache.
+        switch (loadDependencies(FinishedCmd, DependenciesFile,
+                                 /*AllowCached=*/false)) {
+        case DependencyGraphImpl::LoadResult::HadError:
+          disableIncrementalBuild();
+          for (const Job *Cmd : DeferredCommands)
+            scheduleCommandIfNecessaryAndPossible(Cmd);
+          DeferredCommands.clear();
+          Dependents.clear();
+          break;
+        case DependencyGraphImpl::LoadResult::UpToDate:
+          if (!wasCascading)
+            break;
+          SWIFT_FALLTHROUGH;
+        case DependencyGraphImpl::LoadResult::AffectsDownstream:
+          DepGraph.markTransitive(Dependents, FinishedCmd);
+          break;
+        }
+
+        for (const Job *Cmd : Dependents) {
+          DeferredCommands.erase(Cmd);
+          noteBuilding(Cmd, "because of dependencies discovered later");
+          scheduleCommandIfNecessaryAndPossible(Cmd);
+        }
+      }
+    }
   };
 
   // Set up a callback which will be called immediately after a task has
@@ -444,11 +819,19 @@ int Compilation::performJobsImpl() {
   auto taskFinished = [&] (ProcessId Pid, int ReturnCode, StringRef Output,
                            void *Context) -> TaskFinishedResponse {
     const Job *FinishedCmd = (const Job *)Context;
+    uint64_t Duration = getTaskDuration(FinishedCmd, Pid);
+    ArrayRef<const Job *> CombinedJobs = getCombinedJobs(FinishedCmd);
 
     if (Level == OutputLevel::Parseable) {
-      // Parseable output was requested.
-      parseable_output::emitFinishedMessage(llvm::errs(), *FinishedCmd, Pid,
-                                            ReturnCode, Output);
+      // Parseable output was requested. The output of a BatchJob can't be
+      // split up, so it's attributed to the first of the combined jobs.
+      StringRef CmdOutput = Output;
+      for (const Job *Cmd : CombinedJobs) {
+        parseable_output::emitFinishedMessage(llvm::errs(), *Cmd, Pid,
+                                              ReturnCode, CmdOutput,
+                                              getReportedWallTime(Duration));
+        CmdOutput = StringRef();
+      }
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -477,44 +860,15 @@ int Compilation::performJobsImpl() {
           TaskFinishedResponse::StopExecution;
     }
 
-    // When a task finishes, we need to reevaluate the other commands that
-    // might have been blocked.
-    markFinished(FinishedCmd);
+    // Remember how long each file took for the next build. The time of a
+    // BatchJob is split evenly among its jobs.
+    for (const Job *Cmd : CombinedJobs)
+      if (const Arg *Input = getPrimaryInputArg(Cmd))
+        Durations[Input->getValue()] = Duration / CombinedJobs.size();
 
-    // In order to handle both old dependencies that have disappeared and new
-    // dependencies that have arisen, we need to reload the dependency file.
-    if (getIncrementalBuildEnabled()) {
-      const CommandOutput &Output = FinishedCmd->getOutput();
-      StringRef DependenciesFile =
-        Output.getAdditionalOutputForType(types::TY_SwiftDeps);
-      if (!DependenciesFile.empty()) {
-        SmallVector<const Job *, 16> Dependents;
-        bool wasCascading = DepGraph.isMarked(FinishedCmd);
-
-        switch (DepGraph.loadFromPath(FinishedCmd, DependenciesFile)) {
-        case DependencyGraphImpl::LoadResult::HadError:
-          disableIncrementalBuild();
-          for (const Job *Cmd : DeferredCommands)
-            scheduleCommandIfNecessaryAndPossible(Cmd);
-          DeferredCommands.clear();
-          Dependents.clear();
-          break;
-        case DependencyGraphImpl::LoadResult::UpToDate:
-          if (!wasCascading)
-            break;
-          SWIFT_FALLTHROUGH;
-        case DependencyGraphImpl::LoadResult::AffectsDownstream:
-          DepGraph.markTransitive(Dependents, FinishedCmd);
-          break;
-        }
-
-        for (const Job *Cmd : Dependents) {
-          DeferredCommands.erase(Cmd);
-          noteBuilding(Cmd, "because of dependencies discovered later");
-          scheduleCommandIfNecessaryAndPossible(Cmd);
-        }
-      }
-    }
+    for (const Job *Cmd : CombinedJobs)
+      jobFinished(Cmd);
+    flushPendingBatchable();
 
     return TaskFinishedResponse::ContinueExecution;
   };
@@ -522,11 +876,17 @@ int Compilation::performJobsImpl() {
   auto taskSignalled = [&] (ProcessId Pid, StringRef ErrorMsg, StringRef Output,
                             void *Context) -> TaskFinishedResponse {
     const Job *SignalledCmd = (const Job *)Context;
+    uint64_t Duration = getTaskDuration(SignalledCmd, Pid);
 
     if (Level == OutputLevel::Parseable) {
       // Parseable output was requested.
-      parseable_output::emitSignalledMessage(llvm::errs(), *SignalledCmd, Pid,
-                                             ErrorMsg, Output);
+      StringRef CmdOutput = Output;
+      for (const Job *Cmd : getCombinedJobs(SignalledCmd)) {
+        parseable_output::emitSignalledMessage(llvm::errs(), *Cmd, Pid,
+                                               ErrorMsg, CmdOutput,
+                                               getReportedWallTime(Duration));
+        CmdOutput = StringRef();
+      }
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -547,6 +907,7 @@ int Compilation::performJobsImpl() {
     return TaskFinishedResponse::StopExecution;
   };
 
+  flushPendingBatchable();
   do {
     // Ask the TaskQueue to execute.
     TQ->execute(taskBegan, taskFinished, taskSignalled);
@@ -562,6 +923,7 @@ int Compilation::performJobsImpl() {
       State.ScheduledCommands.insert(Cmd);
       markFinished(Cmd);
     }
+    flushPendingBatchable();
 
     // ...which may allow us to go on and do later tasks.
   } while (Result == 0 && TQ->hasRemainingTasks());
@@ -595,8 +957,14 @@ int Compilation::performJobsImpl() {
     InputInfoMap InputInfo;
     populateInputInfoMap(InputInfo, State);
     checkForOutOfDateInputs(Diags, InputInfo);
+    // Keep the previous durations of files that didn't need to be rebuilt.
+    for (auto &Entry : PreviousDurations)
+      Durations.insert({Entry.getKey(), Entry.getValue()});
     writeCompilationRecord(CompilationRecordPath, ArgsHash, BuildStartTime,
-                           InputInfo);
+                           InputInfo, Durations);
+
+    if (getIncrementalBuildEnabled() && !DepCachePath.empty())
+      DepCache.writeToPath(DepCachePath, BuildStartTime);
   }
 
   if (Result == 0)
@@ -665,7 +1033,7 @@ int Compilation::performJobs() {
   // If we don't have to do any cleanup work, just exec the subprocess.
   if (Level < OutputLevel::Parseable &&
       (SaveTemps || TempFilePaths.empty()) &&
-      CompilationRecordPath.empty() &&
+      CompilationRecordPath.empty() && TraceFilePath.empty() &&
       Jobs.size() == 1) {
     return performSingleCommand(Jobs.front().get());
   }
@@ -674,8 +1042,20 @@ int Compilation::performJobs() {
     Diags.diagnose(SourceLoc(), diag::warning_parallel_execution_not_supported);
   }
   
+  uint64_t TraceStartTime = 0;
+  if (CompilationTrace::isEnabled())
+    TraceStartTime = CompilationTrace::now();
+
   int result = performJobsImpl();
 
+  if (!TraceFilePath.empty()) {
+    CompilationTrace::addSpan("Compilation", "process", TraceStartTime,
+                              CompilationTrace::now());
+    if (CompilationTrace::write(TraceFilePath, JobTraceFilePaths))
+      Diags.diagnose(SourceLoc(), diag::warning_cannot_write_trace_file,
+                     TraceFilePath);
+  }
+
   if (!SaveTemps) {
     // FIXME: Do we want to be deleting temporaries even when a child process
     // crashes?
@@ -0,0 +1,105 @@
+//===--- DependencyFileFormat.cpp - Swift reference dependency files ------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/DependencyFileFormat.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/YAMLParser.h"
+
+using namespace swift;
+using namespace swift::dependency_file;
+
+StringRef dependency_file::getSectionName(Section section) {
+  switch (section) {
+  case Section::ProvidesTopLevel: return "provides-top-level";
+  case Section::ProvidesNominal: return "provides-nominal";
+  case Section::ProvidesMember: return "provides-member";
+  case Section::ProvidesDynamicLookup: return "provides-dynamic-lookup";
+  case Section::DependsTopLevel: return "depends-top-level";
+  case Section::DependsMember: return "depends-member";
+  case Section::DependsNominal: return "depends-nominal";
+  case Section::DependsDynamicLookup: return "depends-dynamic-lookup";
+  case Section::DependsExternal: return "depends-external";
+  }
+  llvm_unreachable("unhandled section");
+}
+
+uint32_t Writer::intern(StringRef string) {
+  auto insertResult = StringIndices.insert({string, Strings.size()});
+  if (insertResult.second)
+    Strings.push_back(insertResult.first->getKey());
+  return insertResult.first->getValue();
+}
+
+void Writer::writeYAML(raw_ostream &out) const {
+  out << "### Swift dependencies file v0 ###\n";
+
+  for (auto &section : Sections) {
+    out << getSectionName(section.kind) << ":\n";
+    for (auto &entry : section.entries) {
+      out << "- ";
+      if (!entry.isCascading)
+        out << "!private ";
+      if (entry.member == NoStringIndex) {
+        out << "\"" << llvm::yaml::escape(Strings[entry.name]) << "\"\n";
+      } else {
+        out << "[\"" << llvm::yaml::escape(Strings[entry.name]) << "\", \""
+            << llvm::yaml::escape(Strings[entry.member]) << "\"]\n";
+      }
+    }
+  }
+
+  if (InterfaceHash != NoStringIndex)
+    out << "interface-hash: \"" << Strings[InterfaceHash] << "\"\n";
+}
+
+void Writer::writeBinary(raw_ostream &out) const {
+  llvm::support::endian::Writer<llvm::support::little> words(out);
+
+  uint32_t numEntries = 0;
+  for (auto &section : Sections)
+    numEntries += section.entries.size();
+  uint32_t stringDataSize = 0;
+  for (StringRef string : Strings)
+    stringDataSize += string.size();
+
+  out.write(BinaryMagic, sizeof(BinaryMagic));
+  words.write<uint32_t>(BinaryVersion);
+  words.write<uint32_t>(Strings.size());
+  words.write<uint32_t>(Sections.size());
+  words.write<uint32_t>(numEntries);
+  words.write<uint32_t>(InterfaceHash);
+  words.write<uint32_t>(stringDataSize);
+
+  uint32_t offset = 0;
+  for (StringRef string : Strings) {
+    words.write<uint32_t>(offset);
+    offset += string.size();
+  }
+
+  for (auto &section : Sections) {
+    words.write<uint32_t>(static_cast<uint32_t>(section.kind));
+    words.write<uint32_t>(section.entries.size());
+  }
+
+  for (auto &section : Sections) {
+    for (auto &entry : section.entries) {
+      words.write<uint32_t>(entry.name);
+      words.write<uint32_t>(entry.member);
+      words.write<uint32_t>(entry.isCascading);
+    }
+  }
+
+  for (StringRef string : Strings)
+    out << string;
+}
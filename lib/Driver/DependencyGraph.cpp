@@ -12,10 +12,12 @@
 
 #include "swift/Driver/DependencyGraph.h"
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Driver/DependencyFileFormat.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
@@ -49,14 +51,26 @@ using DependencyKind = DependencyGraphImpl::DependencyKind;
 using DependencyCallbackTy = LoadResult(StringRef, DependencyKind, bool);
 using InterfaceHashCallbackTy = LoadResult(StringRef);
 
+// After an entry, we know more about the node as a whole.
+// Update the "result" variable in the enclosing function.
+// This is a macro rather than a lambda because it contains a return.
+#define UPDATE_RESULT(update) switch (update) {\
+    case LoadResult::HadError: \
+      return LoadResult::HadError; \
+    case LoadResult::UpToDate: \
+      break; \
+    case LoadResult::AffectsDownstream: \
+      result = LoadResult::AffectsDownstream; \
+      break; \
+    } \
+
 static LoadResult
-parseDependencyFile(llvm::MemoryBuffer &buffer,
-                    llvm::function_ref<DependencyCallbackTy> providesCallback,
-                    llvm::function_ref<DependencyCallbackTy> dependsCallback,
-                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+parseYAMLDependencyFile(llvm::MemoryBuffer &buffer,
+                        llvm::function_ref<DependencyCallbackTy> providesCallback,
+                        llvm::function_ref<DependencyCallbackTy> dependsCallback,
+                        llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
   namespace yaml = llvm::yaml;
 
-  // FIXME: Switch to a format other than YAML.
   llvm::SourceMgr SM;
   yaml::Stream stream(buffer.getMemBufferRef(), SM);
   auto I = stream.begin();
@@ -73,19 +87,6 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
   LoadResult result = LoadResult::UpToDate;
   SmallString<64> scratch;
 
-  // After an entry, we know more about the node as a whole.
-  // Update the "result" variable above.
-  // This is a macro rather than a lambda because it contains a return.
-#define UPDATE_RESULT(update) switch (update) {\
-    case LoadResult::HadError: \
-      return LoadResult::HadError; \
-    case LoadResult::UpToDate: \
-      break; \
-    case LoadResult::AffectsDownstream: \
-      result = LoadResult::AffectsDownstream; \
-      break; \
-    } \
-
   // FIXME: LLVM's YAML support does incremental parsing in such a way that
   // for-range loops break.
   for (auto i = topLevelMap->begin(), e = topLevelMap->end(); i != e; ++i) {
@@ -206,6 +207,257 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
   return result;
 }
 
+/// Reads the binary format described in DependencyFileFormat.h.
+static LoadResult
+parseBinaryDependencyFile(StringRef data,
+                          llvm::function_ref<DependencyCallbackTy> providesCallback,
+                          llvm::function_ref<DependencyCallbackTy> dependsCallback,
+                          llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+  namespace format = swift::dependency_file;
+  using namespace llvm::support;
+
+  // Validate all the sizes up front, so that the loops below can read without
+  // further checks.
+  const size_t wordSize = sizeof(uint32_t);
+  const size_t headerSize =
+    sizeof(format::BinaryMagic) + format::HeaderWords * wordSize;
+  if (data.size() < headerSize)
+    return LoadResult::HadError;
+
+  const char *cursor = data.data() + sizeof(format::BinaryMagic);
+  auto readWord = [&cursor]() -> uint32_t {
+    uint32_t word = endian::read<uint32_t, little, unaligned>(cursor);
+    cursor += sizeof(uint32_t);
+    return word;
+  };
+
+  if (readWord() != format::BinaryVersion)
+    return LoadResult::HadError;
+  uint64_t numStrings = readWord();
+  uint64_t numSections = readWord();
+  uint64_t numEntries = readWord();
+  uint32_t interfaceHash = readWord();
+  uint64_t stringDataSize = readWord();
+
+  uint64_t expectedSize = headerSize + numStrings * wordSize +
+    numSections * format::SectionWords * wordSize +
+    numEntries * format::EntryWords * wordSize + stringDataSize;
+  if (data.size() != expectedSize)
+    return LoadResult::HadError;
+
+  const char *stringOffsets = cursor;
+  const char *stringData = data.data() + data.size() - stringDataSize;
+  auto getString = [&](uint32_t index, StringRef &out) -> bool {
+    if (index >= numStrings)
+      return false;
+    auto offsetAt = [stringOffsets](uint64_t i) -> uint32_t {
+      return endian::read<uint32_t, little, unaligned>(stringOffsets +
+                                                       i * sizeof(uint32_t));
+    };
+    uint32_t begin = offsetAt(index);
+    uint32_t end = index + 1 == numStrings ? stringDataSize
+                                           : offsetAt(index + 1);
+    if (begin > end || end > stringDataSize)
+      return false;
+    out = StringRef(stringData + begin, end - begin);
+    return true;
+  };
+  cursor += numStrings * wordSize;
+
+  const char *sections = cursor;
+  cursor += numSections * format::SectionWords * wordSize;
+
+  LoadResult result = LoadResult::UpToDate;
+  SmallString<64> appended;
+  uint64_t entriesRemaining = numEntries;
+
+  for (uint64_t i = 0; i != numSections; ++i) {
+    const char *sectionHeader = sections + i * format::SectionWords * wordSize;
+    uint32_t rawKind =
+      endian::read<uint32_t, little, unaligned>(sectionHeader);
+    uint32_t sectionEntries =
+      endian::read<uint32_t, little, unaligned>(sectionHeader + wordSize);
+    if (rawKind > static_cast<uint32_t>(format::Section::Last_Section) ||
+        sectionEntries > entriesRemaining)
+      return LoadResult::HadError;
+    entriesRemaining -= sectionEntries;
+
+    DependencyKind kind;
+    bool isDepends;
+    switch (static_cast<format::Section>(rawKind)) {
+    case format::Section::ProvidesTopLevel:
+      kind = DependencyKind::TopLevelName;
+      isDepends = false;
+      break;
+    case format::Section::ProvidesNominal:
+      kind = DependencyKind::NominalType;
+      isDepends = false;
+      break;
+    case format::Section::ProvidesMember:
+      kind = DependencyKind::NominalTypeMember;
+      isDepends = false;
+      break;
+    case format::Section::ProvidesDynamicLookup:
+      kind = DependencyKind::DynamicLookupName;
+      isDepends = false;
+      break;
+    case format::Section::DependsTopLevel:
+      kind = DependencyKind::TopLevelName;
+      isDepends = true;
+      break;
+    case format::Section::DependsMember:
+      kind = DependencyKind::NominalTypeMember;
+      isDepends = true;
+      break;
+    case format::Section::DependsNominal:
+      kind = DependencyKind::NominalType;
+      isDepends = true;
+      break;
+    case format::Section::DependsDynamicLookup:
+      kind = DependencyKind::DynamicLookupName;
+      isDepends = true;
+      break;
+    case format::Section::DependsExternal:
+      kind = DependencyKind::ExternalFile;
+      isDepends = true;
+      break;
+    }
+    auto &callback = isDepends ? dependsCallback : providesCallback;
+
+    for (uint32_t j = 0; j != sectionEntries; ++j) {
+      uint32_t nameIndex = readWord();
+      uint32_t memberIndex = readWord();
+      bool isCascading = readWord() != 0;
+
+      StringRef name;
+      if (!getString(nameIndex, name))
+        return LoadResult::HadError;
+
+      if (kind == DependencyKind::NominalTypeMember) {
+        // Smash the type and member names together, as in the YAML format.
+        StringRef member;
+        if (!getString(memberIndex, member))
+          return LoadResult::HadError;
+        appended = name;
+        appended.push_back('\0');
+        appended += member;
+        UPDATE_RESULT(callback(appended.str(), kind, isCascading));
+      } else {
+        if (memberIndex != format::NoStringIndex)
+          return LoadResult::HadError;
+        UPDATE_RESULT(callback(name, kind, isCascading));
+      }
+    }
+  }
+
+  if (entriesRemaining != 0)
+    return LoadResult::HadError;
+
+  if (interfaceHash != format::NoStringIndex) {
+    StringRef hash;
+    if (!getString(interfaceHash, hash))
+      return LoadResult::HadError;
+    UPDATE_RESULT(interfaceHashCallback(hash));
+  }
+
+  return result;
+}
+
+#undef UPDATE_RESULT
+
+static LoadResult
+parseDependencyFile(llvm::MemoryBuffer &buffer,
+                    llvm::function_ref<DependencyCallbackTy> providesCallback,
+                    llvm::function_ref<DependencyCallbackTy> dependsCallback,
+                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+  if (dependency_file::isBinaryDependencyFile(buffer.getBuffer())) {
+    return parseBinaryDependencyFile(buffer.getBuffer(), providesCallback,
+                                     dependsCallback, interfaceHashCallback);
+  }
+  return parseYAMLDependencyFile(buffer, providesCallback, dependsCallback,
+                                 interfaceHashCallback);
+}
+
+bool DependencyGraphImpl::encodeAsBinary(llvm::MemoryBuffer &buffer,
+                                         raw_ostream &out) {
+  namespace format = swift::dependency_file;
+
+  if (format::isBinaryDependencyFile(buffer.getBuffer())) {
+    // Validate the file before passing it on.
+    auto ignore = [](StringRef, DependencyKind, bool) {
+      return LoadResult::UpToDate;
+    };
+    auto ignoreHash = [](StringRef) { return LoadResult::UpToDate; };
+    if (parseBinaryDependencyFile(buffer.getBuffer(), ignore, ignore,
+                                  ignoreHash) == LoadResult::HadError)
+      return false;
+    out << buffer.getBuffer();
+    return true;
+  }
+
+  auto getSection = [](DependencyKind kind, bool isDepends) {
+    switch (kind) {
+    case DependencyKind::TopLevelName:
+      return isDepends ? format::Section::DependsTopLevel
+                       : format::Section::ProvidesTopLevel;
+    case DependencyKind::DynamicLookupName:
+      return isDepends ? format::Section::DependsDynamicLookup
+                       : format::Section::ProvidesDynamicLookup;
+    case DependencyKind::NominalType:
+      return isDepends ? format::Section::DependsNominal
+                       : format::Section::ProvidesNominal;
+    case DependencyKind::NominalTypeMember:
+      return isDepends ? format::Section::DependsMember
+                       : format::Section::ProvidesMember;
+    case DependencyKind::ExternalFile:
+      assert(isDepends && "external files are never provided");
+      return format::Section::DependsExternal;
+    }
+    llvm_unreachable("bad dependency kind");
+  };
+
+  // Entries arrive section by section, in the order of the YAML keys.
+  format::Writer writer;
+  bool hasSection = false;
+  format::Section currentSection;
+  auto addEntry = [&](StringRef name, DependencyKind kind, bool isCascading,
+                      bool isDepends) {
+    format::Section section = getSection(kind, isDepends);
+    if (!hasSection || section != currentSection) {
+      writer.beginSection(section);
+      currentSection = section;
+      hasSection = true;
+    }
+    if (kind == DependencyKind::NominalTypeMember) {
+      // Split the names smashed together by the parser.
+      auto baseAndMember = name.split('\0');
+      writer.addMember(baseAndMember.first, baseAndMember.second,
+                       isCascading);
+    } else {
+      writer.addName(name, isCascading);
+    }
+    return LoadResult::UpToDate;
+  };
+  auto providesCallback = [&](StringRef name, DependencyKind kind,
+                              bool isCascading) {
+    return addEntry(name, kind, isCascading, /*isDepends=*/false);
+  };
+  auto dependsCallback = [&](StringRef name, DependencyKind kind,
+                             bool isCascading) {
+    return addEntry(name, kind, isCascading, /*isDepends=*/true);
+  };
+  auto interfaceHashCallback = [&](StringRef hash) {
+    writer.setInterfaceHash(hash);
+    return LoadResult::UpToDate;
+  };
+
+  if (parseYAMLDependencyFile(buffer, providesCallback, dependsCallback,
+                              interfaceHashCallback) == LoadResult::HadError)
+    return false;
+  writer.writeBinary(out);
+  return true;
+}
+
 LoadResult DependencyGraphImpl::loadFromPath(const void *node, StringRef path) {
   auto buffer = llvm::MemoryBuffer::getFile(path);
   if (!buffer)
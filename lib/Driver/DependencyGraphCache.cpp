@@ -0,0 +1,222 @@
+//===--- DependencyGraphCache.cpp - Persisted dependency data -------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/DependencyGraphCache.h"
+#include "swift/Basic/Version.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace swift;
+
+// The file is a sequence of little-endian fields:
+//
+//   magic, version string, build time (seconds, nanoseconds), entry count
+//   { path, modification time (seconds, nanoseconds), size, data }[count]
+//
+// where strings and data are a 32-bit length followed by the bytes.
+static const char CacheMagic[4] = { '\xDE', 'S', 'D', 'G' };
+
+bool DependencyGraphCache::loadFromPath(StringRef path) {
+  Entries.clear();
+  Changed = false;
+
+  auto bufferOrError = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                                   /*RequiresNullTerminator=*/
+                                                   false);
+  if (!bufferOrError)
+    return false;
+  std::unique_ptr<llvm::MemoryBuffer> buffer = std::move(*bufferOrError);
+
+  StringRef data = buffer->getBuffer();
+  const char *cursor = data.begin();
+  bool ok = true;
+
+  auto remaining = [&]() -> size_t { return data.end() - cursor; };
+  auto readBytes = [&](size_t count) -> StringRef {
+    if (!ok || remaining() < count) {
+      ok = false;
+      return StringRef();
+    }
+    StringRef result(cursor, count);
+    cursor += count;
+    return result;
+  };
+  auto read32 = [&]() -> uint32_t {
+    StringRef bytes = readBytes(sizeof(uint32_t));
+    if (!ok)
+      return 0;
+    using namespace llvm::support;
+    return endian::read<uint32_t, little, unaligned>(bytes.data());
+  };
+  auto read64 = [&]() -> uint64_t {
+    StringRef bytes = readBytes(sizeof(uint64_t));
+    if (!ok)
+      return 0;
+    using namespace llvm::support;
+    return endian::read<uint64_t, little, unaligned>(bytes.data());
+  };
+  auto readString = [&]() -> StringRef {
+    uint32_t length = read32();
+    return readBytes(length);
+  };
+  auto readTime = [&]() -> llvm::sys::TimeValue {
+    int64_t seconds = read64();
+    int32_t nanoseconds = read32();
+    return llvm::sys::TimeValue(seconds, nanoseconds);
+  };
+
+  if (readBytes(sizeof(CacheMagic)) != StringRef(CacheMagic,
+                                                 sizeof(CacheMagic)))
+    return false;
+  if (readString() != version::getSwiftFullVersion())
+    return false;
+  llvm::sys::TimeValue buildTime = readTime();
+  uint32_t count = read32();
+
+  for (uint32_t i = 0; ok && i != count; ++i) {
+    StringRef entryPath = readString();
+    llvm::sys::TimeValue modTime = readTime();
+    uint64_t size = read64();
+    StringRef entryData = readString();
+    if (ok)
+      Entries[entryPath] = { modTime, size, entryData, /*Used=*/false };
+  }
+
+  if (!ok || remaining() != 0) {
+    Entries.clear();
+    return false;
+  }
+
+  LoadedBuildTime = buildTime;
+  Buffers.push_back(std::move(buffer));
+  return true;
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+DependencyGraphCache::lookup(StringRef path) {
+  auto iter = Entries.find(path);
+  if (iter == Entries.end())
+    return nullptr;
+  Entry &entry = iter->getValue();
+
+  // A file modified while the previous build was running may have been
+  // rewritten within the resolution of its timestamp.
+  if (!(entry.ModTime < LoadedBuildTime))
+    return nullptr;
+
+  llvm::sys::fs::file_status status;
+  if (llvm::sys::fs::status(path, status))
+    return nullptr;
+  if (status.getLastModificationTime() != entry.ModTime ||
+      status.getSize() != entry.Size)
+    return nullptr;
+
+  entry.Used = true;
+  return llvm::MemoryBuffer::getMemBuffer(entry.Data, path,
+                                          /*RequiresNullTerminator=*/false);
+}
+
+void DependencyGraphCache::update(StringRef path,
+                                  const llvm::sys::fs::file_status &status,
+                                  std::unique_ptr<llvm::MemoryBuffer> buffer) {
+  Entry newEntry = { status.getLastModificationTime(), status.getSize(),
+                     buffer->getBuffer(), /*Used=*/true };
+
+  // An identical entry only needs to be written again if it couldn't be
+  // trusted, so that the next build can.
+  auto iter = Entries.find(path);
+  if (iter != Entries.end()) {
+    Entry &oldEntry = iter->getValue();
+    if (oldEntry.ModTime == newEntry.ModTime &&
+        oldEntry.Size == newEntry.Size && oldEntry.Data == newEntry.Data &&
+        oldEntry.ModTime < LoadedBuildTime) {
+      oldEntry.Used = true;
+      return;
+    }
+  }
+
+  Entries[path] = newEntry;
+  Buffers.push_back(std::move(buffer));
+  Changed = true;
+}
+
+bool DependencyGraphCache::isOutOfDate() const {
+  if (Changed)
+    return true;
+  return std::any_of(Entries.begin(), Entries.end(),
+                     [](const llvm::StringMapEntry<Entry> &entry) {
+    return !entry.getValue().Used;
+  });
+}
+
+void DependencyGraphCache::writeToPath(StringRef path,
+                                       llvm::sys::TimeValue buildTime) {
+  if (!isOutOfDate())
+    return;
+
+  for (auto iter = Entries.begin(), end = Entries.end(); iter != end;) {
+    auto current = iter++;
+    if (!current->getValue().Used)
+      Entries.erase(current);
+  }
+
+  // Write to a temporary file and rename it into place: the loaded cache may
+  // still be mapped into memory, and this is read from while writing.
+  int fd;
+  SmallString<128> tempPath;
+  if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%%%", fd, tempPath)) {
+    // The cache is only an optimization.
+    return;
+  }
+
+  {
+    llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+    writeContents(out, buildTime);
+    out.close();
+    if (out.has_error()) {
+      out.clear_error();
+      llvm::sys::fs::remove(tempPath);
+      return;
+    }
+  }
+
+  if (llvm::sys::fs::rename(tempPath, path))
+    llvm::sys::fs::remove(tempPath);
+}
+
+void DependencyGraphCache::writeContents(raw_ostream &out,
+                                         llvm::sys::TimeValue buildTime) const {
+  llvm::support::endian::Writer<llvm::support::little> words(out);
+  auto writeString = [&](StringRef string) {
+    words.write<uint32_t>(string.size());
+    out << string;
+  };
+  auto writeTime = [&](llvm::sys::TimeValue time) {
+    words.write<uint64_t>(time.seconds());
+    words.write<uint32_t>(time.nanoseconds());
+  };
+
+  out.write(CacheMagic, sizeof(CacheMagic));
+  writeString(version::getSwiftFullVersion());
+  writeTime(buildTime);
+  words.write<uint32_t>(Entries.size());
+
+  for (auto &entry : Entries) {
+    writeString(entry.getKey());
+    writeTime(entry.getValue().ModTime);
+    words.write<uint64_t>(entry.getValue().Size);
+    writeString(entry.getValue().Data);
+  }
+}
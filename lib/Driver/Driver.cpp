@@ -24,6 +24,7 @@
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/LLVM.h"
 #include "swift/Basic/TaskQueue.h"
+#include "swift/Basic/Timer.h"
 #include "swift/Basic/Version.h"
 #include "swift/Basic/Range.h"
 #include "swift/Driver/Action.h"
@@ -365,6 +366,10 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
     !ArgList->hasArg(options::OPT_whole_module_optimization) &&
     !ArgList->hasArg(options::OPT_embed_bitcode);
 
+  bool BatchMode = ArgList->hasFlag(options::OPT_enable_batch_mode,
+                                   options::OPT_disable_batch_mode,
+                                   false);
+
   bool SaveTemps = ArgList->hasArg(options::OPT_save_temps);
 
   std::unique_ptr<DerivedArgList> TranslatedArgList(
@@ -502,6 +507,13 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
                                                  DriverSkipExecution,
                                                  SaveTemps));
 
+  // This has to happen before building jobs, so that frontend jobs are asked
+  // to write their own traces.
+  if (const Arg *A = C->getArgs().getLastArg(options::OPT_trace_file)) {
+    C->setTraceFilePath(A->getValue());
+    CompilationTrace::enable();
+  }
+
   buildJobs(Actions, OI, OFM.get(), *TC, *C);
 
   // For updating code we need to go through all the files and pick up changes,
@@ -514,6 +526,9 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
   if (ShowIncrementalBuildDecisions)
     C->setShowsIncrementalBuildDecisions();
 
+  if (BatchMode && OI.CompilerMode == OutputInfo::Mode::StandardCompile)
+    C->enableBatchMode(*TC, OI);
+
   // This has to happen after building jobs, because otherwise we won't even
   // emit .swiftdeps files for the next build.
   if (rebuildEverything)
@@ -174,14 +174,16 @@ public:
 
 class TaskOutputMessage : public TaskBasedMessage {
   std::string Output;
+  Optional<double> WallTime;
 public:
   TaskOutputMessage(StringRef Kind, const Job &Cmd, ProcessId Pid,
-                    StringRef Output) : TaskBasedMessage(Kind, Cmd, Pid),
-                                        Output(Output) {}
+                    StringRef Output, Optional<double> WallTime)
+      : TaskBasedMessage(Kind, Cmd, Pid), Output(Output), WallTime(WallTime) {}
 
   virtual void provideMapping(swift::json::Output &out) {
     TaskBasedMessage::provideMapping(out);
     out.mapOptional("output", Output, std::string());
+    out.mapOptional("wall-time", WallTime);
   }
 };
 
@@ -189,9 +191,9 @@ class FinishedMessage : public TaskOutputMessage {
   int ExitStatus;
 public:
   FinishedMessage(const Job &Cmd, ProcessId Pid, StringRef Output,
-                  int ExitStatus) : TaskOutputMessage("finished", Cmd, Pid,
-                                                      Output),
-                                    ExitStatus(ExitStatus) {}
+                  int ExitStatus, Optional<double> WallTime)
+      : TaskOutputMessage("finished", Cmd, Pid, Output, WallTime),
+        ExitStatus(ExitStatus) {}
 
   virtual void provideMapping(swift::json::Output &out) {
     TaskOutputMessage::provideMapping(out);
@@ -203,9 +205,9 @@ class SignalledMessage : public TaskOutputMessage {
   std::string ErrorMsg;
 public:
   SignalledMessage(const Job &Cmd, ProcessId Pid, StringRef Output,
-                   StringRef ErrorMsg) : TaskOutputMessage("signalled", Cmd,
-                                                           Pid, Output),
-                                         ErrorMsg(ErrorMsg) {}
+                   StringRef ErrorMsg, Optional<double> WallTime)
+      : TaskOutputMessage("signalled", Cmd, Pid, Output, WallTime),
+        ErrorMsg(ErrorMsg) {}
 
   virtual void provideMapping(swift::json::Output &out) {
     TaskOutputMessage::provideMapping(out);
@@ -252,16 +254,18 @@ void parseable_output::emitBeganMessage(raw_ostream &os,
 
 void parseable_output::emitFinishedMessage(raw_ostream &os,
                                            const Job &Cmd, ProcessId Pid,
-                                           int ExitStatus, StringRef Output) {
-  FinishedMessage msg(Cmd, Pid, Output, ExitStatus);
+                                           int ExitStatus, StringRef Output,
+                                           Optional<double> WallTime) {
+  FinishedMessage msg(Cmd, Pid, Output, ExitStatus, WallTime);
   emitMessage(os, msg);
 }
 
 void parseable_output::emitSignalledMessage(raw_ostream &os,
                                             const Job &Cmd, ProcessId Pid,
                                             StringRef ErrorMsg,
-                                            StringRef Output) {
-  SignalledMessage msg(Cmd, Pid, Output, ErrorMsg);
+                                            StringRef Output,
+                                            Optional<double> WallTime) {
+  SignalledMessage msg(Cmd, Pid, Output, ErrorMsg, WallTime);
   emitMessage(os, msg);
 }
 
@@ -65,6 +65,14 @@ ToolChain::JobContext::getTemporaryFilePath(const llvm::Twine &name,
   return C.getArgs().MakeArgString(buffer.str());
 }
 
+const char *ToolChain::JobContext::getTraceFilePath() const {
+  if (C.getTraceFilePath().empty())
+    return nullptr;
+  const char *path = getTemporaryFilePath("trace", "json");
+  C.addJobTraceFile(path);
+  return path;
+}
+
 std::unique_ptr<Job>
 ToolChain::constructJob(const JobAction &JA,
                         Compilation &C,
@@ -121,6 +129,69 @@ ToolChain::constructJob(const JobAction &JA,
                                 std::move(invocationInfo.FilelistInfo));
 }
 
+bool ToolChain::jobIsBatchable(const Job *job) const {
+  auto *CJA = dyn_cast<CompileJobAction>(&job->getSource());
+  if (!CJA || CJA->size() != 1)
+    return false;
+  // Only frontend invocations (not swift-update) take several primary files.
+  if (StringRef(job->getExecutable()) != getDriver().getSwiftProgramPath())
+    return false;
+  if (!job->getExtraEnvironment().empty())
+    return false;
+  // Serialized diagnostics and fix-its cover everything a frontend process
+  // reports, and can't be split up by primary file.
+  const CommandOutput &output = job->getOutput();
+  return output.getAdditionalOutputForType(
+           types::TY_SerializedDiagnostics).empty() &&
+         output.getAdditionalOutputForType(types::TY_Remapping).empty();
+}
+
+std::unique_ptr<BatchJob>
+ToolChain::constructBatchJob(ArrayRef<const Job *> jobs,
+                             Compilation &C,
+                             const OutputInfo &OI) const {
+  assert(jobs.size() > 1 && "batching a single job");
+
+  // The frontend matches per-primary outputs to -primary-file options by
+  // position, so keep the primary files in command-line order.
+  auto getInputIndex = [](const Job *job) -> unsigned {
+    auto *IA = cast<InputAction>(job->getSource().getInputs().front());
+    return IA->getInputArg().getIndex();
+  };
+  SmallVector<const Job *, 16> sortedJobs(jobs.begin(), jobs.end());
+  std::sort(sortedJobs.begin(), sortedJobs.end(),
+            [&](const Job *lhs, const Job *rhs) {
+    return getInputIndex(lhs) < getInputIndex(rhs);
+  });
+
+  const Job *first = sortedJobs.front();
+  auto output = llvm::make_unique<CommandOutput>(
+    first->getOutput().getPrimaryOutputType());
+  SmallVector<const Action *, 16> inputActions;
+  SmallVector<const CommandOutput *, 16> primaryOutputs;
+  for (const Job *job : sortedJobs) {
+    assert(jobIsBatchable(job) && "job cannot be batched");
+    const CommandOutput &jobOutput = job->getOutput();
+    assert(jobOutput.getPrimaryOutputType() == output->getPrimaryOutputType());
+    ArrayRef<std::string> filenames = jobOutput.getPrimaryOutputFilenames();
+    for (size_t i = 0, e = filenames.size(); i != e; ++i)
+      output->addPrimaryOutput(filenames[i], jobOutput.getBaseInput(i));
+    inputActions.push_back(job->getSource().getInputs().front());
+    primaryOutputs.push_back(&jobOutput);
+  }
+
+  JobContext context{C, {}, inputActions, *output, OI};
+  InvocationInfo invocationInfo =
+    constructCompileInvocation(context, primaryOutputs);
+  assert(StringRef(SWIFT_EXECUTABLE_NAME) == invocationInfo.ExecutableName);
+
+  return llvm::make_unique<BatchJob>(first->getSource(), std::move(output),
+                                     first->getExecutable(),
+                                     std::move(invocationInfo.Arguments),
+                                     std::move(invocationInfo.FilelistInfo),
+                                     sortedJobs);
+}
+
 std::string
 ToolChain::findProgramRelativeToSwift(StringRef executableName) const {
   auto insertionResult =
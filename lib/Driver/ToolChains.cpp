@@ -25,6 +25,7 @@
 #include "swift/Config.h"
 #include "clang/Basic/Version.h"
 #include "clang/Driver/Util.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
@@ -129,6 +130,7 @@ static void addCommonFrontendArgs(const ToolChain &TC,
   inputArgs.AddLastArg(arguments, options::OPT_suppress_warnings);
   inputArgs.AddLastArg(arguments, options::OPT_profile_generate);
   inputArgs.AddLastArg(arguments, options::OPT_profile_coverage_mapping);
+  inputArgs.AddLastArg(arguments, options::OPT_profile_use_EQ);
   inputArgs.AddLastArg(arguments, options::OPT_warnings_as_errors);
   inputArgs.AddLastArg(arguments, options::OPT_sanitize_EQ);
 
@@ -154,9 +156,41 @@ static void addCommonFrontendArgs(const ToolChain &TC,
 }
 
 
+/// Asks frontend jobs to write a trace of their compilation phases, when the
+/// driver is writing a trace to merge them into.
+static void addTraceFileArg(const ToolChain::JobContext &context,
+                            ArgStringList &arguments) {
+  if (const char *path = context.getTraceFilePath()) {
+    arguments.push_back("-trace-file");
+    arguments.push_back(path);
+  }
+}
+
+/// Adds \p option followed by the path of each of \p outputs' supplementary
+/// outputs of type \p type, skipping outputs that don't have one.
+static void addOutputsOfType(ArgStringList &arguments,
+                             ArrayRef<const CommandOutput *> outputs,
+                             types::ID type, const char *option) {
+  for (const CommandOutput *output : outputs) {
+    const std::string &path = output->getAdditionalOutputForType(type);
+    if (!path.empty()) {
+      arguments.push_back(option);
+      arguments.push_back(path.c_str());
+    }
+  }
+}
+
 ToolChain::InvocationInfo
 ToolChain::constructInvocation(const CompileJobAction &job,
                                const JobContext &context) const {
+  const CommandOutput *output = &context.Output;
+  return constructCompileInvocation(context, output);
+}
+
+ToolChain::InvocationInfo
+ToolChain::constructCompileInvocation(
+    const JobContext &context,
+    ArrayRef<const CommandOutput *> primaryOutputs) const {
   InvocationInfo II{SWIFT_EXECUTABLE_NAME};
   ArgStringList &Arguments = II.Arguments;
 
@@ -245,36 +279,42 @@ ToolChain::constructInvocation(const CompileJobAction &job,
   switch (context.OI.CompilerMode) {
   case OutputInfo::Mode::StandardCompile:
   case OutputInfo::Mode::UpdateCode: {
-    assert(context.InputActions.size() == 1 &&
-           "The Swift frontend expects exactly one input (the primary file)!");
-
-    auto *IA = cast<InputAction>(context.InputActions[0]);
-    const Arg &PrimaryInputArg = IA->getInputArg();
+    assert(!context.InputActions.empty() &&
+           context.InputActions.size() == primaryOutputs.size() &&
+           "The Swift frontend expects one output per primary file!");
+    assert((context.InputActions.size() == 1 ||
+            context.OI.CompilerMode == OutputInfo::Mode::StandardCompile) &&
+           "Only the Swift frontend can take several primary files!");
 
     if (context.Args.hasArg(options::OPT_driver_use_filelists) ||
         context.getTopLevelInputFiles().size() > TOO_MANY_FILES) {
       Arguments.push_back("-filelist");
       Arguments.push_back(context.getAllSourcesPath());
-      Arguments.push_back("-primary-file");
-      PrimaryInputArg.render(context.Args, Arguments);
+      for (const Action *A : context.InputActions) {
+        Arguments.push_back("-primary-file");
+        cast<InputAction>(A)->getInputArg().render(context.Args, Arguments);
+      }
     } else {
-      bool FoundPrimaryInput = false;
+      llvm::SmallDenseSet<unsigned, 16> PrimaryInputIndices;
+      for (const Action *A : context.InputActions)
+        PrimaryInputIndices.insert(
+          cast<InputAction>(A)->getInputArg().getIndex());
+
       for (auto inputPair : context.getTopLevelInputFiles()) {
         if (!types::isPartOfSwiftCompilation(inputPair.first))
           continue;
 
         // See if this input should be passed with -primary-file.
-        if (!FoundPrimaryInput &&
-            PrimaryInputArg.getIndex() == inputPair.second->getIndex()) {
+        if (PrimaryInputIndices.erase(inputPair.second->getIndex()))
           Arguments.push_back("-primary-file");
-          FoundPrimaryInput = true;
-        }
         Arguments.push_back(inputPair.second->getValue());
       }
     }
     break;
   }
   case OutputInfo::Mode::SingleCompile: {
+    assert(primaryOutputs.size() == 1 &&
+           primaryOutputs.front() == &context.Output);
     if (context.Args.hasArg(options::OPT_driver_use_filelists) ||
         context.InputActions.size() > TOO_MANY_FILES) {
       Arguments.push_back("-filelist");
@@ -297,6 +337,13 @@ ToolChain::constructInvocation(const CompileJobAction &job,
 
   addCommonFrontendArgs(*this, context.OI, context.Output, context.Args,
                         Arguments);
+  addTraceFileArg(context, Arguments);
+
+  // A batch job's combined output has no supplementary outputs of its own, so
+  // pass the module documentation path of each primary file instead.
+  if (primaryOutputs.front() != &context.Output)
+    addOutputsOfType(Arguments, primaryOutputs, types::TY_SwiftModuleDocFile,
+                     "-emit-module-doc-path");
 
   // Pass the optimization level down to the frontend.
   context.Args.AddLastArg(Arguments, options::OPT_O_Group);
@@ -310,12 +357,8 @@ ToolChain::constructInvocation(const CompileJobAction &job,
   Arguments.push_back("-module-name");
   Arguments.push_back(context.Args.MakeArgString(context.OI.ModuleName));
 
-  const std::string &ModuleOutputPath =
-    context.Output.getAdditionalOutputForType(types::ID::TY_SwiftModuleFile);
-  if (!ModuleOutputPath.empty()) {
-    Arguments.push_back("-emit-module-path");
-    Arguments.push_back(ModuleOutputPath.c_str());
-  }
+  addOutputsOfType(Arguments, primaryOutputs, types::TY_SwiftModuleFile,
+                   "-emit-module-path");
 
   const std::string &ObjCHeaderOutputPath =
     context.Output.getAdditionalOutputForType(types::ID::TY_ObjCHeader);
@@ -328,33 +371,20 @@ ToolChain::constructInvocation(const CompileJobAction &job,
     Arguments.push_back(ObjCHeaderOutputPath.c_str());
   }
 
-  const std::string &SerializedDiagnosticsPath =
-    context.Output.getAdditionalOutputForType(types::TY_SerializedDiagnostics);
-  if (!SerializedDiagnosticsPath.empty()) {
-    Arguments.push_back("-serialize-diagnostics-path");
-    Arguments.push_back(SerializedDiagnosticsPath.c_str());
-  }
+  addOutputsOfType(Arguments, primaryOutputs, types::TY_SerializedDiagnostics,
+                   "-serialize-diagnostics-path");
+  addOutputsOfType(Arguments, primaryOutputs, types::TY_Dependencies,
+                   "-emit-dependencies-path");
 
-  const std::string &DependenciesPath =
-    context.Output.getAdditionalOutputForType(types::TY_Dependencies);
-  if (!DependenciesPath.empty()) {
-    Arguments.push_back("-emit-dependencies-path");
-    Arguments.push_back(DependenciesPath.c_str());
+  if (!primaryOutputs.front()->getAdditionalOutputForType(
+         types::TY_SwiftDeps).empty()) {
+    addOutputsOfType(Arguments, primaryOutputs, types::TY_SwiftDeps,
+                     "-emit-reference-dependencies-path");
+    Arguments.push_back("-emit-binary-reference-dependencies");
   }
 
-  const std::string &ReferenceDependenciesPath =
-    context.Output.getAdditionalOutputForType(types::TY_SwiftDeps);
-  if (!ReferenceDependenciesPath.empty()) {
-    Arguments.push_back("-emit-reference-dependencies-path");
-    Arguments.push_back(ReferenceDependenciesPath.c_str());
-  }
-
-  const std::string &FixitsPath =
-    context.Output.getAdditionalOutputForType(types::TY_Remapping);
-  if (!FixitsPath.empty()) {
-    Arguments.push_back("-emit-fixits-path");
-    Arguments.push_back(FixitsPath.c_str());
-  }
+  addOutputsOfType(Arguments, primaryOutputs, types::TY_Remapping,
+                   "-emit-fixits-path");
 
   if (context.OI.numThreads > 0) {
     Arguments.push_back("-num-threads");
@@ -406,6 +436,7 @@ ToolChain::constructInvocation(const InterpretJobAction &job,
 
   addCommonFrontendArgs(*this, context.OI, context.Output, context.Args,
                         Arguments);
+  addTraceFileArg(context, Arguments);
 
   // Pass the optimization level down to the frontend.
   context.Args.AddLastArg(Arguments, options::OPT_O_Group);
@@ -597,6 +628,7 @@ ToolChain::constructInvocation(const MergeModuleJobAction &job,
 
   addCommonFrontendArgs(*this, context.OI, context.Output, context.Args,
                         Arguments);
+  addTraceFileArg(context, Arguments);
 
   Arguments.push_back("-module-name");
   Arguments.push_back(context.Args.MakeArgString(context.OI.ModuleName));
@@ -18,6 +18,7 @@
 #include "swift/Option/Options.h"
 #include "swift/Option/SanitizerOptions.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
@@ -112,32 +113,34 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
-static unsigned readFileList(std::vector<std::string> &inputFiles,
-                             const llvm::opt::Arg *filelistPath,
-                             const llvm::opt::Arg *primaryFileArg = nullptr) {
-  bool foundPrimaryFile = false;
-  unsigned primaryFileIndex = 0;
-  StringRef primaryFile;
-  if (primaryFileArg)
-    primaryFile = primaryFileArg->getValue();
+/// Reads the files listed in \p filelistPath into \p inputFiles, and returns
+/// the index in the list of each of \p primaryFileArgs, in the same order.
+static std::vector<unsigned>
+readFileList(std::vector<std::string> &inputFiles,
+             const llvm::opt::Arg *filelistPath,
+             ArrayRef<const llvm::opt::Arg *> primaryFileArgs = {}) {
+  llvm::StringMap<unsigned> primaryFileSlots;
+  for (unsigned i = 0, e = primaryFileArgs.size(); i != e; ++i)
+    primaryFileSlots.insert({primaryFileArgs[i]->getValue(), i});
+  std::vector<unsigned> primaryFileIndices(primaryFileArgs.size(), ~0U);
 
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
       llvm::MemoryBuffer::getFile(filelistPath->getValue());
   assert(buffer && "can't read filelist; unrecoverable");
 
   for (StringRef line : make_range(llvm::line_iterator(*buffer.get()), {})) {
+    auto slot = primaryFileSlots.find(line);
+    if (slot != primaryFileSlots.end() &&
+        primaryFileIndices[slot->second] == ~0U)
+      primaryFileIndices[slot->second] = inputFiles.size();
     inputFiles.push_back(line);
-    if (foundPrimaryFile)
-      continue;
-    if (line == primaryFile)
-      foundPrimaryFile = true;
-    else
-      ++primaryFileIndex;
   }
 
-  if (primaryFileArg)
-    assert(foundPrimaryFile && "primary file not found in filelist");
-  return primaryFileIndex;
+  for (unsigned index : primaryFileIndices) {
+    assert(index != ~0U && "primary file not found in filelist");
+    (void)index;
+  }
+  return primaryFileIndices;
 }
 
 static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
@@ -171,6 +174,8 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
 
   Opts.EmitVerboseSIL |= Args.hasArg(OPT_emit_verbose_sil);
   Opts.EmitSortedSIL |= Args.hasArg(OPT_emit_sorted_sil);
+  Opts.EmitBinaryReferenceDependencies |=
+    Args.hasArg(OPT_emit_binary_reference_dependencies);
 
   Opts.DelayedFunctionBodyParsing |= Args.hasArg(OPT_delayed_function_body_parsing);
   Opts.EnableTesting |= Args.hasArg(OPT_enable_testing);
@@ -180,6 +185,8 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.PrintClangStats |= Args.hasArg(OPT_print_clang_stats);
   Opts.DebugTimeFunctionBodies |= Args.hasArg(OPT_debug_time_function_bodies);
   Opts.DebugTimeCompilation |= Args.hasArg(OPT_debug_time_compilation);
+  if (const Arg *A = Args.getLastArg(OPT_trace_file))
+    Opts.TraceFilePath = A->getValue();
 
   Opts.PlaygroundTransform |= Args.hasArg(OPT_playground);
   if (Args.hasArg(OPT_disable_playground_transform))
@@ -197,12 +204,12 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     }
   }
 
+  // More than one -primary-file means batch mode.
+  std::vector<unsigned> primaryFileIndices;
   if (const Arg *A = Args.getLastArg(OPT_filelist)) {
-    const Arg *primaryFileArg = Args.getLastArg(OPT_primary_file);
-    auto primaryFileIndex = readFileList(Opts.InputFilenames, A,
-                                         primaryFileArg);
-    if (primaryFileArg)
-      Opts.PrimaryInput = SelectedInput(primaryFileIndex);
+    SmallVector<const Arg *, 1> primaryFileArgs(
+      Args.filtered_begin(OPT_primary_file), Args.filtered_end());
+    primaryFileIndices = readFileList(Opts.InputFilenames, A, primaryFileArgs);
     assert(!Args.hasArg(OPT_INPUT) && "mixing -filelist with inputs");
   } else {
     for (const Arg *A : make_range(Args.filtered_begin(OPT_INPUT,
@@ -211,13 +218,19 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
       if (A->getOption().matches(OPT_INPUT)) {
         Opts.InputFilenames.push_back(A->getValue());
       } else if (A->getOption().matches(OPT_primary_file)) {
-        Opts.PrimaryInput = SelectedInput(Opts.InputFilenames.size());
+        primaryFileIndices.push_back(Opts.InputFilenames.size());
         Opts.InputFilenames.push_back(A->getValue());
       } else {
         llvm_unreachable("Unknown input-related argument!");
       }
     }
   }
+  if (!primaryFileIndices.empty())
+    Opts.PrimaryInput = SelectedInput(primaryFileIndices.front());
+  if (primaryFileIndices.size() > 1) {
+    for (unsigned index : primaryFileIndices)
+      Opts.BatchPrimaries.emplace_back(SelectedInput(index));
+  }
 
   Opts.ParseStdlib |= Args.hasArg(OPT_parse_stdlib);
 
@@ -691,6 +704,106 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     }
   }
 
+  if (Opts.isBatchMode()) {
+    unsigned numPrimaries = Opts.BatchPrimaries.size();
+
+    switch (Opts.RequestedAction) {
+    case FrontendOptions::NoneAction:
+    case FrontendOptions::DumpParse:
+    case FrontendOptions::DumpInterfaceHash:
+    case FrontendOptions::DumpAST:
+    case FrontendOptions::PrintAST:
+    case FrontendOptions::DumpTypeRefinementContexts:
+    case FrontendOptions::EmitSIBGen:
+    case FrontendOptions::EmitSIB:
+    case FrontendOptions::Immediate:
+    case FrontendOptions::REPL: {
+      const Arg *A = Args.getLastArg(OPT_modes_Group);
+      Diags.diagnose(SourceLoc(), diag::error_batch_mode_unsupported_option,
+                     A ? A->getSpelling() : "this mode");
+      return true;
+    }
+    case FrontendOptions::Parse:
+    case FrontendOptions::EmitModuleOnly:
+    case FrontendOptions::EmitSILGen:
+    case FrontendOptions::EmitSIL:
+    case FrontendOptions::EmitIR:
+    case FrontendOptions::EmitBC:
+    case FrontendOptions::EmitAssembly:
+    case FrontendOptions::EmitObject:
+      break;
+    }
+
+    if (Opts.InputKind != InputFileKind::IFK_Swift &&
+        Opts.InputKind != InputFileKind::IFK_Swift_Library) {
+      Diags.diagnose(SourceLoc(), diag::error_batch_mode_unsupported_input);
+      return true;
+    }
+
+    // These outputs cover every primary file, so there is no way to split
+    // them up.
+    for (auto opt : { OPT_serialize_diagnostics_path, OPT_emit_objc_header_path,
+                      OPT_emit_fixits_path }) {
+      if (const Arg *A = Args.getLastArg(opt)) {
+        Diags.diagnose(SourceLoc(), diag::error_batch_mode_unsupported_option,
+                       A->getSpelling());
+        return true;
+      }
+    }
+
+    // Every other output is given once per primary file, in the same order
+    // as the -primary-file options.
+    using BatchPrimary = FrontendOptions::BatchPrimary;
+    auto assignBatchOutputs = [&](std::string BatchPrimary::*field,
+                                  ArrayRef<std::string> paths,
+                                  bool required, StringRef spelling) -> bool {
+      if (paths.empty() && !required)
+        return false;
+      if (paths.size() != numPrimaries) {
+        Diags.diagnose(SourceLoc(), diag::error_batch_mode_output_count,
+                       spelling, paths.size(), numPrimaries);
+        return true;
+      }
+      for (unsigned i = 0; i != numPrimaries; ++i)
+        Opts.BatchPrimaries[i].*field = paths[i];
+      return false;
+    };
+
+    bool hasMainOutput = Opts.actionHasOutput() &&
+                         Opts.RequestedAction != FrontendOptions::EmitModuleOnly;
+    if (assignBatchOutputs(&BatchPrimary::OutputFilename, Opts.OutputFilenames,
+                           hasMainOutput, "-o"))
+      return true;
+
+    auto assignOptionalOutputs = [&](std::string BatchPrimary::*field,
+                                     const std::string &singlePath,
+                                     OptSpecifier optWithPath,
+                                     StringRef spelling) -> bool {
+      // An output requested without a path would need a name derived for
+      // each primary file; the driver always passes explicit paths.
+      std::vector<std::string> paths = Args.getAllArgValues(optWithPath);
+      if (paths.empty() && singlePath.empty())
+        return false;
+      return assignBatchOutputs(field, paths, /*required=*/true, spelling);
+    };
+    if (assignOptionalOutputs(&BatchPrimary::ModuleOutputPath,
+                              Opts.ModuleOutputPath, OPT_emit_module_path,
+                              "-emit-module-path") ||
+        assignOptionalOutputs(&BatchPrimary::ModuleDocOutputPath,
+                              Opts.ModuleDocOutputPath,
+                              OPT_emit_module_doc_path,
+                              "-emit-module-doc-path") ||
+        assignOptionalOutputs(&BatchPrimary::DependenciesFilePath,
+                              Opts.DependenciesFilePath,
+                              OPT_emit_dependencies_path,
+                              "-emit-dependencies-path") ||
+        assignOptionalOutputs(&BatchPrimary::ReferenceDependenciesFilePath,
+                              Opts.ReferenceDependenciesFilePath,
+                              OPT_emit_reference_dependencies_path,
+                              "-emit-reference-dependencies-path"))
+      return true;
+  }
+
   if (const Arg *A = Args.getLastArg(OPT_module_link_name)) {
     Opts.ModuleLinkName = A->getValue();
   }
@@ -1068,11 +1181,14 @@ static bool ParseSILArgs(SILOptions &Opts, ArgList &Args,
   Opts.DebugSerialization |= Args.hasArg(OPT_sil_debug_serialization);
   Opts.EmitVerboseSIL |= Args.hasArg(OPT_emit_verbose_sil);
   Opts.PrintInstCounts |= Args.hasArg(OPT_print_inst_counts);
+  Opts.ExportSpecializations |= Args.hasArg(OPT_export_specializations);
   if (const Arg *A = Args.getLastArg(OPT_external_pass_pipeline_filename))
     Opts.ExternalPassPipelineFilename = A->getValue();
 
   Opts.GenerateProfile |= Args.hasArg(OPT_profile_generate);
   Opts.EmitProfileCoverageMapping |= Args.hasArg(OPT_profile_coverage_mapping);
+  if (const Arg *A = Args.getLastArg(OPT_profile_use_EQ))
+    Opts.UseProfile = A->getValue();
   Opts.EnableGuaranteedClosureContexts |=
     Args.hasArg(OPT_enable_guaranteed_closure_contexts);
 
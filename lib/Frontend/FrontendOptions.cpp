@@ -88,3 +88,17 @@ void FrontendOptions::forAllOutputPaths(
       fn(*next);
   }
 }
+
+FrontendOptions
+FrontendOptions::getOptionsForBatchPrimary(const BatchPrimary &primary) const {
+  FrontendOptions result = *this;
+  result.BatchPrimaries.clear();
+  result.PrimaryInput = primary.Input;
+  if (!primary.OutputFilename.empty())
+    result.setSingleOutputFilename(primary.OutputFilename);
+  result.ModuleOutputPath = primary.ModuleOutputPath;
+  result.ModuleDocOutputPath = primary.ModuleDocOutputPath;
+  result.DependenciesFilePath = primary.DependenciesFilePath;
+  result.ReferenceDependenciesFilePath = primary.ReferenceDependenciesFilePath;
+  return result;
+}
@@ -520,6 +520,13 @@ public:
       for (auto Id : PredIDs)
         *this << ' ' << Id;
     }
+    if (auto Count = BB->getExecutionCount()) {
+      if (BB->pred_empty())
+        PrintState.OS.PadToColumn(50);
+      else
+        *this << ' ';
+      *this << "// Count: " << *Count;
+    }
     *this << '\n';
 
     for (const SILInstruction &I : *BB) {
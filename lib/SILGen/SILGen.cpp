@@ -27,6 +27,7 @@
 #include "swift/SIL/SILArgument.h"
 #include "swift/SIL/SILDebugScope.h"
 #include "swift/Subsystems.h"
+#include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/Support/Debug.h"
 #include "RValue.h"
 using namespace swift;
@@ -39,6 +40,16 @@ using namespace Lowering;
 SILGenModule::SILGenModule(SILModule &M, Module *SM, bool makeModuleFragile)
   : M(M), Types(M.Types), SwiftModule(SM), TopLevelSGF(nullptr),
     Profiler(nullptr), makeModuleFragile(makeModuleFragile) {
+  const std::string &ProfilePath = M.getOptions().UseProfile;
+  if (!ProfilePath.empty()) {
+    auto ReaderOrErr = llvm::IndexedInstrProfReader::create(ProfilePath);
+    if (ReaderOrErr) {
+      PGOReader = std::move(ReaderOrErr.get());
+    } else {
+      diagnose(SourceLoc(), diag::profile_read_error, ProfilePath,
+               ReaderOrErr.getError().message());
+    }
+  }
 }
 
 SILGenModule::~SILGenModule() {
@@ -23,6 +23,9 @@
 #include "llvm/ProfileData/CoverageMapping.h"
 #include "llvm/ProfileData/CoverageMappingWriter.h"
 #include "llvm/ProfileData/InstrProf.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MD5.h"
 
 #include <forward_list>
 
@@ -32,7 +35,7 @@ using namespace Lowering;
 ProfilerRAII::ProfilerRAII(SILGenModule &SGM, AbstractFunctionDecl *D)
     : SGM(SGM) {
   const auto &Opts = SGM.M.getOptions();
-  if (!Opts.GenerateProfile)
+  if (!Opts.GenerateProfile && !SGM.PGOReader)
     return;
   SGM.Profiler =
       llvm::make_unique<SILGenProfiling>(SGM, Opts.EmitProfileCoverageMapping);
@@ -43,6 +46,24 @@ ProfilerRAII::~ProfilerRAII() { SGM.Profiler = nullptr; }
 
 namespace {
 
+/// The kinds of regions that are given counters. These feed the function's
+/// structural hash, so existing values must not be renumbered.
+enum class RegionKind : uint8_t {
+  FunctionBody = 1,
+  IfThen,
+  GuardBody,
+  WhileBody,
+  RepeatWhileBody,
+  ForBody,
+  ForEachBody,
+  Switch,
+  Case,
+  DoCatch,
+  CatchBody,
+  IfExprThen,
+  Closure,
+};
+
 /// An ASTWalker that maps ASTNodes to profiling counters.
 struct MapRegionCounters : public ASTWalker {
   /// The next counter value to assign.
@@ -51,45 +72,64 @@ struct MapRegionCounters : public ASTWalker {
   /// The map of statements to counters.
   llvm::DenseMap<ASTNode, unsigned> &CounterMap;
 
+  /// The kinds of the regions mapped so far, in counter order. A profile
+  /// recorded for a function with a different structure is rejected because
+  /// its hash doesn't match.
+  llvm::MD5 Hash;
+
   MapRegionCounters(llvm::DenseMap<ASTNode, unsigned> &CounterMap)
       : NextCounter(0), CounterMap(CounterMap) {}
 
+  void mapRegion(ASTNode Node, RegionKind Kind) {
+    CounterMap[Node] = NextCounter++;
+    uint8_t KindValue = uint8_t(Kind);
+    Hash.update(llvm::makeArrayRef(KindValue));
+  }
+
+  /// Returns the structural hash of the regions mapped.
+  uint64_t getHash() {
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    using namespace llvm::support;
+    return endian::read<uint64_t, little, unaligned>(Result);
+  }
+
   bool walkToDeclPre(Decl *D) override {
     if (auto *AFD = dyn_cast<AbstractFunctionDecl>(D))
-      CounterMap[AFD->getBody()] = NextCounter++;
+      mapRegion(AFD->getBody(), RegionKind::FunctionBody);
     return true;
   }
 
   std::pair<bool, Stmt *> walkToStmtPre(Stmt *S) override {
     if (auto *IS = dyn_cast<IfStmt>(S)) {
-      CounterMap[IS->getThenStmt()] = NextCounter++;
+      mapRegion(IS->getThenStmt(), RegionKind::IfThen);
     } else if (auto *US = dyn_cast<GuardStmt>(S)) {
-      CounterMap[US->getBody()] = NextCounter++;
+      mapRegion(US->getBody(), RegionKind::GuardBody);
     } else if (auto *WS = dyn_cast<WhileStmt>(S)) {
-      CounterMap[WS->getBody()] = NextCounter++;
+      mapRegion(WS->getBody(), RegionKind::WhileBody);
     } else if (auto *RWS = dyn_cast<RepeatWhileStmt>(S)) {
-      CounterMap[RWS->getBody()] = NextCounter++;
+      mapRegion(RWS->getBody(), RegionKind::RepeatWhileBody);
     } else if (auto *FS = dyn_cast<ForStmt>(S)) {
-      CounterMap[FS->getBody()] = NextCounter++;
+      mapRegion(FS->getBody(), RegionKind::ForBody);
     } else if (auto *FES = dyn_cast<ForEachStmt>(S)) {
-      CounterMap[FES->getBody()] = NextCounter++;
+      mapRegion(FES->getBody(), RegionKind::ForEachBody);
     } else if (auto *SS = dyn_cast<SwitchStmt>(S)) {
-      CounterMap[SS] = NextCounter++;
+      mapRegion(SS, RegionKind::Switch);
     } else if (auto *CS = dyn_cast<CaseStmt>(S)) {
-      CounterMap[CS] = NextCounter++;
+      mapRegion(CS, RegionKind::Case);
     } else if (auto *DCS = dyn_cast<DoCatchStmt>(S)) {
-      CounterMap[DCS] = NextCounter++;
+      mapRegion(DCS, RegionKind::DoCatch);
     } else if (auto *CS = dyn_cast<CatchStmt>(S)) {
-      CounterMap[CS->getBody()] = NextCounter++;
+      mapRegion(CS->getBody(), RegionKind::CatchBody);
     }
     return {true, S};
   }
 
   std::pair<bool, Expr *> walkToExprPre(Expr *E) override {
     if (auto *IE = dyn_cast<IfExpr>(E))
-      CounterMap[IE->getThenExpr()] = NextCounter++;
+      mapRegion(IE->getThenExpr(), RegionKind::IfExprThen);
     else if (isa<AutoClosureExpr>(E) || isa<ClosureExpr>(E))
-      CounterMap[E] = NextCounter++;
+      mapRegion(E, RegionKind::Closure);
     return {true, E};
   }
 };
@@ -660,8 +700,19 @@ void SILGenProfiling::assignRegionCounters(AbstractFunctionDecl *Root) {
   walkForProfiling(Root, Mapper);
 
   NumRegionCounters = Mapper.NextCounter;
-  // TODO: Mapper needs to calculate a function hash as it goes.
-  FunctionHash = 0x0;
+  FunctionHash = Mapper.getHash();
+
+  if (SGM.PGOReader) {
+    std::string PGOFuncName = llvm::getPGOFuncName(
+        CurrentFuncName, getEquivalentPGOLinkage(CurrentFuncLinkage),
+        CurrentFileName);
+    // A function missing from the profile, or whose structure has changed
+    // since, so that its hash doesn't match, is simply left without counts.
+    if (SGM.PGOReader->getFunctionCounts(PGOFuncName, FunctionHash,
+                                         RegionCounts) ||
+        RegionCounts.size() != NumRegionCounters)
+      RegionCounts.clear();
+  }
 
   if (EmitCoverageMapping) {
     CoverageMapping Coverage(SGM.M.getASTContext().SourceMgr);
@@ -691,6 +742,18 @@ void SILGenProfiling::emitCounterIncrement(SILGenBuilder &Builder,ASTNode Node){
   assert(CounterIt != RegionCounterMap.end() &&
          "cannot increment non-existent counter");
 
+  // A block starts at the beginning of a region, so its first counter is the
+  // one that covers all of it. Counters of nested regions that don't start a
+  // block of their own, like closures, must not overwrite it.
+  if (!RegionCounts.empty() && Builder.hasValidInsertionPoint()) {
+    SILBasicBlock *BB = Builder.getInsertionBB();
+    if (!BB->getExecutionCount())
+      BB->setExecutionCount(RegionCounts[CounterIt->second]);
+  }
+
+  if (!SGM.M.getOptions().GenerateProfile)
+    return;
+
   auto Int32Ty = SGM.Types.getLoweredType(BuiltinIntegerType::get(32, C));
   auto Int64Ty = SGM.Types.getLoweredType(BuiltinIntegerType::get(64, C));
 
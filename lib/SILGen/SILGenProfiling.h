@@ -48,6 +48,10 @@ private:
   uint64_t FunctionHash;
   llvm::DenseMap<ASTNode, unsigned> RegionCounterMap;
 
+  /// The current function's counter values from the profile given with
+  /// -profile-use, indexed like RegionCounterMap, or empty if there are none.
+  std::vector<uint64_t> RegionCounts;
+
   std::vector<std::tuple<std::string, uint64_t, std::string>> CoverageData;
 
 public:
@@ -60,7 +64,9 @@ public:
   /// Map counters to ASTNodes and set them up for profiling the given function.
   void assignRegionCounters(AbstractFunctionDecl *Root);
 
-  /// Emit SIL to increment the counter for \c Node.
+  /// Emit SIL to increment the counter for \c Node, if instrumenting, and
+  /// record the counter's profiled value on the current block, if there is a
+  /// profile.
   void emitCounterIncrement(SILGenBuilder &Builder, ASTNode Node);
 };
 
@@ -30,13 +30,6 @@
 
 using namespace swift;
 
-
-// The AliasAnalysis Cache must not grow beyond this size.
-// We limit the size of the AA cache to 2**14 because we want to limit the
-// memory usage of this cache.
-static const int AliasAnalysisMaxCacheSize = 16384;
-
-
 //===----------------------------------------------------------------------===//
 //                                AA Debugging
 //===----------------------------------------------------------------------===//
@@ -507,13 +500,11 @@ bool AliasAnalysis::typesMayAlias(SILType T1, SILType T2) {
 
   // Check if we've already computed the TBAA relation.
   auto Key = std::make_pair(T1, T2);
-  auto Res = TypesMayAliasCache.find(Key);
-  if (Res != TypesMayAliasCache.end()) {
-    return Res->second;
-  }
+  if (bool *Res = TypesMayAliasCache.lookup(Key))
+    return *Res;
 
   bool MA = typedAccessTBAAMayAlias(T1, T2, *Mod);
-  TypesMayAliasCache[Key] = MA;
+  TypesMayAliasCache.insert(Key, MA);
   return MA;
 }
 
@@ -528,23 +519,21 @@ AliasResult AliasAnalysis::alias(SILValue V1, SILValue V2,
   AliasKeyTy Key = toAliasKey(V1, V2, TBAAType1, TBAAType2);
 
   // Check if we've already computed this result.
-  auto It = AliasCache.find(Key);
-  if (It != AliasCache.end()) {
-    return It->second;
-  }
-
-  // Flush the cache if the size of the cache is too large.
-  if (AliasCache.size() > AliasAnalysisMaxCacheSize) {
-    AliasCache.clear();
-    AliasValueBaseToIndex.clear();
-
-    // Key is no longer valid as we cleared the AliasValueBaseToIndex.
-    Key = toAliasKey(V1, V2, TBAAType1, TBAAType2);
+  if (auto *Cached = AliasCache.lookup(Key)) {
+    QueryUsedSummaries |= Cached->UsedSummaries;
+    return Cached->Result;
   }
 
-  // Calculate the aliasing result and store it in the cache.
+  // Calculate the aliasing result and store it in the cache. The cache evicts
+  // the least recently used entries if it is full.
+  bool OuterQueryUsedSummaries = QueryUsedSummaries;
+  QueryUsedSummaries = false;
   auto Result = aliasInner(V1, V2, TBAAType1, TBAAType2);
-  AliasCache[Key] = Result;
+  SILFunction *F = getParentFunction(V1);
+  if (!F)
+    F = getParentFunction(V2);
+  AliasCache.insert(Key, {Result, F, QueryUsedSummaries});
+  QueryUsedSummaries |= OuterQueryUsedSummaries;
   return Result;
 }
 
@@ -602,6 +591,7 @@ AliasResult AliasAnalysis::aliasInner(SILValue V1, SILValue V2,
   // content.
   // Note that escape analysis must work with the original pointers and not the
   // underlying objects because it treats projections differently.
+  QueryUsedSummaries = true;
   if (!EA->canPointToSameMemory(V1, V2)) {
     DEBUG(llvm::dbgs() << "            Found not-aliased objects based on"
                                       "escape analysis\n");
@@ -127,7 +127,16 @@ bool ColdBlockInfo::isSlowPath(const SILBasicBlock *FromBB,
   return ToBB == ColdTarget;
 }
 
-/// \return true if the given block is dominated by a _slowPath branch hint.
+bool ColdBlockInfo::isNeverExecuted(const SILBasicBlock *BB) {
+  auto Count = BB->getExecutionCount();
+  if (!Count || *Count != 0)
+    return false;
+  auto EntryCount = BB->getParent()->front().getExecutionCount();
+  return EntryCount && *EntryCount != 0;
+}
+
+/// \return true if the given block is dominated by a _slowPath branch hint,
+/// or by a block which the profile says never ran.
 ///
 /// Cache all blocks visited to avoid introducing quadratic behavior.
 bool ColdBlockInfo::isCold(const SILBasicBlock *BB, int recursionDepth) {
@@ -135,6 +144,11 @@ bool ColdBlockInfo::isCold(const SILBasicBlock *BB, int recursionDepth) {
   if (I != ColdBlockMap.end())
     return I->second;
 
+  if (isNeverExecuted(BB)) {
+    ColdBlockMap[BB] = true;
+    return true;
+  }
+
   typedef llvm::DomTreeNodeBase<SILBasicBlock> DomTreeNode;
   DominanceInfo *DT = DA->get(const_cast<SILFunction*>(BB->getParent()));
   DomTreeNode *Node = DT->getNode(const_cast<SILBasicBlock*>(BB));
@@ -147,7 +161,8 @@ bool ColdBlockInfo::isCold(const SILBasicBlock *BB, int recursionDepth) {
   bool IsCold = false;
   Node = Node->getIDom();
   while (Node) {
-    if (isSlowPath(Node->getBlock(), DomChain.back(), recursionDepth)) {
+    if (isSlowPath(Node->getBlock(), DomChain.back(), recursionDepth) ||
+        isNeverExecuted(Node->getBlock())) {
       IsCold = true;
       break;
     }
@@ -17,11 +17,23 @@
 #include "swift/SILOptimizer/Analysis/ValueTracking.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SIL/SILArgument.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace swift;
 
+STATISTIC(NumRecomputations, "Number of escape analysis recomputations");
+STATISTIC(NumFunctionsVisited,
+          "Number of functions visited in escape analysis recomputations");
+STATISTIC(NumFunctionsRecomputed,
+          "Number of functions whose connection graphs were recomputed");
+STATISTIC(NumFunctionsInvalidated,
+          "Number of functions whose connection graphs were invalidated, "
+          "including callers");
+STATISTIC(NumModuleInvalidations,
+          "Number of invalidations of all connection graphs");
+
 static bool isProjection(ValueBase *V) {
   switch (V->getKind()) {
     case ValueKind::IndexAddrInst:
@@ -1585,6 +1597,12 @@ void EscapeAnalysis::recompute(FunctionInfo *Initial) {
       FInfo->SummaryGraph.verify();
     }
   }
+
+  ++NumRecomputations;
+  NumFunctionsVisited += BottomUpOrder.getNumVisited();
+  NumFunctionsRecomputed += BottomUpOrder.getNumRecomputed();
+  DEBUG(llvm::dbgs() << "recomputed " << BottomUpOrder.getNumRecomputed() <<
+        " of " << BottomUpOrder.getNumVisited() << " visited functions\n");
 }
 
 bool EscapeAnalysis::mergeCalleeGraph(FullApplySite FAS,
@@ -1840,13 +1858,14 @@ bool EscapeAnalysis::canParameterEscape(FullApplySite FAS, int ParamIdx,
 void EscapeAnalysis::invalidate(InvalidationKind K) {
   Function2Info.clear();
   Allocator.DestroyAll();
+  ++NumModuleInvalidations;
   DEBUG(llvm::dbgs() << "invalidate all\n");
 }
 
 void EscapeAnalysis::invalidate(SILFunction *F, InvalidationKind K) {
   if (FunctionInfo *FInfo = Function2Info.lookup(F)) {
     DEBUG(llvm::dbgs() << "  invalidate " << FInfo->Graph.F->getName() << '\n');
-    invalidateIncludingAllCallers(FInfo);
+    NumFunctionsInvalidated += invalidateIncludingAllCallers(FInfo);
   }
 }
 
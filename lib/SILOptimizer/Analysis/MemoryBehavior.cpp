@@ -21,11 +21,6 @@
 
 using namespace swift;
 
-// The MemoryBehavior Cache must not grow beyond this size.
-// We limit the size of the MB cache to 2**14 because we want to limit the
-// memory usage of this cache.
-static const int MemoryBehaviorAnalysisMaxCacheSize = 16384;
-
 //===----------------------------------------------------------------------===//
 //                       Memory Behavior Implementation
 //===----------------------------------------------------------------------===//
@@ -56,11 +51,17 @@ class MemoryBehaviorVisitor
   /// MayHaveSideEffects.
   RetainObserveKind InspectionMode;
 
+  /// Set to true if the result is derived from the side-effect or escape
+  /// analysis.
+  bool &UsedSummaries;
+
 public:
   MemoryBehaviorVisitor(AliasAnalysis *AA, SideEffectAnalysis *SEA,
                         EscapeAnalysis *EA, SILValue V,
-                        RetainObserveKind IgnoreRefCountIncs)
-      : AA(AA), SEA(SEA), EA(EA), V(V), InspectionMode(IgnoreRefCountIncs) {}
+                        RetainObserveKind IgnoreRefCountIncs,
+                        bool &UsedSummaries)
+      : AA(AA), SEA(SEA), EA(EA), V(V), InspectionMode(IgnoreRefCountIncs),
+        UsedSummaries(UsedSummaries) {}
 
   SILType getValueTBAAType() {
     if (!TypedAccessTy)
@@ -224,6 +225,7 @@ MemBehavior MemoryBehaviorVisitor::visitBuiltinInst(BuiltinInst *BI) {
 MemBehavior MemoryBehaviorVisitor::visitTryApplyInst(TryApplyInst *AI) {
   MemBehavior Behavior = MemBehavior::MayHaveSideEffects;
   // Ask escape analysis.
+  UsedSummaries = true;
   if (!EA->canObjectOrContentEscapeTo(V, AI))
     Behavior = MemBehavior::None;
 
@@ -235,6 +237,7 @@ MemBehavior MemoryBehaviorVisitor::visitTryApplyInst(TryApplyInst *AI) {
 MemBehavior MemoryBehaviorVisitor::visitApplyInst(ApplyInst *AI) {
 
   SideEffectAnalysis::FunctionEffects ApplyEffects;
+  UsedSummaries = true;
   SEA->getEffects(ApplyEffects, AI);
 
   MemBehavior Behavior = MemBehavior::None;
@@ -278,6 +281,7 @@ MemBehavior MemoryBehaviorVisitor::visitApplyInst(ApplyInst *AI) {
 
 MemBehavior
 MemoryBehaviorVisitor::visitStrongReleaseInst(StrongReleaseInst *SI) {
+  UsedSummaries = true;
   if (!EA->canEscapeTo(V, SI))
     return MemBehavior::None;
   return MemBehavior::MayHaveSideEffects;
@@ -285,12 +289,14 @@ MemoryBehaviorVisitor::visitStrongReleaseInst(StrongReleaseInst *SI) {
 
 MemBehavior
 MemoryBehaviorVisitor::visitUnownedReleaseInst(UnownedReleaseInst *SI) {
+  UsedSummaries = true;
   if (!EA->canEscapeTo(V, SI))
     return MemBehavior::None;
   return MemBehavior::MayHaveSideEffects;
 }
 
 MemBehavior MemoryBehaviorVisitor::visitReleaseValueInst(ReleaseValueInst *SI) {
+  UsedSummaries = true;
   if (!EA->canEscapeTo(V, SI))
     return MemBehavior::None;
   return MemBehavior::MayHaveSideEffects;
@@ -306,23 +312,19 @@ AliasAnalysis::computeMemoryBehavior(SILInstruction *Inst, SILValue V,
   MemBehaviorKeyTy Key = toMemoryBehaviorKey(SILValue(Inst), V,
                                              InspectionMode);
   // Check if we've already computed this result.
-  auto It = MemoryBehaviorCache.find(Key);
-  if (It != MemoryBehaviorCache.end()) {
-    return It->second;
-  }
-
-  // Flush the cache if the size of the cache is too large.
-  if (MemoryBehaviorCache.size() > MemoryBehaviorAnalysisMaxCacheSize) {
-    MemoryBehaviorCache.clear();
-    MemoryBehaviorValueBaseToIndex.clear();
-
-    // Key is no longer valid as we cleared the MemoryBehaviorValueBaseToIndex.
-    Key = toMemoryBehaviorKey(SILValue(Inst), V, InspectionMode);
+  if (auto *Cached = MemoryBehaviorCache.lookup(Key)) {
+    QueryUsedSummaries |= Cached->UsedSummaries;
+    return Cached->Result;
   }
 
-  // Calculate the aliasing result and store it in the cache.
+  // Calculate the aliasing result and store it in the cache. The cache evicts
+  // the least recently used entries if it is full.
+  bool OuterQueryUsedSummaries = QueryUsedSummaries;
+  QueryUsedSummaries = false;
   auto Result = computeMemoryBehaviorInner(Inst, V, InspectionMode);
-  MemoryBehaviorCache[Key] = Result;
+  MemoryBehaviorCache.insert(Key,
+                             {Result, Inst->getFunction(), QueryUsedSummaries});
+  QueryUsedSummaries |= OuterQueryUsedSummaries;
   return Result;
 }
 
@@ -332,7 +334,8 @@ AliasAnalysis::computeMemoryBehaviorInner(SILInstruction *Inst, SILValue V,
   DEBUG(llvm::dbgs() << "GET MEMORY BEHAVIOR FOR:\n    " << *Inst << "    "
                      << *V);
   assert(SEA && "SideEffectsAnalysis must be initialized!");
-  return MemoryBehaviorVisitor(this, SEA, EA, V, InspectionMode).visit(Inst);
+  return MemoryBehaviorVisitor(this, SEA, EA, V, InspectionMode,
+                               QueryUsedSummaries).visit(Inst);
 }
 
 MemBehaviorKeyTy AliasAnalysis::toMemoryBehaviorKey(SILValue V1, SILValue V2,
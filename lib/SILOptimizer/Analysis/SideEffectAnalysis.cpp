@@ -16,9 +16,21 @@
 #include "swift/SILOptimizer/Analysis/FunctionOrder.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SIL/SILArgument.h"
+#include "llvm/ADT/Statistic.h"
 
 using namespace swift;
 
+STATISTIC(NumRecomputations, "Number of side-effect recomputations");
+STATISTIC(NumFunctionsVisited,
+          "Number of functions visited in side-effect recomputations");
+STATISTIC(NumFunctionsRecomputed,
+          "Number of functions whose side-effects were recomputed");
+STATISTIC(NumFunctionsInvalidated,
+          "Number of functions whose side-effects were invalidated, "
+          "including callers");
+STATISTIC(NumModuleInvalidations,
+          "Number of invalidations of all side-effect information");
+
 using FunctionEffects = SideEffectAnalysis::FunctionEffects;
 using Effects = SideEffectAnalysis::Effects;
 using MemoryBehavior = SILInstruction::MemoryBehavior;
@@ -462,6 +474,12 @@ void SideEffectAnalysis::recompute(FunctionInfo *Initial) {
       }
     }
   } while (NeedAnotherIteration);
+
+  ++NumRecomputations;
+  NumFunctionsVisited += BottomUpOrder.getNumVisited();
+  NumFunctionsRecomputed += BottomUpOrder.getNumRecomputed();
+  DEBUG(llvm::dbgs() << "recomputed " << BottomUpOrder.getNumRecomputed() <<
+        " of " << BottomUpOrder.getNumVisited() << " visited functions\n");
 }
 
 void SideEffectAnalysis::getEffects(FunctionEffects &ApplyEffects, FullApplySite FAS) {
@@ -503,13 +521,14 @@ void SideEffectAnalysis::getEffects(FunctionEffects &ApplyEffects, FullApplySite
 void SideEffectAnalysis::invalidate(InvalidationKind K) {
   Function2Info.clear();
   Allocator.DestroyAll();
+  ++NumModuleInvalidations;
   DEBUG(llvm::dbgs() << "invalidate all\n");
 }
 
 void SideEffectAnalysis::invalidate(SILFunction *F, InvalidationKind K) {
   if (FunctionInfo *FInfo = Function2Info.lookup(F)) {
     DEBUG(llvm::dbgs() << "  invalidate " << FInfo->F->getName() << '\n');
-    invalidateIncludingAllCallers(FInfo);
+    NumFunctionsInvalidated += invalidateIncludingAllCallers(FInfo);
   }
 }
 
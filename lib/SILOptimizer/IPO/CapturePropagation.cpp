@@ -312,12 +312,13 @@ bool CapturePropagation::optimizePartialApply(PartialApplyInst *PAI) {
   ++NumCapturesPropagated;
   SILFunction *NewF = specializeConstClosure(PAI, SubstF);
   rewritePartialApply(PAI, NewF);
+  notifyAnalysisOfFunction(NewF);
   return true;
 }
 
 void CapturePropagation::run() {
   DominanceAnalysis *DA = PM->getAnalysis<DominanceAnalysis>();
-  bool HasChanged = false;
+  llvm::SmallVector<SILFunction *, 16> ChangedFunctions;
   for (auto &F : *getModule()) {
 
     // Don't optimize functions that are marked with the opt.never attribute.
@@ -326,6 +327,7 @@ void CapturePropagation::run() {
 
     // Cache cold blocks per function.
     ColdBlockInfo ColdBlocks(DA);
+    bool HasChanged = false;
     for (auto &BB : F) {
       if (ColdBlocks.isCold(&BB))
         continue;
@@ -338,10 +340,14 @@ void CapturePropagation::run() {
           HasChanged |= optimizePartialApply(PAI);
       }
     }
+    if (HasChanged)
+      ChangedFunctions.push_back(&F);
   }
 
-  if (HasChanged) {
-    invalidateAnalysis(SILAnalysis::InvalidationKind::Everything);
+  // Only the functions which contain the rewritten partial_apply instructions
+  // are changed. The specialized closures are new functions.
+  for (SILFunction *F : ChangedFunctions) {
+    invalidateAnalysis(F, SILAnalysis::InvalidationKind::Everything);
   }
 }
 
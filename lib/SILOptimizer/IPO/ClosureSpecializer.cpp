@@ -426,8 +426,8 @@ void CallSiteDescriptor::extendArgumentLifetime(SILValue Arg) const {
   }
 }
 
-static void specializeClosure(ClosureInfo &CInfo,
-                              CallSiteDescriptor &CallDesc) {
+static SILFunction *specializeClosure(ClosureInfo &CInfo,
+                                      CallSiteDescriptor &CallDesc) {
   auto NewFName = CallDesc.createName();
   DEBUG(llvm::dbgs() << "    Perform optimizations with new name " << NewFName
                      << '\n');
@@ -443,6 +443,7 @@ static void specializeClosure(ClosureInfo &CInfo,
 
   // Rewrite the call
   rewriteApplyInst(CallDesc, NewF);
+  return NewF;
 }
 
 static bool isSupportedClosure(const SILInstruction *Closure) {
@@ -695,6 +696,10 @@ class ClosureSpecializer {
   std::vector<SILInstruction *> PropagatedClosures;
   bool IsPropagatedClosuresUniqued = false;
 
+  /// The functions which are called instead of the original callees. They
+  /// may be new functions or existing specializations.
+  std::vector<SILFunction *> SpecializedFunctions;
+
 public:
   ClosureSpecializer() = default;
 
@@ -712,6 +717,10 @@ public:
 
     return PropagatedClosures;
   }
+
+  ArrayRef<SILFunction *> getSpecializedFunctions() {
+    return SpecializedFunctions;
+  }
 };
 
 } // end anonymous namespace
@@ -850,7 +859,7 @@ bool ClosureSpecializer::specialize(SILFunction *Caller) {
       if (MultipleClosureAI.count(CSDesc.getApplyInst()))
         continue;
 
-      specializeClosure(*CInfo, CSDesc);
+      SpecializedFunctions.push_back(specializeClosure(*CInfo, CSDesc));
       PropagatedClosures.push_back(CSDesc.getClosure());
       Changed = true;
     }
@@ -872,7 +881,7 @@ public:
   void run() override {
     auto *BCA = getAnalysis<BasicCalleeAnalysis>();
 
-    bool Changed = false;
+    llvm::SmallVector<SILFunction *, 16> ChangedCallers;
     ClosureSpecializer C;
 
     BottomUpFunctionOrder Ordering(*getModule(), BCA);
@@ -888,13 +897,19 @@ public:
       if (F->isExternalDeclaration())
         continue;
 
-      Changed |= C.specialize(F);
+      if (C.specialize(F))
+        ChangedCallers.push_back(F);
     }
 
-    // Invalidate everything since we delete calls as well as add new
-    // calls and branches.
-    if (Changed) {
-      invalidateAnalysis(SILAnalysis::InvalidationKind::Everything);
+    // Invalidate everything in the callers since we delete calls as well as
+    // add new calls and branches. The specialized closures are new functions
+    // and the remaining functions are not changed, so their (possibly
+    // expensive interprocedural) analysis data can be kept.
+    for (SILFunction *Caller : ChangedCallers) {
+      invalidateAnalysis(Caller, SILAnalysis::InvalidationKind::Everything);
+    }
+    for (SILFunction *NewF : C.getSpecializedFunctions()) {
+      notifyAnalysisOfFunction(NewF);
     }
 
     // If for testing purposes we were asked to not eliminate dead closures,
@@ -458,7 +458,7 @@ void EagerSpecializerTransform::run() {
     return;
   
   // Process functions in any order.
-  bool Changed = false;
+  llvm::SmallVector<SILFunction *, 16> ChangedFunctions;
   for (auto &F : *getModule()) {
     if (!F.shouldOptimize()) {
       DEBUG(dbgs() << "  Cannot specialize function " << F.getName()
@@ -481,21 +481,26 @@ void EagerSpecializerTransform::run() {
     }
 
     // Emit a type check and dispatch to each specialized function.
+    bool Changed = false;
     for_each3(F.getSpecializeAttrs(), SpecializedFuncs, ReInfoVec,
              [&](const SILSpecializeAttr *SA, SILFunction *NewFunc,
                  const ReabstractionInfo &ReInfo) {
       if (NewFunc) {
         Changed = true;
         EagerDispatch(&F, *SA, ReInfo).emitDispatchTo(NewFunc);
+        notifyAnalysisOfFunction(NewFunc);
       }
     });
     // As specializations are created, the attributes should be removed.
     F.clearSpecializeAttrs();
+    if (Changed)
+      ChangedFunctions.push_back(&F);
   }
-  // Invalidate everything since we delete calls as well as add new
-  // calls and branches.
-  if (Changed) {
-    invalidateAnalysis(SILAnalysis::InvalidationKind::Everything);
+  // Invalidate everything in the functions which got a dispatch, since we
+  // delete calls as well as add new calls and branches. The specializations
+  // are new functions.
+  for (SILFunction *F : ChangedFunctions) {
+    invalidateAnalysis(F, SILAnalysis::InvalidationKind::Everything);
   }
 }
 
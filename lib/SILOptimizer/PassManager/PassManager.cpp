@@ -13,6 +13,7 @@
 #define DEBUG_TYPE "sil-passmanager"
 
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Basic/Timer.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SIL/SILFunction.h"
 #include "swift/SIL/SILModule.h"
@@ -256,7 +257,10 @@ void SILPassManager::runPassesOnFunction(PassList FuncTransforms,
     Mod->registerDeleteNotificationHandler(SFT);
     if (breakBeforeRunning(F->getName(), SFT->getName()))
       LLVM_BUILTIN_DEBUGTRAP;
-    SFT->run();
+    {
+      TraceSpan Span(SFT->getName(), "SIL pass");
+      SFT->run();
+    }
     assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
     Mod->removeDeleteNotificationHandler(SFT);
 
@@ -430,7 +434,10 @@ void SILPassManager::runModulePass(SILModuleTransform *SMT) {
   llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
   Mod->registerDeleteNotificationHandler(SMT);
-  SMT->run();
+  {
+    TraceSpan Span(SMT->getName(), "SIL pass");
+    SMT->run();
+  }
   Mod->removeDeleteNotificationHandler(SMT);
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
 
@@ -19,6 +19,7 @@
 
 #include "swift/SIL/SILFunction.h"
 #include "swift/SIL/SILInstruction.h"
+#include "swift/SILOptimizer/Analysis/ColdBlockInfo.h"
 #include "swift/SILOptimizer/Utils/Generics.h"
 #include "swift/SILOptimizer/Utils/Local.h"
 #include "swift/SILOptimizer/PassManager/Transforms.h"
@@ -53,6 +54,11 @@ bool GenericSpecializer::specializeAppliesInFunction(SILFunction &F) {
 
   bool Changed = false;
   for (auto &BB : F) {
+    // Specializing calls which the profile says never ran would only add
+    // code.
+    if (ColdBlockInfo::isNeverExecuted(&BB))
+      continue;
+
     // Collect the applies for this block in reverse order so that we
     // can pop them off the end of our vector and process them in
     // forward order.
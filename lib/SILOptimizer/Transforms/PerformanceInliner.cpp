@@ -1014,6 +1014,10 @@ class SILPerformanceInliner {
     /// The benefit of a onFastPath builtin.
     FastPathBuiltinBenefit = RemovedCallBenefit + 40,
 
+    /// The benefit of inlining a call which the profile saw run more often
+    /// than its caller was entered, i.e. in a hot loop.
+    ProfiledHotCallBenefit = RemovedCallBenefit + 40,
+
     /// Approximately up to this cost level a function can be inlined without
     /// increasing the code size.
     TrivialFunctionThreshold = 18,
@@ -1159,6 +1163,14 @@ SILFunction *SILPerformanceInliner::getEligibleFunction(FullApplySite AI) {
   return Callee;
 }
 
+/// Return true if the profile given with -profile-use saw the call site \p AI
+/// run more often than its caller was entered.
+static bool isHotInProfile(FullApplySite AI) {
+  auto Count = AI.getParent()->getExecutionCount();
+  auto EntryCount = AI.getFunction()->front().getExecutionCount();
+  return Count && EntryCount && *Count > *EntryCount;
+}
+
 /// Return true if inlining this call site is profitable.
 bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
                                               Weight CallerWeight,
@@ -1193,6 +1205,10 @@ bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
 
   CallerWeight.updateBenefit(Benefit, BaseBenefit);
 
+  // The profile may know of hot paths which the loop structure doesn't show.
+  if (isHotInProfile(AI))
+    CallerWeight.updateBenefit(Benefit, ProfiledHotCallBenefit);
+
   // Go through all blocks of the function, accumulate the cost and find
   // benefits.
   while (SILBasicBlock *block = domOrder.getNext()) {
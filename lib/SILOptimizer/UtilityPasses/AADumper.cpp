@@ -26,10 +26,16 @@
 #include "swift/SILOptimizer/Analysis/SideEffectAnalysis.h"
 #include "swift/SILOptimizer/Analysis/Analysis.h"
 #include "swift/SILOptimizer/PassManager/Transforms.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 
 using namespace swift;
 
+static llvm::cl::opt<bool>
+DumpCacheStats("aa-dump-cache-stats", llvm::cl::init(false),
+               llvm::cl::desc("Print the hit rates of the alias analysis "
+                              "caches after dumping the alias relations"));
+
 //===----------------------------------------------------------------------===//
 //                               Value Gatherer
 //===----------------------------------------------------------------------===//
@@ -95,6 +101,28 @@ class SILAADumper : public SILModuleTransform {
       }
           llvm::outs() << "\n";
     }
+
+    if (DumpCacheStats)
+      printCacheStats(PM->getAnalysis<AliasAnalysis>());
+  }
+
+  static void printCacheStats(AliasAnalysis *AA) {
+    auto printCache = [](StringRef Name, unsigned Hits, unsigned Misses,
+                         unsigned Evictions) {
+      unsigned Queries = Hits + Misses;
+      llvm::outs() << Name << " cache: " << Queries << " queries, " << Hits
+                   << " hits (";
+      if (Queries)
+        llvm::outs() << (uint64_t(Hits) * 100 / Queries);
+      else
+        llvm::outs() << 0;
+      llvm::outs() << "%), " << Evictions << " evictions\n";
+    };
+    printCache("Alias", AA->getNumAliasCacheHits(),
+               AA->getNumAliasCacheMisses(), AA->getNumAliasCacheEvictions());
+    printCache("Memory behavior", AA->getNumMemoryBehaviorCacheHits(),
+               AA->getNumMemoryBehaviorCacheMisses(),
+               AA->getNumMemoryBehaviorCacheEvictions());
   }
 
   StringRef getName() override { return "AA Dumper"; }
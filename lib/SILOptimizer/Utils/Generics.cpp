@@ -16,9 +16,14 @@
 #include "swift/SILOptimizer/Utils/Generics.h"
 #include "swift/SILOptimizer/Utils/GenericCloner.h"
 #include "swift/SIL/DebugUtils.h"
+#include "llvm/ADT/Statistic.h"
 
 using namespace swift;
 
+STATISTIC(NumSpecializationsCreated, "Number of specializations created");
+STATISTIC(NumSpecializedInsts,
+          "Number of instructions in the specializations created");
+
 // =============================================================================
 // ReabstractionInfo
 // =============================================================================
@@ -192,6 +197,19 @@ SILFunction *GenericFuncSpecializer::tryCreateSpecialization() {
 
   // Check if this specialization should be linked for prespecialization.
   linkSpecialization(M, SpecializedF);
+
+  // Export the specialization for other modules to call, if it is of a
+  // function defined in this module. Without whole-module optimization
+  // several object files of this module could export it. Specializations of
+  // generics from other modules are not exported: every module built with
+  // -export-specializations would define the same strong symbol.
+  if (M.getOptions().ExportSpecializations && M.isWholeModule() &&
+      !Fragile && GenericFunc->getLinkage() == SILLinkage::Public)
+    SpecializedF->setKeepAsPublic(true);
+
+  ++NumSpecializationsCreated;
+  for (auto &BB : *SpecializedF)
+    NumSpecializedInsts += std::distance(BB.begin(), BB.end());
   return SpecializedF;
 }
 
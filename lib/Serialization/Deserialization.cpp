@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "Serialization"
 #include "swift/Serialization/ModuleFile.h"
 #include "swift/Serialization/ModuleFormat.h"
 #include "swift/AST/AST.h"
@@ -19,11 +20,16 @@
 #include "swift/ClangImporter/ClangImporter.h"
 #include "swift/Parse/Parser.h"
 #include "swift/Serialization/BCReadingExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace swift;
 using namespace swift::serialization;
 
+STATISTIC(NumDeclsDeserialized, "Number of decls deserialized");
+STATISTIC(NumTypesDeserialized, "Number of types deserialized");
+STATISTIC(NumIdentifiersDeserialized, "Number of identifiers deserialized");
+
 namespace {
   struct IDAndKind {
     const Decl *D;
@@ -1412,7 +1418,7 @@ Identifier ModuleFile::getIdentifier(IdentifierID IID) {
 
   size_t rawID = IID - NUM_SPECIAL_MODULES;
   assert(rawID < Identifiers.size() && "invalid identifier ID");
-  auto identRecord = Identifiers[rawID];
+  auto &identRecord = Identifiers[rawID];
 
   if (identRecord.Offset == 0)
     return identRecord.Ident;
@@ -1424,7 +1430,11 @@ Identifier ModuleFile::getIdentifier(IdentifierID IID) {
   assert(terminatorOffset != StringRef::npos &&
          "unterminated identifier string data");
 
-  return getContext().getIdentifier(rawStrPtr.slice(0, terminatorOffset));
+  ++NumIdentifiersDeserialized;
+  identRecord.Ident =
+      getContext().getIdentifier(rawStrPtr.slice(0, terminatorOffset));
+  identRecord.Offset = 0;
+  return identRecord.Ident;
 }
 
 DeclContext *ModuleFile::getLocalDeclContext(DeclContextID DCID) {
@@ -1824,6 +1834,8 @@ Decl *ModuleFile::getDecl(DeclID DID, Optional<DeclContext *> ForcedContext) {
   if (declOrOffset.isComplete())
     return declOrOffset;
 
+  ++NumDeclsDeserialized;
+
   BCOffsetRAII restoreOffset(DeclTypeCursor);
   DeclTypeCursor.JumpToBit(declOrOffset);
   auto entry = DeclTypeCursor.advance();
@@ -3357,6 +3369,8 @@ Type ModuleFile::getType(TypeID TID) {
   if (typeOrOffset.isComplete())
     return typeOrOffset;
 
+  ++NumTypesDeserialized;
+
   BCOffsetRAII restoreOffset(DeclTypeCursor);
   DeclTypeCursor.JumpToBit(typeOrOffset);
   auto entry = DeclTypeCursor.advance();
@@ -22,6 +22,7 @@
 #include "swift/Serialization/BCReadingExtras.h"
 #include "swift/Serialization/SerializedModuleLoader.h"
 
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/OnDiskHashTable.h"
@@ -453,6 +454,29 @@ ModuleFile::readObjCMethodTable(ArrayRef<uint64_t> fields, StringRef blobData) {
                                              base + sizeof(uint32_t), base));
 }
 
+/// Returns the code of the record at \p cursor's position, which uses the
+/// abbreviation \p abbrevID, without decoding the rest of the record.
+static unsigned peekRecordCode(llvm::BitstreamCursor cursor,
+                               unsigned abbrevID) {
+  if (abbrevID == llvm::bitc::UNABBREV_RECORD)
+    return cursor.ReadVBR(6);
+
+  const llvm::BitCodeAbbrevOp &codeOp =
+      cursor.getAbbrev(abbrevID)->getOperandInfo(0);
+  if (codeOp.isLiteral())
+    return codeOp.getLiteralValue();
+  switch (codeOp.getEncoding()) {
+  case llvm::BitCodeAbbrevOp::Fixed:
+    return cursor.Read(codeOp.getEncodingData());
+  case llvm::BitCodeAbbrevOp::VBR:
+    return cursor.ReadVBR64(codeOp.getEncodingData());
+  case llvm::BitCodeAbbrevOp::Char6:
+    return llvm::BitCodeAbbrevOp::DecodeChar6(cursor.Read(6));
+  default:
+    llvm_unreachable("invalid abbreviation for a record code");
+  }
+}
+
 bool ModuleFile::readIndexBlock(llvm::BitstreamCursor &cursor) {
   cursor.EnterSubBlock(INDEX_BLOCK_ID);
 
@@ -475,27 +499,40 @@ bool ModuleFile::readIndexBlock(llvm::BitstreamCursor &cursor) {
       break;
 
     case llvm::BitstreamEntry::Record:
-      scratch.clear();
-      blobData = {};
-      unsigned kind = cursor.readRecord(next.ID, scratch, &blobData);
-
-      switch (kind) {
+      switch (peekRecordCode(cursor, next.ID)) {
       case index_block::DECL_OFFSETS:
-        assert(blobData.empty());
-        Decls.assign(scratch.begin(), scratch.end());
-        break;
+        Decls.setRecord(cursor, next.ID);
+        cursor.skipRecord(next.ID);
+        continue;
       case index_block::DECL_CONTEXT_OFFSETS:
-        assert(blobData.empty());
-        DeclContexts.assign(scratch.begin(), scratch.end());
-        break;
+        DeclContexts.setRecord(cursor, next.ID);
+        cursor.skipRecord(next.ID);
+        continue;
       case index_block::TYPE_OFFSETS:
-        assert(blobData.empty());
-        Types.assign(scratch.begin(), scratch.end());
-        break;
+        Types.setRecord(cursor, next.ID);
+        cursor.skipRecord(next.ID);
+        continue;
       case index_block::IDENTIFIER_OFFSETS:
-        assert(blobData.empty());
-        Identifiers.assign(scratch.begin(), scratch.end());
+        Identifiers.setRecord(cursor, next.ID);
+        cursor.skipRecord(next.ID);
+        continue;
+      case index_block::LOCAL_DECL_CONTEXT_OFFSETS:
+        LocalDeclContexts.setRecord(cursor, next.ID);
+        cursor.skipRecord(next.ID);
+        continue;
+      case index_block::NORMAL_CONFORMANCE_OFFSETS:
+        NormalConformances.setRecord(cursor, next.ID);
+        cursor.skipRecord(next.ID);
+        continue;
+      default:
         break;
+      }
+
+      scratch.clear();
+      blobData = {};
+      unsigned kind = cursor.readRecord(next.ID, scratch, &blobData);
+
+      switch (kind) {
       case index_block::TOP_LEVEL_DECLS:
         TopLevelDecls = readDeclTable(scratch, blobData);
         break;
@@ -521,14 +558,6 @@ bool ModuleFile::readIndexBlock(llvm::BitstreamCursor &cursor) {
       case index_block::LOCAL_TYPE_DECLS:
         LocalTypeDecls = readLocalDeclTable(scratch, blobData);
         break;
-      case index_block::LOCAL_DECL_CONTEXT_OFFSETS:
-        assert(blobData.empty());
-        LocalDeclContexts.assign(scratch.begin(), scratch.end());
-        break;
-      case index_block::NORMAL_CONFORMANCE_OFFSETS:
-        assert(blobData.empty());
-        NormalConformances.assign(scratch.begin(), scratch.end());
-        break;
 
       default:
         // Unknown index kind, which this version of the compiler won't use.
@@ -1313,7 +1342,9 @@ void ModuleFile::loadExtensions(NominalTypeDecl *nominal) {
   if (!ExtensionDecls)
     return;
 
-  auto iter = ExtensionDecls->find(nominal->getName());
+  SmallString<64> key;
+  getExtensionTableKey(nominal, key);
+  auto iter = ExtensionDecls->find(getContext().getIdentifier(key));
   if (iter == ExtensionDecls->end())
     return;
 
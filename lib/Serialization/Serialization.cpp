@@ -3985,7 +3985,9 @@ void Serializer::writeAST(ModuleOrSourceFile DC) {
       } else if (auto ED = dyn_cast<ExtensionDecl>(D)) {
         Type extendedTy = ED->getExtendedType();
         const NominalTypeDecl *extendedNominal = extendedTy->getAnyNominal();
-        extensionDecls[extendedNominal->getName()]
+        SmallString<64> key;
+        getExtensionTableKey(extendedNominal, key);
+        extensionDecls[M->getASTContext().getIdentifier(key)]
           .push_back({ getKindForTable(extendedNominal), addDeclRef(D) });
       } else if (auto OD = dyn_cast<OperatorDecl>(D)) {
         operatorDecls[OD->getName()]
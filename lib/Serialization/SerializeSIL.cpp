@@ -1861,6 +1861,16 @@ void SILSerializer::writeSILBlock(const SILModule *SILMod) {
     processSILFunctionWorklist();
   }
 
+  // Declare the specializations this module exports, so that importing
+  // modules can refer to them.
+  if (SILMod->getOptions().ExportSpecializations) {
+    for (const SILFunction &F : *SILMod) {
+      if (F.isKeepAsPublic() && hasPublicVisibility(F.getLinkage()) &&
+          !FuncsToEmit.count(&F))
+        FuncsToEmit[&F] = true;
+    }
+  }
+
   // Now write function declarations for every function we've
   // emitted a reference to without emitting a function body for.
   for (const SILFunction &F : *SILMod) {
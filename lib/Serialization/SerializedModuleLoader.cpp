@@ -41,12 +41,20 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
                 std::unique_ptr<llvm::MemoryBuffer> &ModuleBuffer,
                 std::unique_ptr<llvm::MemoryBuffer> &ModuleDocBuffer,
                 llvm::SmallVectorImpl<char> &Scratch) {
+  // Module files are read in place rather than copied, and don't need to be
+  // null-terminated; this lets MemoryBuffer map any but the smallest files,
+  // so that the pages are shared between processes importing the same module.
+  auto getFile = [](StringRef path) {
+    return llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                       /*RequiresNullTerminator=*/false);
+  };
+
   // Try to open the module file first.  If we fail, don't even look for the
   // module documentation file.
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    getFile(StringRef(Scratch.data(), Scratch.size()));
   if (!ModuleOrErr)
     return ModuleOrErr.getError();
 
@@ -55,7 +63,7 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleDocFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleDocOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    getFile(StringRef(Scratch.data(), Scratch.size()));
   if (!ModuleDocOrErr &&
       ModuleDocOrErr.getError() != std::errc::no_such_file_or_directory) {
     return ModuleDocOrErr.getError();
@@ -1,5 +1,6 @@
 #include "swift/Reflection/ReflectionContext.h"
 #include "swift/Remote/CMemoryReader.h"
+#include "swift/Remote/CachingMemoryReader.h"
 #include "swift/SwiftRemoteMirror/SwiftRemoteMirror.h"
 
 using namespace swift;
@@ -23,7 +24,8 @@ swift_reflection_createReflectionContext(PointerSizeFunction getPointerSize,
     getSymbolAddress
   };
 
-  auto Reader = std::make_shared<CMemoryReader>(ReaderImpl);
+  auto Reader = std::make_shared<CachingMemoryReader>(
+    std::make_shared<CMemoryReader>(ReaderImpl));
   auto Context
     = new ReflectionContext<External<RuntimeTarget<sizeof(uintptr_t)>>>(Reader);
   return reinterpret_cast<SwiftReflectionContextRef>(Context);
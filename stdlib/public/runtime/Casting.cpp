@@ -18,11 +18,13 @@
 #include "swift/Basic/Demangle.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Config.h"
 #include "swift/Runtime/Enum.h"
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "swift/Runtime/Debug.h"
 #include "ErrorObject.h"
@@ -665,6 +667,141 @@ static bool _conformsToProtocols(const OpaqueValue *value,
   return true;
 }
 
+namespace {
+  struct DynamicCastCacheKey {
+    const Metadata *Type;
+    const ExistentialTypeMetadata *Target;
+  };
+
+  /// The cached outcome of casting values of a concrete type to an
+  /// existential type: either the witness tables to store in the
+  /// existential container, or failure.
+  ///
+  /// The outcome does not depend on the cast flags, which only control
+  /// ownership of the source value and whether failure is fatal.
+  class DynamicCastCacheEntry {
+    const Metadata *Type;
+    const ExistentialTypeMetadata *Target;
+
+    /// Succeeded if the cast succeeds; otherwise the conformance generation
+    /// at which it was found to fail.
+    std::atomic<uintptr_t> State;
+
+    /// The witness tables follow the entry, one per protocol of Target.
+    std::atomic<const WitnessTable *> *getWitnessTableBuffer() {
+      return reinterpret_cast<std::atomic<const WitnessTable *> *>(this + 1);
+    }
+
+  public:
+    static constexpr uintptr_t Succeeded = ~uintptr_t(0);
+
+    DynamicCastCacheEntry(const DynamicCastCacheKey &key, uintptr_t state,
+                          const WitnessTable * const *witnessTables)
+      : Type(key.Type), Target(key.Target), State(0) {
+      update(state, witnessTables);
+    }
+
+    long getKeyIntValueForDump() const {
+      return reinterpret_cast<long>(Type);
+    }
+
+    static size_t getKeyHash(const DynamicCastCacheKey &key) {
+      return llvm::hash_combine(key.Type, key.Target);
+    }
+
+    int compareWithKey(const DynamicCastCacheKey &key) const {
+      if (key.Type != Type) {
+        return (uintptr_t(key.Type) < uintptr_t(Type) ? -1 : 1);
+      } else if (key.Target != Target) {
+        return (uintptr_t(key.Target) < uintptr_t(Target) ? -1 : 1);
+      } else {
+        return 0;
+      }
+    }
+
+    template <class... Args>
+    static size_t getExtraAllocationSize(const DynamicCastCacheKey &key,
+                                         Args &&... ignored) {
+      return key.Target->Protocols.NumProtocols
+        * sizeof(std::atomic<const WitnessTable *>);
+    }
+
+    uintptr_t getState() const {
+      return State.load(std::memory_order_acquire);
+    }
+
+    /// Record a new outcome.  A success is never downgraded: it can't be
+    /// undone by loading more conformances.
+    void update(uintptr_t state, const WitnessTable * const *witnessTables) {
+      if (state == Succeeded) {
+        auto buffer = getWitnessTableBuffer();
+        for (unsigned i = 0, e = Target->Protocols.NumProtocols; i != e; ++i)
+          buffer[i].store(witnessTables[i], std::memory_order_relaxed);
+        State.store(Succeeded, std::memory_order_release);
+      } else if (getState() != Succeeded) {
+        State.store(state, std::memory_order_relaxed);
+      }
+    }
+
+    /// Copy out the witness tables of a successful cast.
+    void getWitnessTables(const WitnessTable **witnessTables) {
+      assert(getState() == Succeeded);
+      auto buffer = getWitnessTableBuffer();
+      for (unsigned i = 0, e = Target->Protocols.NumProtocols; i != e; ++i)
+        witnessTables[i] = buffer[i].load(std::memory_order_relaxed);
+    }
+  };
+}
+
+/// The cached outcomes of casts from concrete types to existential types.
+static Lazy<ConcurrentMap<DynamicCastCacheEntry>> DynamicCastCache;
+
+/// Check whether a type conforms to all of the protocols of an existential
+/// type, filling in its witness tables.  Repeat checks for the same type
+/// and existential are answered from DynamicCastCache.
+static bool _conformsToExistentialProtocols(
+                                     const OpaqueValue *value,
+                                     const Metadata *type,
+                                     const ExistentialTypeMetadata *targetType,
+                                     const WitnessTable **conformances) {
+  // Only cache existentials made entirely of Swift protocols. Whether a type
+  // conforms to those depends only on the type and the conformance records
+  // loaded so far, never on the value or on the Objective-C runtime.
+  auto &protocols = targetType->Protocols;
+  for (unsigned i = 0, n = protocols.NumProtocols; i != n; ++i) {
+    if (!protocols[i]->Flags.needsWitnessTable())
+      return _conformsToProtocols(value, type, protocols, conformances);
+  }
+
+  DynamicCastCacheKey key{type, targetType};
+  auto &cache = DynamicCastCache.get();
+  auto entry = cache.find(key);
+  if (entry) {
+    auto state = entry->getState();
+    if (state == DynamicCastCacheEntry::Succeeded) {
+      entry->getWitnessTables(conformances);
+      return true;
+    }
+    if (state == _swift_getProtocolConformanceGeneration())
+      return false;
+  }
+
+  // Take the generation before looking, so that conformances registered
+  // while we look make a cached failure stale rather than being missed.
+  uintptr_t generation = _swift_getProtocolConformanceGeneration();
+  bool result = _conformsToProtocols(value, type, protocols, conformances);
+  uintptr_t state = result ? DynamicCastCacheEntry::Succeeded : generation;
+
+  if (entry) {
+    entry->update(state, conformances);
+  } else {
+    auto insertResult = cache.getOrInsert(key, state, conformances);
+    if (!insertResult.second)
+      insertResult.first->update(state, conformances);
+  }
+  return result;
+}
+
 static bool shouldDeallocateSource(bool castSucceeded, DynamicCastFlags flags) {
   return (castSucceeded && (flags & DynamicCastFlags::TakeOnSuccess)) ||
         (!castSucceeded && (flags & DynamicCastFlags::DestroyOnFailure));
@@ -985,9 +1122,9 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
     }
 
     // Check for protocol conformances and fill in the witness tables.
-    if (!_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              destExistential->getWitnessTables())) {
+    if (!_conformsToExistentialProtocols(srcDynamicValue, srcDynamicType,
+                                   targetType,
+                                   destExistential->getWitnessTables())) {
       return _fail(src, srcType, targetType, flags, srcDynamicType);
     }
 
@@ -1004,9 +1141,9 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
       reinterpret_cast<OpaqueExistentialContainer*>(dest);
 
     // Check for protocol conformances and fill in the witness tables.
-    if (!_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              destExistential->getWitnessTables()))
+    if (!_conformsToExistentialProtocols(srcDynamicValue, srcDynamicType,
+                                   targetType,
+                                   destExistential->getWitnessTables()))
       return _fail(src, srcType, targetType, flags, srcDynamicType);
 
     // Fill in the type and value.
@@ -1028,9 +1165,9 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
     // one we need.
     assert(targetType->Protocols.NumProtocols == 1);
     const WitnessTable *errorWitness;
-    if (!_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              &errorWitness))
+    if (!_conformsToExistentialProtocols(srcDynamicValue, srcDynamicType,
+                                         targetType,
+                                         &errorWitness))
       return _fail(src, srcType, targetType, flags, srcDynamicType);
     
     BoxPair destBox = swift_allocError(srcDynamicType, errorWitness,
@@ -20,13 +20,316 @@
 #include "swift/Runtime/Debug.h"
 #include <stdlib.h>
 
+#if SWIFT_RUNTIME_SIZE_CLASS_ALLOCATOR
+#include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Mutex.h"
+#include <atomic>
+#include <pthread.h>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__FreeBSD__)
+#include <malloc_np.h>
+#else
+#include <malloc.h>
+#endif
+#endif
+
 using namespace swift;
 
+#if defined(__APPLE__)
+// Apple's malloc is guaranteed to be 16-byte aligned.
+#define MALLOC_ALIGN_MASK 15
+#else
+// Other mallocs we support guarantee two-word alignment.
+#define MALLOC_ALIGN_MASK (2 * sizeof(void *) - 1)
+#endif
+
+/// Allocate memory from the system allocator, honoring alignments beyond
+/// what malloc guarantees.
+static void *systemAlloc(size_t size, size_t alignMask) {
+  if (alignMask <= MALLOC_ALIGN_MASK)
+    return malloc(size);
+
+  void *p = nullptr;
+  if (posix_memalign(&p, alignMask + 1, size) != 0)
+    return nullptr;
+  return p;
+}
+
+#if SWIFT_RUNTIME_SIZE_CLASS_ALLOCATOR
+
+// A size-segregated allocator for the small, short-lived objects that make
+// up most Swift heap traffic.
+//
+// Small requests are rounded up to one of a fixed set of size classes and
+// carved out of slabs, each of which only ever holds blocks of one class.
+// Every thread keeps a private free list per class, so the common alloc and
+// dealloc paths take no locks and perform no atomic operations. Thread
+// caches that grow too large, or that belong to exiting threads, give
+// blocks back to a per-class central free list.
+//
+// A two-level page map records the size class of every slab. It is used to
+// tell our blocks apart from system allocations on deallocation and to
+// answer malloc_size-style queries without consulting the system allocator.
+// The size passed to swift_slowDealloc is not trusted for this purpose:
+// objects with tail allocations are routinely released with just their
+// instance size.
+
+namespace {
+
+/// The granularity of size classes. This is also the alignment of every
+/// small block.
+constexpr size_t SizeClassQuantum = 16;
+
+/// The number of size classes. Class N holds blocks of (N+1) quanta.
+constexpr unsigned NumSizeClasses = 32;
+
+/// Requests larger than this go to the system allocator.
+constexpr size_t MaxSmallSize = NumSizeClasses * SizeClassQuantum;
+
+/// Slabs are allocated at this size and alignment.
+constexpr unsigned SlabShift = 20;
+constexpr size_t SlabSize = size_t(1) << SlabShift;
+
+/// The number of blocks moved between a thread cache and the central free
+/// list at a time.
+constexpr unsigned TransferBatchSize = 32;
+
+/// The maximum number of bytes a thread cache holds per size class before it
+/// returns some blocks to the central free list.
+constexpr size_t MaxThreadCacheBytesPerClass = 32 * 1024;
+
+/// The page map covers the user address space in slab-sized pages.
+constexpr unsigned AddressBits = sizeof(void *) == 8 ? 48 : 32;
+constexpr unsigned PageMapBits = AddressBits - SlabShift;
+constexpr unsigned PageMapLeafBits = PageMapBits / 2;
+constexpr unsigned PageMapRootBits = PageMapBits - PageMapLeafBits;
+constexpr size_t PageMapLeafSize = size_t(1) << PageMapLeafBits;
+constexpr size_t PageMapRootSize = size_t(1) << PageMapRootBits;
+
+static_assert(MALLOC_ALIGN_MASK < SizeClassQuantum,
+              "small blocks must be at least as aligned as malloc");
+
+unsigned getSizeClass(size_t size) {
+  assert(size <= MaxSmallSize);
+  return size == 0 ? 0 : unsigned((size - 1) / SizeClassQuantum);
+}
+
+size_t getSizeClassBytes(unsigned sizeClass) {
+  return (sizeClass + 1) * SizeClassQuantum;
+}
+
+unsigned getThreadCacheLimit(unsigned sizeClass) {
+  return unsigned(MaxThreadCacheBytesPerClass / getSizeClassBytes(sizeClass));
+}
+
+struct FreeBlock {
+  FreeBlock *Next;
+};
+
+/// The per-thread free lists.
+struct ThreadCache {
+  FreeBlock *FreeLists[NumSizeClasses];
+  unsigned Counts[NumSizeClasses];
+};
+
+class SizeClassHeap {
+  struct CentralFreeList {
+    Mutex Lock;
+    FreeBlock *Head = nullptr;
+    /// The unallocated remainder of the slab this class is carving up.
+    char *SlabNext = nullptr;
+    char *SlabEnd = nullptr;
+  };
+
+  CentralFreeList Classes[NumSizeClasses];
+
+  /// Maps slab-sized pages to one plus the size class of the slab that
+  /// occupies them, or zero. Leaves are installed under PageMapLock and
+  /// never removed, so readers need no lock.
+  std::atomic<uint8_t *> PageMap[PageMapRootSize];
+  Mutex PageMapLock;
+
+  pthread_key_t ThreadCacheKey;
+
+  static void destroyThreadCache(void *cache);
+
+  void registerSlab(char *slab, unsigned sizeClass);
+  void refill(ThreadCache *cache, unsigned sizeClass);
+  void release(ThreadCache *cache, unsigned sizeClass, unsigned count);
+
+public:
+  SizeClassHeap() {
+    for (auto &leaf : PageMap)
+      leaf.store(nullptr, std::memory_order_relaxed);
+    pthread_key_create(&ThreadCacheKey, destroyThreadCache);
+  }
+
+  /// Return the size class of a block if it was allocated by this heap, or
+  /// -1 if it came from the system allocator.
+  int lookupSizeClass(const void *ptr) const {
+    auto page = uintptr_t(ptr) >> SlabShift;
+    if (page >> PageMapBits)
+      return -1;
+    auto leaf = PageMap[page >> PageMapLeafBits].load(
+                                                    std::memory_order_acquire);
+    if (!leaf)
+      return -1;
+    return int(leaf[page & (PageMapLeafSize - 1)]) - 1;
+  }
+
+  ThreadCache *getThreadCache() {
+    auto cache = static_cast<ThreadCache *>(
+                                      pthread_getspecific(ThreadCacheKey));
+    if (cache)
+      return cache;
+
+    cache = static_cast<ThreadCache *>(calloc(1, sizeof(ThreadCache)));
+    if (!cache) swift::crash("Could not allocate memory.");
+    pthread_setspecific(ThreadCacheKey, cache);
+    return cache;
+  }
+
+  void *alloc(unsigned sizeClass) {
+    auto cache = getThreadCache();
+    if (!cache->FreeLists[sizeClass])
+      refill(cache, sizeClass);
+
+    FreeBlock *block = cache->FreeLists[sizeClass];
+    cache->FreeLists[sizeClass] = block->Next;
+    --cache->Counts[sizeClass];
+    return block;
+  }
+
+  void dealloc(void *ptr, unsigned sizeClass) {
+    auto cache = getThreadCache();
+    auto block = static_cast<FreeBlock *>(ptr);
+    block->Next = cache->FreeLists[sizeClass];
+    cache->FreeLists[sizeClass] = block;
+
+    if (++cache->Counts[sizeClass] > getThreadCacheLimit(sizeClass))
+      release(cache, sizeClass, TransferBatchSize);
+  }
+};
+
+} // end anonymous namespace
+
+static Lazy<SizeClassHeap> SmallHeap;
+
+void SizeClassHeap::registerSlab(char *slab, unsigned sizeClass) {
+  auto page = uintptr_t(slab) >> SlabShift;
+  if (page >> PageMapBits)
+    swift::crash("Slab allocated outside the supported address range.");
+
+  ScopedLock guard(PageMapLock);
+  auto &leafRef = PageMap[page >> PageMapLeafBits];
+  auto leaf = leafRef.load(std::memory_order_relaxed);
+  if (!leaf) {
+    leaf = static_cast<uint8_t *>(calloc(PageMapLeafSize, sizeof(uint8_t)));
+    if (!leaf) swift::crash("Could not allocate memory.");
+    leafRef.store(leaf, std::memory_order_release);
+  }
+  // The slab is published to other threads through the central free list's
+  // lock, so a relaxed store is enough here.
+  leaf[page & (PageMapLeafSize - 1)] = uint8_t(sizeClass + 1);
+}
+
+void SizeClassHeap::refill(ThreadCache *cache, unsigned sizeClass) {
+  auto &central = Classes[sizeClass];
+  size_t blockSize = getSizeClassBytes(sizeClass);
+
+  ScopedLock guard(central.Lock);
+
+  // Prefer recycled blocks.
+  unsigned moved = 0;
+  while (central.Head && moved < TransferBatchSize) {
+    FreeBlock *block = central.Head;
+    central.Head = block->Next;
+    block->Next = cache->FreeLists[sizeClass];
+    cache->FreeLists[sizeClass] = block;
+    ++moved;
+  }
+
+  // Otherwise carve fresh blocks out of the current slab, starting a new one
+  // if necessary.
+  while (moved < TransferBatchSize) {
+    if (size_t(central.SlabEnd - central.SlabNext) < blockSize) {
+      if (moved)
+        break;
+
+      void *slab = nullptr;
+      if (posix_memalign(&slab, SlabSize, SlabSize) != 0)
+        swift::crash("Could not allocate memory.");
+      registerSlab(static_cast<char *>(slab), sizeClass);
+      central.SlabNext = static_cast<char *>(slab);
+      central.SlabEnd = central.SlabNext + SlabSize;
+    }
+
+    auto block = reinterpret_cast<FreeBlock *>(central.SlabNext);
+    central.SlabNext += blockSize;
+    block->Next = cache->FreeLists[sizeClass];
+    cache->FreeLists[sizeClass] = block;
+    ++moved;
+  }
+
+  cache->Counts[sizeClass] += moved;
+}
+
+void SizeClassHeap::release(ThreadCache *cache, unsigned sizeClass,
+                            unsigned count) {
+  if (count == 0)
+    return;
+
+  // Detach up to count blocks from the front of the thread's list.
+  FreeBlock *first = cache->FreeLists[sizeClass];
+  FreeBlock *last = first;
+  unsigned moved = 1;
+  while (moved < count && last->Next) {
+    last = last->Next;
+    ++moved;
+  }
+  cache->FreeLists[sizeClass] = last->Next;
+  cache->Counts[sizeClass] -= moved;
+
+  auto &central = Classes[sizeClass];
+  ScopedLock guard(central.Lock);
+  last->Next = central.Head;
+  central.Head = first;
+}
+
+void SizeClassHeap::destroyThreadCache(void *opaqueCache) {
+  auto cache = static_cast<ThreadCache *>(opaqueCache);
+  auto &heap = SmallHeap.unsafeGetAlreadyInitialized();
+  for (unsigned sizeClass = 0; sizeClass < NumSizeClasses; ++sizeClass)
+    if (cache->Counts[sizeClass])
+      heap.release(cache, sizeClass, cache->Counts[sizeClass]);
+  free(cache);
+}
+
+size_t swift::_swift_slowAllocUsableSize(const void *ptr) {
+  int sizeClass = SmallHeap.get().lookupSizeClass(ptr);
+  if (sizeClass >= 0)
+    return getSizeClassBytes(unsigned(sizeClass));
+
+#if defined(__APPLE__)
+  return malloc_size(ptr);
+#else
+  return malloc_usable_size(const_cast<void *>(ptr));
+#endif
+}
+
+#endif // SWIFT_RUNTIME_SIZE_CLASS_ALLOCATOR
+
 SWIFT_RT_ENTRY_VISIBILITY
 void *swift::swift_slowAlloc(size_t size, size_t alignMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
-  // FIXME: use posix_memalign if alignMask is larger than the system guarantee.
-  void *p = malloc(size);
+  void *p;
+#if SWIFT_RUNTIME_SIZE_CLASS_ALLOCATOR
+  if (size <= MaxSmallSize && alignMask < SizeClassQuantum)
+    p = SmallHeap.get().alloc(getSizeClass(size));
+  else
+#endif
+  p = systemAlloc(size, alignMask);
   if (!p) swift::crash("Could not allocate memory.");
   return p;
 }
@@ -34,5 +337,17 @@ void *swift::swift_slowAlloc(size_t size, size_t alignMask)
 SWIFT_RT_ENTRY_VISIBILITY
 void swift::swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_RUNTIME_SIZE_CLASS_ALLOCATOR
+  // Like the size, the alignment passed in is not trusted to tell which
+  // allocator a block came from, so the page map is always consulted.
+  auto &heap = SmallHeap.get();
+  int sizeClass = heap.lookupSizeClass(ptr);
+  if (sizeClass >= 0) {
+    assert(bytes <= getSizeClassBytes(unsigned(sizeClass)) &&
+           "deallocating more bytes than were allocated");
+    heap.dealloc(ptr, unsigned(sizeClass));
+    return;
+  }
+#endif
   free(ptr);
 }
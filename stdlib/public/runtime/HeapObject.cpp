@@ -29,6 +29,9 @@
 #include <cstdio>
 #include <cstdlib>
 #include <unistd.h>
+#if SWIFT_RUNTIME_DEFERRED_RELEASE
+#include <pthread.h>
+#endif
 #include "../SwiftShims/RuntimeShims.h"
 #if SWIFT_OBJC_INTEROP
 # include <objc/NSObject.h>
@@ -241,7 +244,8 @@ BoxPair::Return SWIFT_RT_ENTRY_IMPL(swift_allocBox)(const Metadata *type) {
   const void *typeArg = type;
   auto entry = B.findOrAdd(&typeArg, 1, [&]() -> BoxCacheEntry* {
     // Create a new entry for the box.
-    auto entry = BoxCacheEntry::allocate(B.getAllocator(), &typeArg, 1, 0);
+    auto entry = BoxCacheEntry::allocate(B.getAllocator(), &typeArg, 1, 0,
+                                         MetadataAllocationKind::Box);
 
     auto metadata = entry->getData();
     metadata->Offset = GenericBoxHeapMetadata::getHeaderOffset(type);
@@ -587,10 +591,86 @@ void swift::swift_unownedCheck(HeapObject *object) {
     _swift_abortRetainUnowned(object);
 }
 
+#if SWIFT_RUNTIME_DEFERRED_RELEASE
+namespace {
+/// Objects whose last strong reference was dropped on this thread while the
+/// thread was already destroying another object. Instead of destroying them
+/// recursively, the outermost release destroys them one at a time, so
+/// tearing down a deep object graph runs in constant stack depth.
+struct DeferredReleaseQueue {
+  HeapObject **Objects;
+  size_t Count;
+  size_t Capacity;
+  bool IsDraining;
+
+  void push(HeapObject *object) {
+    if (Count == Capacity) {
+      Capacity = std::max<size_t>(Capacity * 2, 64);
+      Objects = static_cast<HeapObject **>(
+                          realloc(Objects, Capacity * sizeof(HeapObject *)));
+      if (!Objects) swift::crash("Could not allocate memory.");
+    }
+    Objects[Count++] = object;
+  }
+
+  HeapObject *pop() {
+    return Count ? Objects[--Count] : nullptr;
+  }
+};
+
+struct DeferredReleaseState {
+  pthread_key_t QueueKey;
+
+  static void destroyQueue(void *queue) {
+    auto q = static_cast<DeferredReleaseQueue *>(queue);
+    assert(q->Count == 0 && "thread exited with deferred releases pending");
+    free(q->Objects);
+    free(q);
+  }
+
+  DeferredReleaseState() {
+    pthread_key_create(&QueueKey, destroyQueue);
+  }
+
+  DeferredReleaseQueue *getQueue() {
+    auto queue = static_cast<DeferredReleaseQueue *>(
+                                            pthread_getspecific(QueueKey));
+    if (queue)
+      return queue;
+
+    queue = static_cast<DeferredReleaseQueue *>(
+                                  calloc(1, sizeof(DeferredReleaseQueue)));
+    if (!queue) swift::crash("Could not allocate memory.");
+    pthread_setspecific(QueueKey, queue);
+    return queue;
+  }
+};
+} // end anonymous namespace
+
+static Lazy<DeferredReleaseState> DeferredReleases;
+#endif
+
 // Declared extern "C" LLVM_LIBRARY_VISIBILITY above.
 void _swift_release_dealloc(HeapObject *object)
   SWIFT_CC(RegisterPreservingCC_IMPL) {
+#if SWIFT_RUNTIME_DEFERRED_RELEASE
+  auto queue = DeferredReleases.get().getQueue();
+
+  // If an enclosing release on this thread is already destroying objects,
+  // let it destroy this one too once the current destructor returns.
+  if (queue->IsDraining) {
+    queue->push(object);
+    return;
+  }
+
+  queue->IsDraining = true;
+  do {
+    asFullMetadata(object->metadata)->destroy(object);
+  } while ((object = queue->pop()));
+  queue->IsDraining = false;
+#else
   asFullMetadata(object->metadata)->destroy(object);
+#endif
 }
 
 #if SWIFT_OBJC_INTEROP
@@ -28,6 +28,7 @@
 #include <condition_variable>
 #include <new>
 #include <cctype>
+#include <cstdlib>
 #include <sys/mman.h>
 #include <unistd.h>
 #include "llvm/ADT/DenseMap.h"
@@ -56,42 +57,158 @@
 using namespace swift;
 using namespace metadataimpl;
 
-void *MetadataAllocator::alloc(size_t size) {
+#ifndef SWIFT_RUNTIME_METADATA_SLAB_SIZE
+#define SWIFT_RUNTIME_METADATA_SLAB_SIZE 0
+#endif
+
+namespace {
+  /// The counters for one MetadataAllocationKind.  These are only ever
+  /// incremented and only read for reporting, so relaxed accesses suffice.
+  struct MetadataAllocationCounters {
+    std::atomic<size_t> NumAllocations;
+    std::atomic<size_t> BytesAllocated;
+    std::atomic<size_t> BytesWasted;
+  };
+}
+
+static MetadataAllocationCounters
+AllocationCounters[unsigned(MetadataAllocationKind::NumKinds)];
+
+static const char *getMetadataAllocationKindName(MetadataAllocationKind kind) {
+  switch (kind) {
+  case MetadataAllocationKind::GenericClass: return "generic class";
+  case MetadataAllocationKind::GenericValue: return "generic value";
+  case MetadataAllocationKind::Tuple: return "tuple";
+  case MetadataAllocationKind::Function: return "function";
+  case MetadataAllocationKind::Metatype: return "metatype";
+  case MetadataAllocationKind::ExistentialMetatype:
+    return "existential metatype";
+  case MetadataAllocationKind::Existential: return "existential";
+  case MetadataAllocationKind::ObjCClassWrapper: return "objc class wrapper";
+  case MetadataAllocationKind::WitnessTable: return "witness table";
+  case MetadataAllocationKind::Box: return "box";
+  case MetadataAllocationKind::Other: return "other";
+  case MetadataAllocationKind::NumKinds: break;
+  }
+  return "<invalid>";
+}
+
+bool swift::swift_getMetadataAllocationStats(MetadataAllocationKind kind,
+                                             MetadataAllocationStats *stats) {
+  if (unsigned(kind) >= unsigned(MetadataAllocationKind::NumKinds))
+    return false;
+
+  auto &counters = AllocationCounters[unsigned(kind)];
+  stats->NumAllocations =
+    counters.NumAllocations.load(std::memory_order_relaxed);
+  stats->BytesAllocated =
+    counters.BytesAllocated.load(std::memory_order_relaxed);
+  stats->BytesWasted = counters.BytesWasted.load(std::memory_order_relaxed);
+  return true;
+}
+
+static void dumpMetadataAllocationStats() {
+  MetadataAllocationStats total = {0, 0, 0};
+  fprintf(stderr, "Swift metadata allocations:\n");
+  for (unsigned i = 0; i < unsigned(MetadataAllocationKind::NumKinds); ++i) {
+    auto kind = MetadataAllocationKind(i);
+    MetadataAllocationStats stats;
+    swift_getMetadataAllocationStats(kind, &stats);
+    fprintf(stderr, "  %-22s %10zu allocations %12zu bytes %10zu wasted\n",
+            getMetadataAllocationKindName(kind), stats.NumAllocations,
+            stats.BytesAllocated, stats.BytesWasted);
+    total.NumAllocations += stats.NumAllocations;
+    total.BytesAllocated += stats.BytesAllocated;
+    total.BytesWasted += stats.BytesWasted;
+  }
+  fprintf(stderr, "  %-22s %10zu allocations %12zu bytes %10zu wasted\n",
+          "total", total.NumAllocations, total.BytesAllocated,
+          total.BytesWasted);
+}
+
+namespace {
+  /// Arranges for the allocation counters to be printed at exit if
+  /// SWIFT_DEBUG_METADATA_ALLOCATION_STATS is set.  This is checked the
+  /// first time any metadata allocator needs a new slab.
+  struct MetadataAllocationStatsDumper {
+    MetadataAllocationStatsDumper() {
+      if (getenv("SWIFT_DEBUG_METADATA_ALLOCATION_STATS"))
+        atexit(dumpMetadataAllocationStats);
+    }
+  };
+}
+
+static Lazy<MetadataAllocationStatsDumper> AllocationStatsDumper;
+
+void *MetadataAllocator::alloc(size_t size, MetadataAllocationKind kind) {
 #if defined(__APPLE__)
   const uintptr_t pagesizeMask = vm_page_mask;
 #else
   static const uintptr_t pagesizeMask = sysconf(_SC_PAGESIZE) - 1;
 #endif
-  // If the requested size is a page or larger, map page(s) for it
+  // Slabs are whole pages, and at least one.  Larger slabs keep the
+  // metadata for a type family (which shares a cache, and so an allocator)
+  // packed onto the same pages.
+  const uintptr_t slabSize =
+    (std::max<uintptr_t>(SWIFT_RUNTIME_METADATA_SLAB_SIZE, 1) + pagesizeMask)
+      & ~pagesizeMask;
+
+  auto &counters = AllocationCounters[unsigned(kind)];
+  counters.NumAllocations.fetch_add(1, std::memory_order_relaxed);
+  counters.BytesAllocated.fetch_add(size, std::memory_order_relaxed);
+
+  // If the requested size is a slab or larger, map page(s) for it
   // specifically.
-  if (LLVM_UNLIKELY(size > pagesizeMask)) {
-    auto mem = mmap(nullptr, (size + pagesizeMask) & ~pagesizeMask,
+  if (LLVM_UNLIKELY(size >= slabSize)) {
+    size_t mappedSize = (size + pagesizeMask) & ~pagesizeMask;
+    auto mem = mmap(nullptr, mappedSize,
                     PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE,
                     VM_TAG_FOR_SWIFT_METADATA, 0);
     if (mem == MAP_FAILED)
       crash("unable to allocate memory for metadata cache");
+    counters.BytesWasted.fetch_add(mappedSize - size,
+                                   std::memory_order_relaxed);
     return mem;
   }
   
-  char *end = next + size;
-  
-  // Allocate a new page if we need one.
-  if (LLVM_UNLIKELY(((uintptr_t)next & ~pagesizeMask)
-                      != (((uintptr_t)end & ~pagesizeMask)))){
+  // Allocate a new slab if we need one, abandoning whatever is left of the
+  // current one.  The leftover is charged to the allocation that didn't fit.
+  if (LLVM_UNLIKELY(size_t(end - next) < size)) {
+    AllocationStatsDumper.get();
+    counters.BytesWasted.fetch_add(end - next, std::memory_order_relaxed);
+
     next = (char*)
-      mmap(nullptr, pagesizeMask+1, PROT_READ|PROT_WRITE,
+      mmap(nullptr, slabSize, PROT_READ|PROT_WRITE,
            MAP_ANON|MAP_PRIVATE, VM_TAG_FOR_SWIFT_METADATA, 0);
 
     if (next == MAP_FAILED)
       crash("unable to allocate memory for metadata cache");
-    end = next + size;
+    end = next + slabSize;
   }
   
   char *addr = next;
-  next = end;
+  next += size;
   return addr;
 }
 
+namespace {
+  /// The table of wait queues shared by all metadata caches.
+  struct MetadataCacheWaitQueues {
+    static constexpr unsigned NumQueues = 64;
+    MetadataCacheWaitQueue Queues[NumQueues];
+  };
+}
+
+static Lazy<MetadataCacheWaitQueues> WaitQueues;
+
+MetadataCacheWaitQueue &swift::getMetadataCacheWaitQueue(const void *entry) {
+  // Entries are pointer-aligned and frequently allocated close together,
+  // so fold in some higher bits before picking a queue.
+  auto bits = reinterpret_cast<uintptr_t>(entry);
+  auto index = (bits >> 4) ^ (bits >> 12);
+  return WaitQueues->Queues[index % MetadataCacheWaitQueues::NumQueues];
+}
+
 namespace {
   struct GenericCacheEntry;
 
@@ -180,7 +297,9 @@ swift::swift_allocateGenericClassMetadata(GenericMetadata *pattern,
                               unsafeGetInitializedCache(pattern).getAllocator(),
                               argumentsAsArray,
                               numGenericArguments,
-                              metadataSize)->getData<char>();
+                              metadataSize,
+                              MetadataAllocationKind::GenericClass)
+                 ->getData<char>();
 
   // Copy any extra prefix bytes in from the superclass.
   if (extraPrefixSize) {
@@ -227,7 +346,9 @@ swift::swift_allocateGenericValueMetadata(GenericMetadata *pattern,
     GenericCacheEntry::allocate(
                               unsafeGetInitializedCache(pattern).getAllocator(),
                               argumentsAsArray, numGenericArguments,
-                              pattern->MetadataSize)->getData<char>();
+                              pattern->MetadataSize,
+                              MetadataAllocationKind::GenericValue)
+      ->getData<char>();
 
   // Copy in the metadata template.
   memcpy(bytes, pattern->getMetadataTemplate(), pattern->MetadataSize);
@@ -311,7 +432,8 @@ swift::swift_getObjCClassMetadata(const ClassMetadata *theClass) {
     [&]() -> ObjCClassCacheEntry* {
       // Create a new entry for the cache.
       auto entry = ObjCClassCacheEntry::allocate(Wrappers.getAllocator(),
-                                                 args, numGenericArgs, 0);
+                                                 args, numGenericArgs, 0,
+                                   MetadataAllocationKind::ObjCClassWrapper);
 
       auto metadata = entry->getData();
       metadata->setKind(MetadataKind::ObjCClassWrapper);
@@ -360,6 +482,38 @@ namespace {
 /// The uniquing structure for function type metadata.
 static Lazy<MetadataCache<FunctionCacheEntry>> FunctionTypes;
 
+/// Front caches for function types with 1-4 arguments, keyed by the flags
+/// word, the argument types and the result type.
+static FixedArityMetadataCache<FunctionCacheEntry, 3> FunctionTypes1;
+static FixedArityMetadataCache<FunctionCacheEntry, 4> FunctionTypes2;
+static FixedArityMetadataCache<FunctionCacheEntry, 5> FunctionTypes3;
+static FixedArityMetadataCache<FunctionCacheEntry, 6> FunctionTypes4;
+
+static const FunctionCacheEntry *
+findFixedArityFunctionType(unsigned numArguments,
+                           const void * const *flagsArgsAndResult) {
+  switch (numArguments) {
+  case 1: return FunctionTypes1.find(flagsArgsAndResult);
+  case 2: return FunctionTypes2.find(flagsArgsAndResult);
+  case 3: return FunctionTypes3.find(flagsArgsAndResult);
+  case 4: return FunctionTypes4.find(flagsArgsAndResult);
+  default: return nullptr;
+  }
+}
+
+static void
+cacheFixedArityFunctionType(unsigned numArguments,
+                            const void * const *flagsArgsAndResult,
+                            const FunctionCacheEntry *entry) {
+  switch (numArguments) {
+  case 1: return FunctionTypes1.insert(flagsArgsAndResult, entry);
+  case 2: return FunctionTypes2.insert(flagsArgsAndResult, entry);
+  case 3: return FunctionTypes3.insert(flagsArgsAndResult, entry);
+  case 4: return FunctionTypes4.insert(flagsArgsAndResult, entry);
+  default: return;
+  }
+}
+
 const FunctionTypeMetadata *
 swift::swift_getFunctionTypeMetadata1(FunctionTypeFlags flags,
                                       const void *arg0,
@@ -412,6 +566,10 @@ swift::swift_getFunctionTypeMetadata(const void *flagsArgsAndResult[]) {
 
   unsigned numArguments = flags.getNumArguments();
 
+  // Check the fast path for common low-arity function types.
+  if (auto entry = findFixedArityFunctionType(numArguments, flagsArgsAndResult))
+    return entry->getData();
+
   // Pick a value witness table appropriate to the function convention.
   // All function types of a given convention have the same value semantics,
   // so they share a value witness table.
@@ -453,7 +611,8 @@ swift::swift_getFunctionTypeMetadata(const void *flagsArgsAndResult[]) {
         Types.getAllocator(),
         flagsArgsAndResult,
         numKeyArguments,
-        numArguments * sizeof(FunctionTypeMetadata::Argument));
+        numArguments * sizeof(FunctionTypeMetadata::Argument),
+        MetadataAllocationKind::Function);
 
       auto metadata = entry->getData();
       metadata->setKind(MetadataKind::Function);
@@ -471,6 +630,7 @@ swift::swift_getFunctionTypeMetadata(const void *flagsArgsAndResult[]) {
       return entry;
     });
 
+  cacheFixedArityFunctionType(numArguments, flagsArgsAndResult, entry);
   return entry->getData();
 }
 
@@ -511,6 +671,36 @@ namespace {
 /// The uniquing structure for tuple type metadata.
 static Lazy<MetadataCache<TupleCacheEntry>> TupleTypes;
 
+/// Front caches for tuple types with 1-4 elements, keyed by the element
+/// types.
+static FixedArityMetadataCache<TupleCacheEntry, 1> TupleTypes1;
+static FixedArityMetadataCache<TupleCacheEntry, 2> TupleTypes2;
+static FixedArityMetadataCache<TupleCacheEntry, 3> TupleTypes3;
+static FixedArityMetadataCache<TupleCacheEntry, 4> TupleTypes4;
+
+static const TupleCacheEntry *
+findFixedArityTupleType(size_t numElements, const void * const *elements) {
+  switch (numElements) {
+  case 1: return TupleTypes1.find(elements);
+  case 2: return TupleTypes2.find(elements);
+  case 3: return TupleTypes3.find(elements);
+  case 4: return TupleTypes4.find(elements);
+  default: return nullptr;
+  }
+}
+
+static void cacheFixedArityTupleType(size_t numElements,
+                                     const void * const *elements,
+                                     const TupleCacheEntry *entry) {
+  switch (numElements) {
+  case 1: return TupleTypes1.insert(elements, entry);
+  case 2: return TupleTypes2.insert(elements, entry);
+  case 3: return TupleTypes3.insert(elements, entry);
+  case 4: return TupleTypes4.insert(elements, entry);
+  default: return;
+  }
+}
+
 /// Given a metatype pointer, produce the value-witness table for it.
 /// This is equivalent to metatype->ValueWitnesses but more efficient.
 static const ValueWitnessTable *tuple_getValueWitnesses(const Metadata *metatype) {
@@ -975,10 +1165,14 @@ swift::swift_getTupleTypeMetadata(size_t numElements,
   // by generic code, like a demangler that produces type objects.
   if (numElements == 0) return &_TMT_;
 
-  // Search the cache.
-
   // FIXME: include labels when uniquing!
   auto genericArgs = (const void * const *) elements;
+
+  // Check the fast path for common small tuples.
+  if (auto entry = findFixedArityTupleType(numElements, genericArgs))
+    return entry->getData();
+
+  // Search the cache.
   auto &Types = TupleTypes.get();
   auto entry = Types.findOrAdd(genericArgs, numElements,
     [&]() -> TupleCacheEntry* {
@@ -990,7 +1184,8 @@ swift::swift_getTupleTypeMetadata(size_t numElements,
       // metadata and a value-witness table.
       auto entry = TupleCacheEntry::allocate(Types.getAllocator(),
                                              genericArgs, numElements,
-                                             numElements * sizeof(Element));
+                                             numElements * sizeof(Element),
+                                             MetadataAllocationKind::Tuple);
 
       auto witnesses = &entry->Witnesses;
 
@@ -1064,6 +1259,7 @@ swift::swift_getTupleTypeMetadata(size_t numElements,
       return entry;
     });
 
+  cacheFixedArityTupleType(numElements, genericArgs, entry);
   return entry->getData();
 }
 
@@ -1671,7 +1867,9 @@ swift::swift_initClassMetadata_UniversalStrategy(ClassMetadata *self,
 
     auto ivarListSize = sizeof(ClassIvarList) +
                         numFields * sizeof(ClassIvarEntry);
-    auto ivars = (ClassIvarList*) allocator.alloc(ivarListSize);
+    auto ivars = (ClassIvarList*) allocator.alloc(ivarListSize,
+        genericPattern ? MetadataAllocationKind::GenericClass
+                       : MetadataAllocationKind::Other);
     memcpy(ivars, dependentIvars, ivarListSize);
     rodata->IvarList = ivars;
 
@@ -1801,7 +1999,8 @@ swift::swift_getMetatypeMetadata(const Metadata *instanceMetadata) {
     [&]() -> MetatypeCacheEntry* {
       // Create a new entry for the cache.
       auto entry = MetatypeCacheEntry::allocate(Types.getAllocator(),
-                                                args, numGenericArgs, 0);
+                                                args, numGenericArgs, 0,
+                                          MetadataAllocationKind::Metatype);
 
       auto metadata = entry->getData();
       metadata->setKind(MetadataKind::Metatype);
@@ -1914,7 +2113,8 @@ swift::swift_getExistentialMetatypeMetadata(const Metadata *instanceMetadata) {
       // Create a new entry for the cache.
       auto entry =
         ExistentialMetatypeCacheEntry::allocate(EM.Types.getAllocator(),
-                                                args, numGenericArgs, 0);
+                                                args, numGenericArgs, 0,
+                               MetadataAllocationKind::ExistentialMetatype);
 
       ExistentialTypeFlags flags;
       if (instanceMetadata->getKind() == MetadataKind::Existential) {
@@ -2289,7 +2489,8 @@ swift::swift_getExistentialTypeMetadata(size_t numProtocols,
       // Create a new entry for the cache.
       auto entry = ExistentialCacheEntry::allocate(E.Types.getAllocator(),
                              protocolArgs, numProtocols,
-                             sizeof(const ProtocolDescriptor *) * numProtocols);
+                             sizeof(const ProtocolDescriptor *) * numProtocols,
+                             MetadataAllocationKind::Existential);
       auto metadata = entry->getData();
       
       // Get the special protocol kind for an uncomposed protocol existential.
@@ -2589,7 +2790,8 @@ allocateWitnessTable(GenericWitnessTable *genericTable,
   // Create a new entry for the cache.
   auto entry = WitnessTableCacheEntry::allocate(
       allocator, args, numGenericArgs,
-      privateSize + expectedWitnessTableSize);
+      privateSize + expectedWitnessTableSize,
+      MetadataAllocationKind::WitnessTable);
 
   char *fullTable = entry->getData<char>();
 
@@ -31,13 +31,16 @@ namespace swift {
 /// is not thread-safe; in concurrent uses, allocations must be guarded by
 /// a lock, such as the per-metadata-cache lock used to guard metadata
 /// instantiations. All allocations are pointer-aligned.
+///
+/// Memory is carved out of slabs of at least a page, configurable with
+/// SWIFT_RUNTIME_METADATA_SLAB_SIZE.  Every allocation is counted under a
+/// MetadataAllocationKind; see swift_getMetadataAllocationStats.
 class MetadataAllocator {
-  /// Address of the next available space. The allocator grabs a page at a time,
-  /// so the need for a new page can be determined by page alignment.
-  ///
-  /// Initializing to -1 instead of nullptr ensures that the first allocation
-  /// triggers a page allocation since it will always span a "page" boundary.
-  char *next = (char*)(~(uintptr_t)0U);
+  /// Address of the next available space in the current slab, and the end
+  /// of that slab.  Both start out null, so the first allocation always
+  /// finds the current slab too small and grabs a new one.
+  char *next = nullptr;
+  char *end = nullptr;
   
 public:
   constexpr MetadataAllocator() = default;
@@ -48,7 +51,8 @@ public:
   MetadataAllocator &operator=(const MetadataAllocator &) = delete;
   MetadataAllocator &operator=(MetadataAllocator &&) = delete;
   
-  void *alloc(size_t size);
+  void *alloc(size_t size,
+              MetadataAllocationKind kind = MetadataAllocationKind::Other);
 };
 
 // A wrapper around a pointer to a metadata cache entry that provides
@@ -149,10 +153,12 @@ protected:
 public:
   static Impl *allocate(MetadataAllocator &allocator,
                         const void * const *arguments,
-                        size_t numArguments, size_t payloadSize) {
+                        size_t numArguments, size_t payloadSize,
+                        MetadataAllocationKind kind
+                          = MetadataAllocationKind::Other) {
     void *buffer = allocator.alloc(sizeof(Impl)  +
                                    numArguments * sizeof(void*) +
-                                   payloadSize);
+                                   payloadSize, kind);
     void *resultPtr = (char*)buffer + numArguments * sizeof(void*);
     auto result = new (resultPtr) Impl(numArguments);
 
@@ -186,6 +192,18 @@ public:
   }
 };
 
+/// A queue on which threads block while another thread initializes a
+/// metadata cache entry.  There is a small fixed table of these shared by
+/// all caches and keyed by entry address, so that waiting for one entry
+/// rarely contends with, or is woken by, unrelated instantiations.
+struct MetadataCacheWaitQueue {
+  Mutex Lock;
+  Condition Queue;
+};
+
+/// Return the wait queue responsible for the given cache entry.
+MetadataCacheWaitQueue &getMetadataCacheWaitQueue(const void *entry);
+
 /// The implementation of a metadata cache.  Note that all-zero must
 /// be a valid state for the cache.
 template <class ValueTy> class MetadataCache {
@@ -205,14 +223,19 @@ template <class ValueTy> class MetadataCache {
     /// Does this entry have a value, or is it currently undergoing
     /// initialization?
     ///
-    /// This (and the following field) is ever modified under the lock,
-    /// but it can be read from any thread, including while the lock
-    /// is held.
+    /// This is set exactly once, by the initializing thread, and can be
+    /// read from any thread without holding a lock.
     std::atomic<bool> HasValue;
-    union {
-      ValueTy *Value;
-      std::thread::id InitializingThread;
-    };
+
+    /// Has any thread blocked (or is about to block) on this entry's
+    /// wait queue?  Lets the initializing thread skip the queue entirely
+    /// in the common uncontended case.
+    std::atomic<bool> HasWaiters;
+
+    /// These are not a union: a waiting thread may read
+    /// InitializingThread while the initializing thread publishes Value.
+    ValueTy *Value;
+    std::thread::id InitializingThread;
 
     const void **getKeyDataBuffer() {
       return reinterpret_cast<const void **>(this + 1);
@@ -222,7 +245,8 @@ template <class ValueTy> class MetadataCache {
     }
   public:
     Entry(const Key &key)
-      : Hash(key.Hash), KeyLength(key.KeyData.size()), HasValue(false) {
+      : Hash(key.Hash), KeyLength(key.KeyData.size()), HasValue(false),
+        HasWaiters(false), Value(nullptr) {
       InitializingThread = std::this_thread::get_id();
       memcpy(getKeyDataBuffer(), key.KeyData.begin(),
              KeyLength * sizeof(void*));
@@ -244,6 +268,10 @@ template <class ValueTy> class MetadataCache {
       return key.KeyData.size() * sizeof(void*);
     }
 
+    static size_t getKeyHash(const Key &key) {
+      return key.Hash;
+    }
+
     int compareWithKey(const Key &key) const {
       // Order by hash first, then by the actual key data.
       if (key.Hash != Hash) {
@@ -260,9 +288,26 @@ template <class ValueTy> class MetadataCache {
       return nullptr;
     }
 
-    void setValue(ValueTy *value) {
+    /// Record that the current thread is about to wait for this entry's
+    /// value, then return the value if it has already been set.
+    ///
+    /// This must be called with the entry's wait queue locked.  Together
+    /// with setValue, the sequentially-consistent accesses guarantee that
+    /// either the waiter sees the value or the initializer sees the waiter.
+    ValueTy *registerWaiterAndGetValue() {
+      HasWaiters.store(true, std::memory_order_seq_cst);
+      if (HasValue.load(std::memory_order_seq_cst)) {
+        return Value;
+      }
+      return nullptr;
+    }
+
+    /// Set the value.  Returns true if some thread may be waiting on the
+    /// entry's wait queue and needs to be notified.
+    bool setValue(ValueTy *value) {
       Value = value;
-      HasValue.store(true, std::memory_order_release);
+      HasValue.store(true, std::memory_order_seq_cst);
+      return HasWaiters.load(std::memory_order_seq_cst);
     }
   };
 
@@ -277,17 +322,11 @@ template <class ValueTy> class MetadataCache {
   /// structure for the metadata cache.
   const ValueTy *Head;
 
-  struct ConcurrencyControl {
-    Mutex Lock;
-    Condition Queue;
-  };
-  std::unique_ptr<ConcurrencyControl> Concurrency;
-
   /// Allocator for entries of this cache.
   MetadataAllocator Allocator;
   
 public:
-  MetadataCache() : Concurrency(new ConcurrencyControl()) {}
+  MetadataCache() {}
   ~MetadataCache() {}
 
   /// Caches are not copyable.
@@ -333,12 +372,14 @@ public:
         return value;
       }
 
-      // Otherwise, we have to grab the lock and wait for the value to
-      // appear there.  Note that we have to check again immediately
-      // after acquiring the lock to prevent a race.
-      auto concurrency = Concurrency.get();
-      concurrency->Lock.lockOrWait(concurrency->Queue, [&value, &entry, this] {
-        if ((value = entry->getValue())) {
+      // Otherwise, we have to wait on the entry's queue for the value to
+      // appear there.  Note that we have to check again after registering
+      // as a waiter to prevent a race with the initializing thread.  The
+      // queue may be shared with other entries, so wake-ups for those are
+      // simply treated as spurious.
+      auto &waitQueue = getMetadataCacheWaitQueue(entry);
+      waitQueue.Lock.lockOrWait(waitQueue.Queue, [&value, &entry, this] {
+        if ((value = entry->registerWaiterAndGetValue())) {
           return false; // found a value, done waiting
         }
 
@@ -371,16 +412,83 @@ public:
                ValueTy::getName(), (void*) this, value);
 #endif
 
-    // Acquire the lock, set the value, and notify any waiters.
-    auto concurrency = Concurrency.get();
-    concurrency->Lock.lockAndNotifyAll(concurrency->Queue, [&entry, &value] {
-      entry->setValue(value);
-    });
+    // Set the value.  Only if another thread has started waiting for it
+    // do we need to go through the entry's wait queue to wake it up;
+    // acquiring the lock ensures a waiter that registered but has not
+    // yet blocked cannot miss the notification.
+    if (entry->setValue(value)) {
+      auto &waitQueue = getMetadataCacheWaitQueue(entry);
+      waitQueue.Lock.lockAndNotifyAll(waitQueue.Queue, [] {});
+    }
 
     return value;
   }
 };
 
+/// A lock-free front cache for metadata whose key is a small, fixed number
+/// of words, such as tuples and functions of low arity.
+///
+/// Lookups hash the key words inline and compare them directly against
+/// the argument buffer of the cached entry, so a hit never touches the
+/// full MetadataCache.  Only fully-initialized entries are ever inserted,
+/// and slots are never cleared; a miss (including one caused by a full
+/// probe window) simply falls back to the full cache.  All-zero is a
+/// valid state.
+template <class EntryTy, unsigned NumKeyWords>
+class FixedArityMetadataCache {
+  static constexpr unsigned NumSlots = 512;
+  static constexpr unsigned MaxProbes = 8;
+
+  std::atomic<const EntryTy *> Slots[NumSlots];
+
+  static size_t hash(const void * const *key) {
+    size_t H = NumKeyWords;
+    for (unsigned i = 0; i != NumKeyWords; ++i) {
+      H ^= reinterpret_cast<uintptr_t>(key[i]);
+      H *= size_t(0x9E3779B97F4A7C15ULL);
+    }
+    return H ^ (H >> (sizeof(size_t) * 4));
+  }
+
+  static bool matches(const EntryTy *entry, const void * const *key) {
+    auto args = entry->getArgumentsBuffer();
+    for (unsigned i = 0; i != NumKeyWords; ++i)
+      if (args[i] != key[i])
+        return false;
+    return true;
+  }
+
+public:
+  /// Return the cached entry for the given key, or null.
+  const EntryTy *find(const void * const *key) const {
+    size_t index = hash(key);
+    for (unsigned probe = 0; probe != MaxProbes; ++probe, ++index) {
+      auto entry = Slots[index % NumSlots].load(std::memory_order_acquire);
+      if (!entry)
+        return nullptr;
+      if (matches(entry, key))
+        return entry;
+    }
+    return nullptr;
+  }
+
+  /// Remember an initialized entry for the given key.  It's fine for
+  /// several threads to race to insert the same entry.
+  void insert(const void * const *key, const EntryTy *entry) {
+    size_t index = hash(key);
+    for (unsigned probe = 0; probe != MaxProbes; ++probe, ++index) {
+      auto &slot = Slots[index % NumSlots];
+      const EntryTy *existing = nullptr;
+      if (slot.compare_exchange_strong(existing, entry,
+                                       std::memory_order_release,
+                                       std::memory_order_acquire))
+        return;
+      if (existing == entry)
+        return;
+    }
+  }
+};
+
 } // namespace swift
 
 #endif // SWIFT_RUNTIME_METADATACACHE_H
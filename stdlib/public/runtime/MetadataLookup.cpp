@@ -21,6 +21,7 @@
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Mutex.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/StringExtras.h"
@@ -80,6 +81,12 @@ namespace {
       return Metadata;
     }
 
+    static size_t getKeyHash(llvm::StringRef aName) {
+      // llvm::hash_value(StringRef) is defined out of line in a library the
+      // runtime does not link against.
+      return llvm::hash_combine_range(aName.begin(), aName.end());
+    }
+
     int compareWithKey(llvm::StringRef aName) const {
       return aName.compare(Name);
     }
@@ -106,6 +113,13 @@ static void _addImageTypeMetadataRecordsBlock(const uint8_t *records,
 
 struct TypeMetadataState {
   ConcurrentMap<TypeMetadataCacheEntry> Cache;
+
+  /// The records of every section up to NumIndexedSections, indexed by
+  /// mangled type name. Sections are merged into the index lazily, on the
+  /// first name lookup after they are registered.
+  MangledTypeNameIndex NameIndex;
+  unsigned NumIndexedSections = 0;
+
   std::vector<TypeMetadataSection> SectionsToScan;
   Mutex SectionsToScanLock;
 
@@ -230,24 +244,26 @@ swift::_matchMetadataByMangledTypeName(const llvm::StringRef typeName,
 
 // returns the type metadata for the type named by typeName
 static const Metadata *
-_searchTypeMetadataRecords(const TypeMetadataState &T,
+_searchTypeMetadataRecords(TypeMetadataState &T,
                            const llvm::StringRef typeName) {
-  unsigned sectionIdx = 0;
-  unsigned endSectionIdx = T.SectionsToScan.size();
-  const Metadata *foundMetadata = nullptr;
-
-  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = T.SectionsToScan[sectionIdx];
-    for (const auto &record : section) {
-      if (auto metadata = record.getCanonicalTypeMetadata())
-        foundMetadata = _matchMetadataByMangledTypeName(typeName, metadata, nullptr);
-      else if (auto ntd = record.getNominalTypeDescriptor())
-        foundMetadata = _matchMetadataByMangledTypeName(typeName, nullptr, ntd);
+  // The index can be searched without taking the lock.
+  if (auto entry = T.NameIndex.find(typeName))
+    return entry->getMetadata();
 
-      if (foundMetadata != nullptr)
-        return foundMetadata;
+  // Merge any sections registered since the last lookup into the index.
+  T.SectionsToScanLock.lock([&] {
+    unsigned endSectionIdx = T.SectionsToScan.size();
+    for (; T.NumIndexedSections < endSectionIdx; ++T.NumIndexedSections) {
+      auto &section = T.SectionsToScan[T.NumIndexedSections];
+      for (const auto &record : section)
+        _addRecordToMangledTypeNameIndex(T.NameIndex, record);
     }
-  }
+  });
+
+  // Search again even if we didn't index anything: another thread may have
+  // indexed the pending sections after our first search.
+  if (auto entry = T.NameIndex.find(typeName))
+    return entry->getMetadata();
 
   return nullptr;
 }
@@ -263,9 +279,7 @@ _typeByMangledName(const llvm::StringRef typeName) {
     return Value->getMetadata();
 
   // Check type metadata records
-  T.SectionsToScanLock.lock([&] {
-    foundMetadata = _searchTypeMetadataRecords(T, typeName);
-  });
+  foundMetadata = _searchTypeMetadataRecords(T, typeName);
 
   // Check protocol conformances table. Note that this has no support for
   // resolving generic types yet.
@@ -18,8 +18,10 @@
 #define SWIFT_RUNTIME_PRIVATE_H
 
 #include "swift/Basic/Demangle.h"
+#include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Config.h"
 #include "swift/Runtime/Metadata.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Compiler.h"
 
 // Opaque ISAs need to use object_getClass which is in runtime.h
@@ -45,6 +47,11 @@ namespace swift {
   extern "C" LLVM_LIBRARY_VISIBILITY LLVM_ATTRIBUTE_NORETURN
   void _swift_abortRetainUnowned(const void *object);
 
+  /// Return the number of protocol conformance sections registered so far.
+  /// A conformance lookup that failed can only start succeeding once this
+  /// changes, so it serves as the generation for negative caches.
+  unsigned _swift_getProtocolConformanceGeneration();
+
   /// Is the given value a valid alignment mask?
   static inline bool isAlignmentMask(size_t mask) {
     // mask          == xyz01111...
@@ -156,6 +163,73 @@ namespace swift {
   const Metadata *
   _searchConformancesByMangledTypeName(const llvm::StringRef typeName);
 
+  /// An entry in an index from mangled type names to the type metadata or
+  /// nominal type descriptor of a record that names that type.
+  struct MangledTypeNameIndexEntry {
+  private:
+    /// The mangled name. This references the nominal type descriptor's
+    /// name string, which lives as long as the image does.
+    llvm::StringRef Name;
+    const Metadata *Type;
+    const NominalTypeDescriptor *Description;
+
+  public:
+    MangledTypeNameIndexEntry(llvm::StringRef name, const Metadata *type,
+                              const NominalTypeDescriptor *description)
+      : Name(name), Type(type), Description(description) {}
+
+    long getKeyIntValueForDump() const {
+      return getKeyHash(Name);
+    }
+
+    static size_t getKeyHash(llvm::StringRef name) {
+      // llvm::hash_value(StringRef) is defined out of line in a library the
+      // runtime does not link against.
+      return llvm::hash_combine_range(name.begin(), name.end());
+    }
+
+    int compareWithKey(llvm::StringRef name) const {
+      return name.compare(Name);
+    }
+
+    template <class... T>
+    static size_t getExtraAllocationSize(T &&... ignored) {
+      return 0;
+    }
+
+    /// Return the metadata for the indexed type, calling its accessor if
+    /// necessary.
+    const Metadata *getMetadata() const {
+      return _matchMetadataByMangledTypeName(Name, Type, Description);
+    }
+  };
+
+  using MangledTypeNameIndex = ConcurrentMap<MangledTypeNameIndexEntry>;
+
+  /// Add a type metadata record or protocol conformance record to a mangled
+  /// type name index if _matchMetadataByMangledTypeName could produce
+  /// metadata for it. If several records name the same type, the first one
+  /// added wins, matching the order of a linear scan over the records.
+  template <class Record>
+  void _addRecordToMangledTypeNameIndex(MangledTypeNameIndex &index,
+                                        const Record &record) {
+    const NominalTypeDescriptor *ntd = nullptr;
+    auto metadata = record.getCanonicalTypeMetadata();
+    if (metadata) {
+      ntd = metadata->getNominalTypeDescriptor();
+    } else if ((ntd = record.getNominalTypeDescriptor())) {
+      // Without metadata we can only produce a type through its accessor.
+      if (ntd->GenericParams.isGeneric() || !ntd->getAccessFunction())
+        return;
+    }
+
+    if (ntd == nullptr)
+      return;
+
+    index.getOrInsert(llvm::StringRef(ntd->Name.get()), metadata,
+                      metadata ? nullptr : ntd);
+  }
+
 #if SWIFT_OBJC_INTEROP
   Demangle::NodePointer _swift_buildDemanglingForMetadata(const Metadata *type);
 #endif
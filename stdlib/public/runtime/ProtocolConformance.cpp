@@ -19,7 +19,9 @@
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Mutex.h"
+#include "llvm/ADT/Hashing.h"
 #include "Private.h"
+#include <vector>
 
 #if defined(__APPLE__) && defined(__MACH__)
 #include <mach-o/dyld.h>
@@ -175,12 +177,21 @@ namespace {
     std::atomic<const WitnessTable *> Table;
     std::atomic<uintptr_t> FailureGeneration;
 
+    /// The registration order of the record the witness table came from.
+    /// Only accessed under ConformanceState::CacheSuccessLock.
+    uint64_t RecordOrder;
+
   public:
     ConformanceCacheEntry(ConformanceCacheKey key,
                           const WitnessTable *table,
-                          uintptr_t failureGeneration)
+                          uintptr_t failureGeneration,
+                          uint64_t recordOrder)
       : Type(key.Type), Proto(key.Proto), Table(table),
-        FailureGeneration(failureGeneration) {
+        FailureGeneration(failureGeneration), RecordOrder(recordOrder) {
+    }
+
+    static size_t getKeyHash(const ConformanceCacheKey &key) {
+      return llvm::hash_combine(key.Type, key.Proto);
     }
 
     int compareWithKey(const ConformanceCacheKey &key) const {
@@ -202,10 +213,16 @@ namespace {
       return Table.load(std::memory_order_relaxed) != nullptr;
     }
 
-    void makeSuccessful(const WitnessTable *table) {
+    void makeSuccessful(const WitnessTable *table, uint64_t recordOrder) {
+      RecordOrder = recordOrder;
       Table.store(table, std::memory_order_release);
     }
 
+    uint64_t getRecordOrder() const {
+      assert(isSuccessful());
+      return RecordOrder;
+    }
+
     void updateFailureGeneration(uintptr_t failureGeneration) {
       assert(!isSuccessful());
       FailureGeneration.store(failureGeneration, std::memory_order_relaxed);
@@ -223,6 +240,51 @@ namespace {
       return FailureGeneration.load(std::memory_order_relaxed);
     }
   };
+
+  /// A conformance record in the per-protocol index, tagged with the index of
+  /// the section it came from and its index within that section.
+  struct IndexedConformanceRecord {
+    const ProtocolConformanceRecord *Record;
+    unsigned SectionIndex;
+    unsigned IndexInSection;
+
+    /// Orders records by registration: a later record has a higher value.
+    uint64_t getRecordOrder() const {
+      return (uint64_t(SectionIndex) << 32) | IndexInSection;
+    }
+  };
+
+  /// All the conformance records for a single protocol, in reverse
+  /// registration order.
+  struct ProtocolConformancesEntry {
+  private:
+    const ProtocolDescriptor *Proto;
+
+  public:
+    ConcurrentList<IndexedConformanceRecord> Records;
+
+    ProtocolConformancesEntry(const ProtocolDescriptor *proto)
+      : Proto(proto) {}
+
+    long getKeyIntValueForDump() const {
+      return reinterpret_cast<uintptr_t>(Proto);
+    }
+
+    static size_t getKeyHash(const ProtocolDescriptor *proto) {
+      return llvm::hash_value(proto);
+    }
+
+    int compareWithKey(const ProtocolDescriptor *proto) const {
+      if (proto != Proto)
+        return (uintptr_t(proto) < uintptr_t(Proto) ? -1 : 1);
+      return 0;
+    }
+
+    template <class... Args>
+    static size_t getExtraAllocationSize(Args &&... ignored) {
+      return 0;
+    }
+  };
 }
 
 // Conformance Cache.
@@ -241,10 +303,32 @@ static void _addImageProtocolConformancesBlock(const uint8_t *conformances,
 
 struct ConformanceState {
   ConcurrentMap<ConformanceCacheEntry> Cache;
+
+  /// The conformance records of every registered section, indexed by
+  /// protocol. Readers may traverse this without taking any lock.
+  ConcurrentMap<ProtocolConformancesEntry> RecordsByProtocol;
+
+  /// The number of sections whose records have been fully merged into
+  /// RecordsByProtocol. This doubles as the generation number for negative
+  /// cache entries.
+  std::atomic<unsigned> NumIndexedSections;
+
+  /// The conformance records of every section up to NumNameIndexedSections,
+  /// indexed by the mangled name of the conforming type. Sections are merged
+  /// in lazily on the first name lookup after they are registered.
+  MangledTypeNameIndex NameIndex;
+  unsigned NumNameIndexedSections = 0;
+
   std::vector<ConformanceSection> SectionsToScan;
   Mutex SectionsToScanLock;
+
+  /// Serializes updates of successful cache entries. Scans that started
+  /// with different snapshots of the sections can finish in any order, so
+  /// an entry only takes a witness table from a record registered after the
+  /// one it already has.
+  Mutex CacheSuccessLock;
   
-  ConformanceState() {
+  ConformanceState() : NumIndexedSections(0) {
     SectionsToScan.reserve(16);
 #if defined(__APPLE__) && defined(__MACH__)
     _initializeCallbacksToInspectDylib();
@@ -256,24 +340,30 @@ struct ConformanceState {
   }
 
   void cacheSuccess(const void *type, const ProtocolDescriptor *proto,
-                    const WitnessTable *witness) {
+                    const WitnessTable *witness, uint64_t recordOrder) {
+    ScopedLock guard(CacheSuccessLock);
     auto result = Cache.getOrInsert(ConformanceCacheKey(type, proto),
-                                    witness, uintptr_t(0));
+                                    witness, uintptr_t(0), recordOrder);
 
-    // If the entry was already present, we may need to update it.
+    // If the entry was already present, we may need to update it. The last
+    // registered of several duplicate conformances wins.
     if (!result.second) {
-      result.first->makeSuccessful(witness);
+      auto entry = result.first;
+      if (!entry->isSuccessful() || entry->getRecordOrder() <= recordOrder)
+        entry->makeSuccessful(witness, recordOrder);
     }
   }
 
-  void cacheFailure(const void *type, const ProtocolDescriptor *proto) {
-    uintptr_t failureGeneration = SectionsToScan.size();
+  void cacheFailure(const void *type, const ProtocolDescriptor *proto,
+                    uintptr_t failureGeneration) {
     auto result = Cache.getOrInsert(ConformanceCacheKey(type, proto),
                                     (const WitnessTable *) nullptr,
-                                    failureGeneration);
+                                    failureGeneration, uint64_t(0));
 
-    // If the entry was already present, we may need to update it.
-    if (!result.second) {
+    // If the entry was already present, we may need to update it. Another
+    // thread may have found a conformance concurrently; never downgrade a
+    // successful entry.
+    if (!result.second && !result.first->isSuccessful()) {
       result.first->updateFailureGeneration(failureGeneration);
     }
   }
@@ -282,6 +372,19 @@ struct ConformanceState {
                                     const ProtocolDescriptor *proto) {
     return Cache.find(ConformanceCacheKey(type, proto));
   }
+
+  unsigned getNumIndexedSections() const {
+    return NumIndexedSections.load(std::memory_order_acquire);
+  }
+
+  /// Return the indexed records for the given protocol, or null if no
+  /// registered section has a conformance to it.
+  ConcurrentList<IndexedConformanceRecord> *
+  findRecords(const ProtocolDescriptor *proto) {
+    if (auto entry = RecordsByProtocol.find(proto))
+      return &entry->Records;
+    return nullptr;
+  }
 };
 
 static Lazy<ConformanceState> Conformances;
@@ -291,7 +394,28 @@ _registerProtocolConformances(ConformanceState &C,
                               const ProtocolConformanceRecord *begin,
                               const ProtocolConformanceRecord *end) {
   ScopedLock guard(C.SectionsToScanLock);
+
+  unsigned sectionIndex = C.SectionsToScan.size();
   C.SectionsToScan.push_back(ConformanceSection{begin, end});
+
+  // Merge the new records into the per-protocol index. Sections are merged
+  // in order under the lock, so each protocol's list is in reverse
+  // registration order: newest section first, and within a section the last
+  // record first.
+  for (auto record = begin; record != end; ++record) {
+    auto entry = C.RecordsByProtocol.getOrInsert(record->getProtocol()).first;
+    unsigned indexInSection = record - begin;
+    entry->Records.push_front(
+      IndexedConformanceRecord{record, sectionIndex, indexInSection});
+  }
+
+  // Publish the section to lock-free readers only once all of its records
+  // are visible in the index.
+  C.NumIndexedSections.store(sectionIndex + 1, std::memory_order_release);
+}
+
+unsigned swift::_swift_getProtocolConformanceGeneration() {
+  return Conformances.get().getNumIndexedSections();
 }
 
 static void _addImageProtocolConformancesBlock(const uint8_t *conformances,
@@ -431,10 +555,6 @@ void swift::_swift_initializeCallbacksToInspectDylib(
 # error No known mechanism to inspect dynamic libraries on this platform.
 #endif
 
-// This variable is used to signal when a cache was generated and
-// it is correct to avoid a new scan.
-static unsigned ConformanceCacheGeneration = 0;
-
 void
 swift::swift_registerProtocolConformances(const ProtocolConformanceRecord *begin,
                                           const ProtocolConformanceRecord *end){
@@ -472,7 +592,7 @@ recur_inside_cache_lock:
         foundEntry = Value;
 
       // If we got a cached negative response, check the generation number.
-      if (Value->getFailureGeneration() == C.SectionsToScan.size()) {
+      if (Value->getFailureGeneration() == C.getNumIndexedSections()) {
         // We found an entry with a negative value.
         return std::make_pair(nullptr, true);
       }
@@ -554,8 +674,6 @@ swift::swift_conformsToProtocol(const Metadata *type,
 recur:
   // See if we have a cached conformance. The ConcurrentMap data structure
   // allows us to insert and search the map concurrently without locking.
-  // We do lock the slow path because the SectionsToScan data structure is not
-  // concurrent.
   auto FoundConformance = searchInConformanceCache(type, protocol, foundEntry);
   // The negative answer does not always mean that there is no conformance,
   // unless it is an exact match on the type. If it is not an exact match,
@@ -566,87 +684,85 @@ recur:
       return FoundConformance.first;
   }
 
-  // If we didn't have an up-to-date cache entry, scan the conformance records.
-  C.SectionsToScanLock.lock();
-  unsigned failedGeneration = ConformanceCacheGeneration;
-
-  // If we have no new information to pull in (and nobody else pulled in
-  // new information while we waited on the lock), we're done.
-  if (C.SectionsToScan.size() == numSections) {
-    if (failedGeneration != ConformanceCacheGeneration) {
-      // Someone else pulled in new conformances while we were waiting.
-      // Start over with our newly-populated cache.
-      C.SectionsToScanLock.unlock();
-      type = origType;
-      goto recur;
-    }
-
+  // If we didn't have an up-to-date cache entry, scan the indexed conformance
+  // records. Only sections that are fully merged into the index are
+  // considered; anything registered after this point bumps the generation
+  // and will be picked up by a later query.
+  unsigned endSectionIdx = C.getNumIndexedSections();
 
+  // If we have no new information to pull in, we're done.
+  if (endSectionIdx == numSections) {
     // Save the failure for this type-protocol pair in the cache.
-    C.cacheFailure(type, protocol);
-
-    C.SectionsToScanLock.unlock();
+    C.cacheFailure(type, protocol, endSectionIdx);
     return nullptr;
   }
 
   // Update the last known number of sections to scan.
-  numSections = C.SectionsToScan.size();
+  numSections = endSectionIdx;
 
   // Scan only sections that were not scanned yet.
   unsigned sectionIdx = foundEntry ? foundEntry->getFailureGeneration() : 0;
-  unsigned endSectionIdx = C.SectionsToScan.size();
-
-  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = C.SectionsToScan[sectionIdx];
-    // Eagerly pull records for nondependent witnesses into our cache.
-    for (const auto &record : section) {
-      // If the record applies to a specific type, cache it.
-      if (auto metadata = record.getCanonicalTypeMetadata()) {
-        auto P = record.getProtocol();
-
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
-
-        if (!isRelatedType(type, metadata, /*isMetadata=*/true))
-          continue;
-
-        // Store the type-protocol pair in the cache.
-        auto witness = record.getWitnessTable(metadata);
-        if (witness) {
-          C.cacheSuccess(metadata, P, witness);
-        } else {
-          C.cacheFailure(metadata, P);
-        }
-
-      // If the record provides a nondependent witness table for all instances
-      // of a generic type, cache it for the generic pattern.
-      // TODO: "Nondependent witness table" probably deserves its own flag.
-      // An accessor function might still be necessary even if the witness table
-      // can be shared.
-      } else if (record.getTypeKind()
-                   == TypeMetadataRecordKind::UniqueNominalTypeDescriptor
-                 && record.getConformanceKind()
-                   == ProtocolConformanceReferenceKind::WitnessTable) {
-
-        auto R = record.getNominalTypeDescriptor();
-        auto P = record.getProtocol();
-
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
-
-        if (!isRelatedType(type, R, /*isMetadata=*/false))
-          continue;
-
-        // Store the type-protocol pair in the cache.
-        C.cacheSuccess(R, P, record.getStaticWitnessTable());
+
+  // Collect the records of the sections we haven't scanned yet. The index
+  // lists them in reverse registration order.
+  std::vector<IndexedConformanceRecord> newRecords;
+  if (auto records = C.findRecords(protocol)) {
+    for (const auto &indexed : *records) {
+      // Skip records from sections published after our snapshot.
+      if (indexed.SectionIndex >= endSectionIdx)
+        continue;
+      // Records are ordered newest section first, so everything from here
+      // on has already been scanned.
+      if (indexed.SectionIndex < sectionIdx)
+        break;
+      newRecords.push_back(indexed);
+    }
+  }
+
+  // Eagerly pull records for nondependent witnesses into our cache. For
+  // duplicate conformances the last registered record wins, like it does for
+  // a scan of the sections; cacheSuccess keeps that order even if a
+  // concurrent scan of older sections finishes after this one.
+  for (auto recordIt = newRecords.rbegin(), recordEnd = newRecords.rend();
+       recordIt != recordEnd; ++recordIt) {
+    const auto &record = *recordIt->Record;
+    uint64_t recordOrder = recordIt->getRecordOrder();
+    assert(record.getProtocol() == protocol);
+
+    // If the record applies to a specific type, cache it.
+    if (auto metadata = record.getCanonicalTypeMetadata()) {
+      if (!isRelatedType(type, metadata, /*isMetadata=*/true))
+        continue;
+
+      // Store the type-protocol pair in the cache.
+      auto witness = record.getWitnessTable(metadata);
+      if (witness) {
+        C.cacheSuccess(metadata, protocol, witness, recordOrder);
+      } else {
+        C.cacheFailure(metadata, protocol, endSectionIdx);
       }
+
+    // If the record provides a nondependent witness table for all instances
+    // of a generic type, cache it for the generic pattern.
+    // TODO: "Nondependent witness table" probably deserves its own flag.
+    // An accessor function might still be necessary even if the witness table
+    // can be shared.
+    } else if (record.getTypeKind()
+                 == TypeMetadataRecordKind::UniqueNominalTypeDescriptor
+               && record.getConformanceKind()
+                 == ProtocolConformanceReferenceKind::WitnessTable) {
+
+      auto R = record.getNominalTypeDescriptor();
+
+      if (!isRelatedType(type, R, /*isMetadata=*/false))
+        continue;
+
+      // Store the type-protocol pair in the cache.
+      C.cacheSuccess(R, protocol, record.getStaticWitnessTable(),
+                     recordOrder);
     }
   }
-  ++ConformanceCacheGeneration;
 
-  C.SectionsToScanLock.unlock();
   // Start over with our newly-populated cache.
   type = origType;
   goto recur;
@@ -655,27 +771,26 @@ recur:
 const Metadata *
 swift::_searchConformancesByMangledTypeName(const llvm::StringRef typeName) {
   auto &C = Conformances.get();
-  const Metadata *foundMetadata = nullptr;
-
-  ScopedLock guard(C.SectionsToScanLock);
-
-  unsigned sectionIdx = 0;
-  unsigned endSectionIdx = C.SectionsToScan.size();
-
-  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = C.SectionsToScan[sectionIdx];
-    for (const auto &record : section) {
-      if (auto metadata = record.getCanonicalTypeMetadata())
-        foundMetadata = _matchMetadataByMangledTypeName(typeName, metadata, nullptr);
-      else if (auto ntd = record.getNominalTypeDescriptor())
-        foundMetadata = _matchMetadataByMangledTypeName(typeName, nullptr, ntd);
 
-      if (foundMetadata != nullptr)
-        break;
+  // The index can be searched without taking the lock.
+  if (auto entry = C.NameIndex.find(typeName))
+    return entry->getMetadata();
+
+  // Merge any sections registered since the last lookup into the index.
+  C.SectionsToScanLock.lock([&] {
+    unsigned endSectionIdx = C.SectionsToScan.size();
+    for (; C.NumNameIndexedSections < endSectionIdx;
+         ++C.NumNameIndexedSections) {
+      auto &section = C.SectionsToScan[C.NumNameIndexedSections];
+      for (const auto &record : section)
+        _addRecordToMangledTypeNameIndex(C.NameIndex, record);
     }
-    if (foundMetadata != nullptr)
-      break;
-  }
+  });
+
+  // Search again even if we didn't index anything: another thread may have
+  // indexed the pending sections after our first search.
+  if (auto entry = C.NameIndex.find(typeName))
+    return entry->getMetadata();
 
-  return foundMetadata;
+  return nullptr;
 }
@@ -17,6 +17,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "../SwiftShims/LibcShims.h"
+#include "swift/Runtime/Heap.h"
 
 static_assert(std::is_same<ssize_t, swift::__swift_ssize_t>::value,
               "__swift_ssize_t must be defined as equivalent to ssize_t");
@@ -49,7 +50,13 @@ __swift_ssize_t _swift_stdlib_write(int fd, const void *buf,
 
 int _swift_stdlib_close(int fd) { return close(fd); }
 
-#if defined(__APPLE__)
+#if SWIFT_RUNTIME_SIZE_CLASS_ALLOCATOR
+// Heap objects may live in the runtime's size-class slabs rather than in
+// malloc'd memory, so ask the runtime.
+size_t _swift_stdlib_malloc_size(const void *ptr) {
+  return _swift_slowAllocUsableSize(ptr);
+}
+#elif defined(__APPLE__)
 #include <malloc/malloc.h>
 size_t _swift_stdlib_malloc_size(const void *ptr) { return malloc_size(ptr); }
 #elif defined(__GNU_LIBRARY__) || defined(__CYGWIN__)
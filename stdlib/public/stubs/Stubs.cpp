@@ -23,8 +23,10 @@
 #include <sys/resource.h>
 #include <sys/errno.h>
 #include <unistd.h>
+#include <cassert>
 #include <climits>
 #include <cstdarg>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -58,6 +60,7 @@ static long double swift_strtold_l(const char *nptr,
 #endif
 #include <limits>
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/MathExtras.h"
 #include "swift/Runtime/Debug.h"
 #include "swift/Basic/Lazy.h"
 
@@ -224,18 +227,481 @@ static uint64_t swift_floatingPointToString(char *Buffer, size_t BufferLength,
   return i;
 }
 
+#if !defined(__CYGWIN__)
+//===----------------------------------------------------------------------===//
+// Shortest round-trip floating point printing
+//===----------------------------------------------------------------------===//
+//
+// Float and Double are printed with Florian Loitsch's Grisu3 algorithm
+// ("Printing Floating-Point Numbers Quickly and Accurately with Integers",
+// PLDI 2010). It finds the shortest digit string that reads back as the same
+// value using only 64-bit integer arithmetic, independent of the current
+// locale. For the small fraction of inputs where Grisu3 cannot prove its
+// result is the shortest, we fall back to snprintf.
+
+namespace {
+
+/// A floating point number with a 64-bit significand: F * 2^E.
+struct DiyFp {
+  uint64_t F;
+  int E;
+};
+
+/// A normalized approximation of 10^DecimalExponent.
+struct CachedPower {
+  uint64_t F;
+  int16_t E;
+  int16_t DecimalExponent;
+};
+
+/// The IEEE 754 layout of the types Grisu3 supports.
+template <typename T> struct FloatingPointLayout;
+
+template <> struct FloatingPointLayout<float> {
+  using BitsType = uint32_t;
+  static const int SignificandBits = 23;
+  static const int ExponentBits = 8;
+};
+
+template <> struct FloatingPointLayout<double> {
+  using BitsType = uint64_t;
+  static const int SignificandBits = 52;
+  static const int ExponentBits = 11;
+};
+
+} // end anonymous namespace
+
+static DiyFp diyFpNormalize(DiyFp X) {
+  int Shift = llvm::countLeadingZeros(X.F);
+  return DiyFp{X.F << Shift, X.E - Shift};
+}
+
+/// Multiply two DiyFps, rounding the 128-bit product to its upper 64 bits.
+static DiyFp diyFpMultiply(DiyFp X, DiyFp Y) {
+  const uint64_t M32 = 0xFFFFFFFFu;
+  uint64_t A = X.F >> 32, B = X.F & M32;
+  uint64_t C = Y.F >> 32, D = Y.F & M32;
+  uint64_t AC = A * C, BC = B * C, AD = A * D, BD = B * D;
+  uint64_t Mid = (BD >> 32) + (AD & M32) + (BC & M32) + (1U << 31);
+  return DiyFp{AC + (AD >> 32) + (BC >> 32) + (Mid >> 32), X.E + Y.E + 64};
+}
+
+/// Powers of ten from 10^-348 to 10^340 in steps of 8, which is enough to
+/// bring any Float or Double into the range grisuDigitGen works in.
+static const CachedPower CachedPowers[] = {
+  {0xfa8fd5a0081c0288ULL, -1220, -348},
+  {0xbaaee17fa23ebf76ULL, -1193, -340},
+  {0x8b16fb203055ac76ULL, -1166, -332},
+  {0xcf42894a5dce35eaULL, -1140, -324},
+  {0x9a6bb0aa55653b2dULL, -1113, -316},
+  {0xe61acf033d1a45dfULL, -1087, -308},
+  {0xab70fe17c79ac6caULL, -1060, -300},
+  {0xff77b1fcbebcdc4fULL, -1034, -292},
+  {0xbe5691ef416bd60cULL, -1007, -284},
+  {0x8dd01fad907ffc3cULL, -980, -276},
+  {0xd3515c2831559a83ULL, -954, -268},
+  {0x9d71ac8fada6c9b5ULL, -927, -260},
+  {0xea9c227723ee8bcbULL, -901, -252},
+  {0xaecc49914078536dULL, -874, -244},
+  {0x823c12795db6ce57ULL, -847, -236},
+  {0xc21094364dfb5637ULL, -821, -228},
+  {0x9096ea6f3848984fULL, -794, -220},
+  {0xd77485cb25823ac7ULL, -768, -212},
+  {0xa086cfcd97bf97f4ULL, -741, -204},
+  {0xef340a98172aace5ULL, -715, -196},
+  {0xb23867fb2a35b28eULL, -688, -188},
+  {0x84c8d4dfd2c63f3bULL, -661, -180},
+  {0xc5dd44271ad3cdbaULL, -635, -172},
+  {0x936b9fcebb25c996ULL, -608, -164},
+  {0xdbac6c247d62a584ULL, -582, -156},
+  {0xa3ab66580d5fdaf6ULL, -555, -148},
+  {0xf3e2f893dec3f126ULL, -529, -140},
+  {0xb5b5ada8aaff80b8ULL, -502, -132},
+  {0x87625f056c7c4a8bULL, -475, -124},
+  {0xc9bcff6034c13053ULL, -449, -116},
+  {0x964e858c91ba2655ULL, -422, -108},
+  {0xdff9772470297ebdULL, -396, -100},
+  {0xa6dfbd9fb8e5b88fULL, -369, -92},
+  {0xf8a95fcf88747d94ULL, -343, -84},
+  {0xb94470938fa89bcfULL, -316, -76},
+  {0x8a08f0f8bf0f156bULL, -289, -68},
+  {0xcdb02555653131b6ULL, -263, -60},
+  {0x993fe2c6d07b7facULL, -236, -52},
+  {0xe45c10c42a2b3b06ULL, -210, -44},
+  {0xaa242499697392d3ULL, -183, -36},
+  {0xfd87b5f28300ca0eULL, -157, -28},
+  {0xbce5086492111aebULL, -130, -20},
+  {0x8cbccc096f5088ccULL, -103, -12},
+  {0xd1b71758e219652cULL, -77, -4},
+  {0x9c40000000000000ULL, -50, 4},
+  {0xe8d4a51000000000ULL, -24, 12},
+  {0xad78ebc5ac620000ULL, 3, 20},
+  {0x813f3978f8940984ULL, 30, 28},
+  {0xc097ce7bc90715b3ULL, 56, 36},
+  {0x8f7e32ce7bea5c70ULL, 83, 44},
+  {0xd5d238a4abe98068ULL, 109, 52},
+  {0x9f4f2726179a2245ULL, 136, 60},
+  {0xed63a231d4c4fb27ULL, 162, 68},
+  {0xb0de65388cc8ada8ULL, 189, 76},
+  {0x83c7088e1aab65dbULL, 216, 84},
+  {0xc45d1df942711d9aULL, 242, 92},
+  {0x924d692ca61be758ULL, 269, 100},
+  {0xda01ee641a708deaULL, 295, 108},
+  {0xa26da3999aef774aULL, 322, 116},
+  {0xf209787bb47d6b85ULL, 348, 124},
+  {0xb454e4a179dd1877ULL, 375, 132},
+  {0x865b86925b9bc5c2ULL, 402, 140},
+  {0xc83553c5c8965d3dULL, 428, 148},
+  {0x952ab45cfa97a0b3ULL, 455, 156},
+  {0xde469fbd99a05fe3ULL, 481, 164},
+  {0xa59bc234db398c25ULL, 508, 172},
+  {0xf6c69a72a3989f5cULL, 534, 180},
+  {0xb7dcbf5354e9beceULL, 561, 188},
+  {0x88fcf317f22241e2ULL, 588, 196},
+  {0xcc20ce9bd35c78a5ULL, 614, 204},
+  {0x98165af37b2153dfULL, 641, 212},
+  {0xe2a0b5dc971f303aULL, 667, 220},
+  {0xa8d9d1535ce3b396ULL, 694, 228},
+  {0xfb9b7cd9a4a7443cULL, 720, 236},
+  {0xbb764c4ca7a44410ULL, 747, 244},
+  {0x8bab8eefb6409c1aULL, 774, 252},
+  {0xd01fef10a657842cULL, 800, 260},
+  {0x9b10a4e5e9913129ULL, 827, 268},
+  {0xe7109bfba19c0c9dULL, 853, 276},
+  {0xac2820d9623bf429ULL, 880, 284},
+  {0x80444b5e7aa7cf85ULL, 907, 292},
+  {0xbf21e44003acdd2dULL, 933, 300},
+  {0x8e679c2f5e44ff8fULL, 960, 308},
+  {0xd433179d9c8cb841ULL, 986, 316},
+  {0x9e19db92b4e31ba9ULL, 1013, 324},
+  {0xeb96bf6ebadf77d9ULL, 1039, 332},
+  {0xaf87023b9bf0ee6bULL, 1066, 340},
+};
+
+static const int CachedPowersOffset = 348;
+static const int CachedPowersDecimalStep = 8;
+
+/// Find a cached power of ten C such that W * C has a binary exponent in
+/// [MinExponent, MaxExponent], where W has exponent zero.
+static CachedPower getCachedPowerForBinaryExponentRange(int MinExponent,
+                                                        int MaxExponent) {
+  // K = ceil((MinExponent + 63) * log10(2))
+  const double D1Log210 = 0.30102999566398114;
+  int K = int(std::ceil((MinExponent + 63) * D1Log210));
+  unsigned Index =
+    (CachedPowersOffset + K - 1) / CachedPowersDecimalStep + 1;
+  CachedPower Power = CachedPowers[Index];
+  assert(MinExponent <= Power.E && Power.E <= MaxExponent);
+  (void)MaxExponent;
+  return Power;
+}
+
+/// Move the last digit of Buffer towards the real value, and check that the
+/// result is unambiguously the closest representation in the safe interval.
+/// Returns false if Grisu3 cannot guarantee a correct result.
+static bool grisuRoundWeed(char *Buffer, int Length,
+                           uint64_t DistanceTooHighW, uint64_t UnsafeInterval,
+                           uint64_t Rest, uint64_t TenKappa, uint64_t Unit) {
+  uint64_t SmallDistance = DistanceTooHighW - Unit;
+  uint64_t BigDistance = DistanceTooHighW + Unit;
+  while (Rest < SmallDistance &&
+         UnsafeInterval - Rest >= TenKappa &&
+         (Rest + TenKappa < SmallDistance ||
+          SmallDistance - Rest >= Rest + TenKappa - SmallDistance)) {
+    Buffer[Length - 1]--;
+    Rest += TenKappa;
+  }
+
+  if (Rest < BigDistance &&
+      UnsafeInterval - Rest >= TenKappa &&
+      (Rest + TenKappa < BigDistance ||
+       BigDistance - Rest > Rest + TenKappa - BigDistance)) {
+    return false;
+  }
+
+  return 2 * Unit <= Rest && Rest <= UnsafeInterval - 4 * Unit;
+}
+
+/// Find the largest power of ten that is at most Number, along with its
+/// exponent plus one. Number must be less than 2^NumberBits.
+static void biggestPowerTen(uint32_t Number, int NumberBits,
+                            uint32_t &Power, int &ExponentPlusOne) {
+  static const uint32_t SmallPowersOfTen[] = {
+    0, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000
+  };
+  // Estimate with log10(2) ~= 1233/4096, then correct.
+  int Guess = ((NumberBits + 1) * 1233 >> 12) + 1;
+  if (Number < SmallPowersOfTen[Guess])
+    Guess--;
+  Power = SmallPowersOfTen[Guess];
+  ExponentPlusOne = Guess;
+}
+
+/// Generate the shortest digits of W that lie strictly within (Low, High),
+/// which all share an exponent in [-60, -32]. Returns false if Grisu3
+/// cannot guarantee the result.
+static bool grisuDigitGen(DiyFp Low, DiyFp W, DiyFp High,
+                          char *Buffer, int &Length, int &Kappa) {
+  uint64_t Unit = 1;
+  DiyFp TooLow = DiyFp{Low.F - Unit, Low.E};
+  DiyFp TooHigh = DiyFp{High.F + Unit, High.E};
+  uint64_t UnsafeInterval = TooHigh.F - TooLow.F;
+  int OneShift = -W.E;
+  uint64_t OneMask = (uint64_t(1) << OneShift) - 1;
+
+  uint32_t Integrals = uint32_t(TooHigh.F >> OneShift);
+  uint64_t Fractionals = TooHigh.F & OneMask;
+
+  uint32_t Divisor;
+  int DivisorExponentPlusOne;
+  biggestPowerTen(Integrals, 64 - OneShift, Divisor, DivisorExponentPlusOne);
+  Kappa = DivisorExponentPlusOne;
+  Length = 0;
+
+  while (Kappa > 0) {
+    uint32_t Digit = Integrals / Divisor;
+    Buffer[Length++] = char('0' + Digit);
+    Integrals %= Divisor;
+    Kappa--;
+    uint64_t Rest = (uint64_t(Integrals) << OneShift) + Fractionals;
+    if (Rest < UnsafeInterval) {
+      return grisuRoundWeed(Buffer, Length, TooHigh.F - W.F, UnsafeInterval,
+                            Rest, uint64_t(Divisor) << OneShift, Unit);
+    }
+    Divisor /= 10;
+  }
+
+  for (;;) {
+    Fractionals *= 10;
+    Unit *= 10;
+    UnsafeInterval *= 10;
+    Buffer[Length++] = char('0' + (Fractionals >> OneShift));
+    Fractionals &= OneMask;
+    Kappa--;
+    if (Fractionals < UnsafeInterval) {
+      return grisuRoundWeed(Buffer, Length, (TooHigh.F - W.F) * Unit,
+                            UnsafeInterval, Fractionals, OneMask + 1, Unit);
+    }
+  }
+}
+
+/// Compute the shortest decimal digits that read back as the given finite,
+/// positive value, such that Value == Digits * 10^Exponent after rounding.
+/// Returns false if Grisu3 cannot guarantee the result.
+template <typename T>
+static bool grisuShortestDigits(T Value, char *Digits, int &NumDigits,
+                                int &Exponent) {
+  using Layout = FloatingPointLayout<T>;
+  typename Layout::BitsType Bits;
+  static_assert(sizeof(Bits) == sizeof(Value), "unexpected layout");
+  memcpy(&Bits, &Value, sizeof(Bits));
+
+  const uint64_t HiddenBit = uint64_t(1) << Layout::SignificandBits;
+  const int ExponentBias =
+    (1 << (Layout::ExponentBits - 1)) - 1 + Layout::SignificandBits;
+
+  uint64_t Significand = Bits & (HiddenBit - 1);
+  int BiasedExponent =
+    int((Bits >> Layout::SignificandBits) & ((1 << Layout::ExponentBits) - 1));
+
+  DiyFp V;
+  if (BiasedExponent == 0)
+    V = DiyFp{Significand, 1 - ExponentBias};
+  else
+    V = DiyFp{Significand | HiddenBit, BiasedExponent - ExponentBias};
+
+  // The boundaries halfway to the neighboring values. The lower one is
+  // closer if V is a power of two other than the smallest normal.
+  DiyFp Plus = diyFpNormalize(DiyFp{(V.F << 1) + 1, V.E - 1});
+  DiyFp Minus;
+  if (Significand == 0 && BiasedExponent > 1)
+    Minus = DiyFp{(V.F << 2) - 1, V.E - 2};
+  else
+    Minus = DiyFp{(V.F << 1) - 1, V.E - 1};
+  Minus.F <<= Minus.E - Plus.E;
+  Minus.E = Plus.E;
+
+  DiyFp W = diyFpNormalize(V);
+  assert(W.E == Plus.E);
+
+  // Scale everything by a power of ten so that the binary exponent lands
+  // in [-60, -32], where the integral part fits in 32 bits.
+  const int MinimalTargetExponent = -60;
+  const int MaximalTargetExponent = -32;
+  CachedPower Power = getCachedPowerForBinaryExponentRange(
+    MinimalTargetExponent - (W.E + 64), MaximalTargetExponent - (W.E + 64));
+  DiyFp TenMK = DiyFp{Power.F, Power.E};
+
+  int Kappa;
+  if (!grisuDigitGen(diyFpMultiply(Minus, TenMK), diyFpMultiply(W, TenMK),
+                     diyFpMultiply(Plus, TenMK), Digits, NumDigits, Kappa))
+    return false;
+
+  Exponent = Kappa - Power.DecimalExponent;
+  while (NumDigits > 1 && Digits[NumDigits - 1] == '0') {
+    NumDigits--;
+    Exponent++;
+  }
+  return true;
+}
+
+/// Format Digits * 10^Exponent the way "%.*g" would with the given
+/// precision, appending ".0" if the result would otherwise look like an
+/// integer.
+static uint64_t formatDecimal(char *Buffer, bool Negative,
+                              const char *Digits, int NumDigits, int Exponent,
+                              int Precision) {
+  char *P = Buffer;
+  if (Negative)
+    *P++ = '-';
+
+  // The decimal exponent of the leading digit.
+  int X = NumDigits + Exponent - 1;
+
+  if (X < -4 || X >= Precision) {
+    *P++ = Digits[0];
+    if (NumDigits > 1) {
+      *P++ = '.';
+      memcpy(P, Digits + 1, NumDigits - 1);
+      P += NumDigits - 1;
+    }
+    *P++ = 'e';
+    *P++ = X < 0 ? '-' : '+';
+    unsigned AbsX = X < 0 ? -X : X;
+    if (AbsX >= 100)
+      *P++ = char('0' + AbsX / 100);
+    *P++ = char('0' + AbsX / 10 % 10);
+    *P++ = char('0' + AbsX % 10);
+  } else if (X < 0) {
+    *P++ = '0';
+    *P++ = '.';
+    for (int i = -1; i > X; --i)
+      *P++ = '0';
+    memcpy(P, Digits, NumDigits);
+    P += NumDigits;
+  } else if (NumDigits <= X + 1) {
+    memcpy(P, Digits, NumDigits);
+    P += NumDigits;
+    for (int i = NumDigits; i <= X; ++i)
+      *P++ = '0';
+    *P++ = '.';
+    *P++ = '0';
+  } else {
+    memcpy(P, Digits, X + 1);
+    P += X + 1;
+    *P++ = '.';
+    memcpy(P, Digits + X + 1, NumDigits - (X + 1));
+    P += NumDigits - (X + 1);
+  }
+
+  *P = '\0';
+  return uint64_t(P - Buffer);
+}
+
+static bool roundTripsInCLocale(const char *String, float Value) {
+  return strtof_l(String, nullptr, getCLocale()) == Value;
+}
+
+static bool roundTripsInCLocale(const char *String, double Value) {
+  return strtod_l(String, nullptr, getCLocale()) == Value;
+}
+
+/// Find the shortest digits of a finite, positive value the slow way, by
+/// printing it with increasing precision until it reads back unchanged.
+template <typename T>
+static void snprintfShortestDigits(T Value, char *Digits, int &NumDigits,
+                                   int &Exponent) {
+  char Scratch[64];
+  for (int Precision = 1;; ++Precision) {
+    swift_snprintf_l(Scratch, sizeof(Scratch), /*locale=*/nullptr, "%.*e",
+                     Precision - 1, double(Value));
+    if (Precision < std::numeric_limits<T>::max_digits10 &&
+        !roundTripsInCLocale(Scratch, Value))
+      continue;
+
+    // Scratch is "d.ddde[+-]xx".
+    NumDigits = 0;
+    const char *P = Scratch;
+    for (; *P != 'e'; ++P)
+      if (*P != '.')
+        Digits[NumDigits++] = *P;
+    int DecimalExponent = atoi(P + 1);
+    Exponent = DecimalExponent - (NumDigits - 1);
+    while (NumDigits > 1 && Digits[NumDigits - 1] == '0') {
+      NumDigits--;
+      Exponent++;
+    }
+    return;
+  }
+}
+
+/// Print a Float or Double in the C locale. In debug mode this is the
+/// shortest representation that reads back as the same value; otherwise it
+/// is the value rounded to digits10 significant digits.
+template <typename T>
+static uint64_t swift_floatingPointToStringShortest(char *Buffer,
+                                                    size_t BufferLength,
+                                                    T Value, bool Debug) {
+  if (BufferLength < 32)
+    swift::crash("swift_floatingPointToString: insufficient buffer size");
+
+  if (!std::isfinite(Value))
+    return swift_floatingPointToString<T>(Buffer, BufferLength, Value,
+                                          "%0.*g", Debug);
+
+  bool Negative = std::signbit(Value);
+  if (Value == 0) {
+    const char *Zero = Negative ? "-0.0" : "0.0";
+    strcpy(Buffer, Zero);
+    return strlen(Zero);
+  }
+
+  char Digits[std::numeric_limits<T>::max_digits10 + 1];
+  int NumDigits, Exponent;
+  if (!grisuShortestDigits<T>(std::fabs(Value), Digits, NumDigits, Exponent))
+    snprintfShortestDigits<T>(std::fabs(Value), Digits, NumDigits, Exponent);
+
+  if (Debug) {
+    return formatDecimal(Buffer, Negative, Digits, NumDigits, Exponent,
+                         std::numeric_limits<T>::max_digits10);
+  }
+
+  // Any decimal with at most digits10 significant digits survives a round
+  // trip through a normal T, so when the shortest representation is that
+  // short it is exactly what rounding to digits10 digits would produce.
+  // Subnormals have less precision and don't get this guarantee.
+  if (NumDigits <= std::numeric_limits<T>::digits10 && std::isnormal(Value)) {
+    return formatDecimal(Buffer, Negative, Digits, NumDigits, Exponent,
+                         std::numeric_limits<T>::digits10);
+  }
+  return swift_floatingPointToString<T>(Buffer, BufferLength, Value,
+                                        "%0.*g", Debug);
+}
+#endif
+
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern "C" uint64_t swift_float32ToString(char *Buffer, size_t BufferLength,
                                           float Value, bool Debug) {
+#if defined(__CYGWIN__)
   return swift_floatingPointToString<float>(Buffer, BufferLength, Value,
                                             "%0.*g", Debug);
+#else
+  return swift_floatingPointToStringShortest<float>(Buffer, BufferLength,
+                                                    Value, Debug);
+#endif
 }
 
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern "C" uint64_t swift_float64ToString(char *Buffer, size_t BufferLength,
                                           double Value, bool Debug) {
+#if defined(__CYGWIN__)
   return swift_floatingPointToString<double>(Buffer, BufferLength, Value,
                                              "%0.*g", Debug);
+#else
+  return swift_floatingPointToStringShortest<double>(Buffer, BufferLength,
+                                                     Value, Debug);
+#endif
 }
 
 SWIFT_RUNTIME_STDLIB_INTERFACE
@@ -187,15 +187,24 @@ PrintTests.test("Printable") {
   expectPrinted("1.25e-17", asFloat80(0.0000000000000000125))
 #endif
 
-  expectDebugPrinted("1.10000002", asFloat32(1.1))
-  expectDebugPrinted("1.24999998e+17", asFloat32(125000000000000000.0))
+  // Float and Double debug descriptions are the shortest strings that
+  // round-trip.
+  expectDebugPrinted("1.1", asFloat32(1.1))
+  expectDebugPrinted("1.25e+17", asFloat32(125000000000000000.0))
   expectDebugPrinted("1.25", asFloat32(1.25))
-  expectDebugPrinted("1.24999997e-05", asFloat32(0.0000125))
+  expectDebugPrinted("1.25e-05", asFloat32(0.0000125))
+  expectDebugPrinted("16777216.0", asFloat32(16777216.0))
+  expectDebugPrinted("3.4028235e+38", Float._fromBitPattern(0x7f7f_ffff))
+  expectDebugPrinted("1e-45", Float._fromBitPattern(1))
 
-  expectDebugPrinted("1.1000000000000001", asFloat64(1.1))
+  expectDebugPrinted("1.1", asFloat64(1.1))
   expectDebugPrinted("1.25e+17", asFloat64(125000000000000000.0))
   expectDebugPrinted("1.25", asFloat64(1.25))
-  expectDebugPrinted("1.2500000000000001e-05", asFloat64(0.0000125))
+  expectDebugPrinted("1.25e-05", asFloat64(0.0000125))
+  expectDebugPrinted("1e+23", asFloat64(1e23))
+  expectDebugPrinted("1.7976931348623157e+308",
+    Double._fromBitPattern(0x7fef_ffff_ffff_ffff))
+  expectDebugPrinted("5e-324", Double._fromBitPattern(1))
 
 #if arch(i386) || arch(x86_64)
   expectDebugPrinted("1.10000000000000000002", asFloat80(1.1))
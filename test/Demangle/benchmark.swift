@@ -0,0 +1,11 @@
+; This is not really a Swift source file: -*- Text -*-
+
+RUN: swift-demangle -benchmark 3 < %S/Inputs/manglings.txt | FileCheck %s
+RUN: swift-demangle -benchmark 2 _TtBi32_ _TtSi | FileCheck %s -check-prefix=NAMES
+RUN: swift-demangle -benchmark 2 -j 4 < %S/Inputs/manglings.txt | FileCheck %s -check-prefix=THREADS
+
+CHECK: Demangled {{[0-9]+}} symbols ({{[0-9]+}} characters) in {{[0-9.]+}} s: {{[0-9]+}} symbols/s with 1 thread
+NAMES: Demangled 4 symbols ({{[0-9]+}} characters) in
+
+THREADS: symbols/s with 1 thread
+THREADS: symbols/s with 4 threads
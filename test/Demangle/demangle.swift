@@ -9,6 +9,10 @@ RUN: sed -ne '/--->/s/^.*---> *//p' < %S/Inputs/manglings.txt > %t.check
 RUN: swift-demangle < %t.input > %t.output
 RUN: diff %t.check %t.output
 
+Splitting the input among threads must not change the output or its order.
+RUN: swift-demangle -j 4 < %t.input > %t.output-threaded
+RUN: diff %t.check %t.output-threaded
+
 ; RUN: swift-demangle __TtSi | FileCheck %s -check-prefix=DOUBLE
 ; DOUBLE: _TtSi ---> Swift.Int
 
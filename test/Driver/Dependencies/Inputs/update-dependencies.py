@@ -24,6 +24,8 @@
 # the old dependencies (if present).
 #
 # If invoked in non-primary-file mode, it only creates the output file.
+# In batch mode, the primary files are matched to their outputs and
+# dependencies files by position.
 #
 # ----------------------------------------------------------------------------
 
@@ -35,24 +37,34 @@ import sys
 
 assert sys.argv[1] == '-frontend'
 
-if '-primary-file' in sys.argv:
-    primaryFile = sys.argv[sys.argv.index('-primary-file') + 1]
-    depsFile = sys.argv[sys.argv.index(
-        '-emit-reference-dependencies-path') + 1]
+
+def values_of(option):
+    return [sys.argv[i + 1] for i, arg in enumerate(sys.argv)
+            if arg == option]
+
+
+primaryFiles = values_of('-primary-file')
+depsFiles = values_of('-emit-reference-dependencies-path')
+outputFiles = values_of('-o')
+
+if primaryFiles:
+    assert len(depsFiles) == len(primaryFiles)
+    assert len(outputFiles) == len(primaryFiles)
 
     # Replace the dependencies file with the input file.
-    shutil.copyfile(primaryFile, depsFile)
+    for primaryFile, depsFile in zip(primaryFiles, depsFiles):
+        shutil.copyfile(primaryFile, depsFile)
 else:
-    primaryFile = None
-
-outputFile = sys.argv[sys.argv.index('-o') + 1]
+    outputFiles = outputFiles[:1]
 
 # Update the output file mtime, or create it if necessary.
 # From http://stackoverflow.com/a/1160227.
-with open(outputFile, 'a'):
-    os.utime(outputFile, None)
+for outputFile in outputFiles:
+    with open(outputFile, 'a'):
+        os.utime(outputFile, None)
 
-if primaryFile:
-    print("Handled", os.path.basename(primaryFile))
+if primaryFiles:
+    for primaryFile in primaryFiles:
+        print("Handled", os.path.basename(primaryFile))
 else:
-    print("Produced", os.path.basename(outputFile))
+    print("Produced", os.path.basename(outputFiles[0]))
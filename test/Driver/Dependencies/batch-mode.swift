@@ -0,0 +1,50 @@
+// main | other
+
+// Batch mode must produce the same outputs as one frontend job per file.
+
+// RUN: rm -rf %t && mkdir %t
+// RUN: cp -r %S/Inputs/independent/ %t/single
+// RUN: cp -r %S/Inputs/independent/ %t/batch
+// RUN: touch -t 201401240005 %t/single/* %t/batch/*
+
+// RUN: cd %t/single && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/single/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-SINGLE %s
+// RUN: cd %t/batch && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/batch/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v -enable-batch-mode 2>&1 | FileCheck -check-prefix=CHECK-BATCH %s
+
+// CHECK-SINGLE: -primary-file ./main.swift ./other.swift
+// CHECK-SINGLE: Handled main.swift
+// CHECK-SINGLE: ./main.swift -primary-file ./other.swift
+// CHECK-SINGLE: Handled other.swift
+
+// CHECK-BATCH-NOT: Handled
+// CHECK-BATCH: -primary-file ./main.swift -primary-file ./other.swift {{.*}}-emit-reference-dependencies-path ./main.swiftdeps -emit-reference-dependencies-path ./other.swiftdeps {{.*}}-o ./main.o -o ./other.o
+// CHECK-BATCH-NEXT: Handled main.swift
+// CHECK-BATCH-NEXT: Handled other.swift
+// CHECK-BATCH-NOT: Handled
+
+// RUN: (cd %t/single && ls *.o *.swiftdeps) > %t/single.txt
+// RUN: (cd %t/batch && ls *.o *.swiftdeps) > %t/batch.txt
+// RUN: diff %t/single.txt %t/batch.txt
+// RUN: diff %t/single/main.swiftdeps %t/batch/main.swiftdeps
+// RUN: diff %t/single/other.swiftdeps %t/batch/other.swiftdeps
+
+// With more parallel jobs than files, every file gets its own frontend job.
+
+// RUN: rm -rf %t/batch && cp -r %S/Inputs/independent/ %t/batch
+// RUN: touch -t 201401240005 %t/batch/*
+// RUN: cd %t/batch && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/batch/output.json -incremental ./main.swift ./other.swift -module-name main -j2 -v -enable-batch-mode 2>&1 | FileCheck -check-prefix=CHECK-PARALLEL %s
+
+// CHECK-PARALLEL-NOT: -primary-file ./main.swift -primary-file ./other.swift
+// CHECK-PARALLEL-DAG: Handled main.swift
+// CHECK-PARALLEL-DAG: Handled other.swift
+
+// Incremental builds still only rebuild the files that changed.
+
+// RUN: touch -t 201401240006 %t/batch/main.swift
+// RUN: cd %t/batch && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/batch/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v -enable-batch-mode 2>&1 | FileCheck -check-prefix=CHECK-INCREMENTAL %s
+
+// CHECK-INCREMENTAL-NOT: Handled other.swift
+// CHECK-INCREMENTAL: Handled main.swift
+// CHECK-INCREMENTAL-NOT: Handled other.swift
+
+// RUN: touch -t 201401240007 %t/batch/main.swift %t/batch/other.swift
+// RUN: cd %t/batch && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/batch/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v -enable-batch-mode -disable-batch-mode 2>&1 | FileCheck -check-prefix=CHECK-SINGLE %s
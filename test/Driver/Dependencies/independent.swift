@@ -5,6 +5,7 @@
 
 // RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental -driver-always-rebuild-dependents ./main.swift -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-FIRST %s
 // RUN: ls %t/main~buildrecord.swiftdeps
+// RUN: ls %t/main~buildrecord.swiftdeps.graph
 
 // CHECK-FIRST-NOT: warning
 // CHECK-FIRST: Handled main.swift
@@ -0,0 +1,35 @@
+// main | other
+
+// RUN: rm -rf %t && cp -r %S/Inputs/independent/ %t
+// RUN: touch -t 201401240005 %t/*
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j2 -parseable-output 2>&1 | FileCheck -check-prefix=CHECK-PARSEABLE %s
+
+// CHECK-PARSEABLE: "kind": "finished"
+// CHECK-PARSEABLE: "wall-time": {{[0-9.e+-]+}},
+// CHECK-PARSEABLE-NEXT: "exit-status": 0
+// CHECK-PARSEABLE: "kind": "finished"
+// CHECK-PARSEABLE: "wall-time": {{[0-9.e+-]+}},
+// CHECK-PARSEABLE-NEXT: "exit-status": 0
+
+// RUN: FileCheck -check-prefix=CHECK-RECORD %s < %t/main~buildrecord.swiftdeps
+
+// CHECK-RECORD: durations:
+// CHECK-RECORD-DAG: "./main.swift": {{[0-9]+$}}
+// CHECK-RECORD-DAG: "./other.swift": {{[0-9]+$}}
+
+// Files that don't need to be rebuilt keep their recorded durations.
+
+// RUN: touch -t 201401240006 %t/main.swift
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j2 -v 2>&1 | FileCheck -check-prefix=CHECK-SECOND %s
+// RUN: FileCheck -check-prefix=CHECK-RECORD %s < %t/main~buildrecord.swiftdeps
+
+// CHECK-SECOND-NOT: Handled other.swift
+// CHECK-SECOND: Handled main.swift
+// CHECK-SECOND-NOT: Handled other.swift
+
+// Simulated tasks don't report a wall time.
+
+// RUN: cd %t && %swiftc_driver -c -output-file-map %t/output.json ./main.swift ./other.swift -module-name main -j2 -parseable-output -driver-skip-execution 2>&1 | FileCheck -check-prefix=CHECK-SKIPPED %s
+
+// CHECK-SKIPPED-NOT: wall-time
@@ -0,0 +1,21 @@
+// RUN: rm -rf %t && cp -r %S/Dependencies/Inputs/independent/ %t
+// RUN: touch -t 201401240005 %t/*
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Dependencies/Inputs/update-dependencies.py -output-file-map %t/output.json ./main.swift ./other.swift -module-name main -j2 -trace-file %t/trace.json -v 2>&1 | FileCheck -check-prefix=CHECK-COMMAND %s
+// RUN: FileCheck %s < %t/trace.json
+
+// CHECK-COMMAND: -primary-file ./main.swift {{.*}}-trace-file {{[^ ]*}}trace-{{[^ ]*}}.json
+// CHECK-COMMAND: -primary-file ./other.swift {{.*}}-trace-file {{[^ ]*}}trace-{{[^ ]*}}.json
+
+// CHECK: [
+// CHECK-DAG: "name": "compile main.swift", "cat": "job"
+// CHECK-DAG: "name": "compile other.swift", "cat": "job"
+// CHECK-DAG: "name": "Compilation", "cat": "process"
+// CHECK: ]
+
+// Batch jobs get one span naming all of their primary files.
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Dependencies/Inputs/update-dependencies.py -output-file-map %t/output.json ./main.swift ./other.swift -module-name main -j1 -enable-batch-mode -trace-file %t/batch-trace.json
+// RUN: FileCheck -check-prefix=CHECK-BATCH %s < %t/batch-trace.json
+
+// CHECK-BATCH: "name": "compile main.swift, other.swift", "cat": "job"
@@ -0,0 +1,5 @@
+func missingReturn(_ flag: Bool) -> Int {
+  if flag {
+    return 1
+  }
+}
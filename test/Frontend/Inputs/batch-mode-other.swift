@@ -0,0 +1,8 @@
+struct Point {
+  var x: Int
+  var y: Int
+}
+
+func makePoint(_ value: Int) -> Point {
+  return Point(x: value, y: value + 1)
+}
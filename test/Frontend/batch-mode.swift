@@ -0,0 +1,34 @@
+// RUN: rm -rf %t && mkdir %t
+
+// A frontend job with several primary files must produce the same outputs as
+// one job per primary file.
+
+// RUN: %target-swift-frontend -c -module-name main -primary-file %s -primary-file %S/Inputs/batch-mode-other.swift -o %t/batch-main.o -o %t/batch-other.o -emit-reference-dependencies-path %t/batch-main.swiftdeps -emit-reference-dependencies-path %t/batch-other.swiftdeps
+// RUN: %target-swift-frontend -c -module-name main -primary-file %s %S/Inputs/batch-mode-other.swift -o %t/main.o -emit-reference-dependencies-path %t/main.swiftdeps
+// RUN: %target-swift-frontend -c -module-name main %s -primary-file %S/Inputs/batch-mode-other.swift -o %t/other.o -emit-reference-dependencies-path %t/other.swiftdeps
+
+// RUN: cmp %t/main.o %t/batch-main.o
+// RUN: cmp %t/other.o %t/batch-other.o
+// RUN: diff %t/main.swiftdeps %t/batch-main.swiftdeps
+// RUN: diff %t/other.swiftdeps %t/batch-other.swiftdeps
+
+// Errors are shared by all the primary files of a job. Once compiling one of
+// them fails, the outputs of the remaining ones are not written, and each of
+// those is diagnosed.
+
+// RUN: rm -f %t/batch-main.o %t/batch-other.o
+// RUN: not %target-swift-frontend -c -module-name main -primary-file %S/Inputs/batch-mode-missing-return.swift -primary-file %s -primary-file %S/Inputs/batch-mode-other.swift -o %t/batch-missing-return.o -o %t/batch-main.o -o %t/batch-other.o 2>&1 | FileCheck %s
+// RUN: not ls %t/batch-main.o
+// RUN: not ls %t/batch-other.o
+
+// CHECK: batch-mode-missing-return.swift:5:1: error: missing return in a function expected to return 'Int'
+// CHECK: error: outputs for primary file '{{.*}}batch-mode.swift' were not written because of earlier errors
+// CHECK: error: outputs for primary file '{{.*}}batch-mode-other.swift' were not written because of earlier errors
+
+func distance(_ p: Point) -> Int {
+  return p.x * p.x + p.y * p.y
+}
+
+public func run() -> Int {
+  return distance(makePoint(3))
+}
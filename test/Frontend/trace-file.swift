@@ -0,0 +1,12 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swift-frontend -emit-sil -O -primary-file %s -module-name main -trace-file %t/trace.json -o /dev/null
+// RUN: FileCheck %s < %t/trace.json
+
+// CHECK: [
+// CHECK-DAG: {"ph": "X", "name": "Parsing", "cat": "phase", "ts": {{[0-9]+}}, "dur": {{[0-9]+}}, "pid": {{[0-9]+}}, "tid": {{[0-9]+}}}
+// CHECK-DAG: "name": "SILGen", "cat": "phase"
+// CHECK-DAG: "cat": "SIL pass"
+// CHECK-DAG: "name": "Frontend", "cat": "process"
+// CHECK: ]
+
+func foo() -> Int { return 42 }
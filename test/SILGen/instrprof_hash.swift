@@ -0,0 +1,32 @@
+// RUN: %target-swift-frontend -parse-as-library -emit-silgen -profile-generate %s | FileCheck %s
+
+// The function hash reflects the structure of the counted regions, so that a
+// profile recorded before the function changed isn't applied to it.
+
+// CHECK: sil hidden @[[F_LOOP:.*loop.*]] :
+// CHECK: string_literal utf8 "{{.*}}instrprof_hash.swift:[[F_LOOP]]"
+// CHECK: integer_literal $Builtin.Int64, [[LOOP_HASH:-?[1-9][0-9]*]]
+func loop(n: Int) {
+  while n == 0 {
+  }
+}
+
+// The same structure has the same hash.
+// CHECK: sil hidden @[[F_OTHER_LOOP:.*otherLoop.*]] :
+// CHECK: string_literal utf8 "{{.*}}instrprof_hash.swift:[[F_OTHER_LOOP]]"
+// CHECK: integer_literal $Builtin.Int64, [[LOOP_HASH]]{{$}}
+func otherLoop(m: Int) {
+  while m != 1 {
+  }
+}
+
+// A different one doesn't.
+// CHECK: sil hidden @[[F_BRANCH:.*branch.*]] :
+// CHECK: string_literal utf8 "{{.*}}instrprof_hash.swift:[[F_BRANCH]]"
+// CHECK-NOT: integer_literal $Builtin.Int64, [[LOOP_HASH]]{{$}}
+// CHECK: integer_literal $Builtin.Int64, {{-?[1-9][0-9]*}}
+// CHECK: builtin "int_instrprof_increment"
+func branch(n: Int) {
+  if n == 0 {
+  }
+}
@@ -0,0 +1,5 @@
+// RUN: not %target-swift-frontend -emit-silgen -profile-use=%t.missing.profdata %s 2>&1 | FileCheck %s
+
+// CHECK: error: failed to load profile data '{{.*}}.missing.profdata':
+
+func f() {}
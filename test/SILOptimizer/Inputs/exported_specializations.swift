@@ -0,0 +1,16 @@
+@inline(never)
+public func identity<T>(_ x: T) -> T {
+  return x
+}
+
+public func identityOfInt(_ x: Int) -> Int {
+  return identity(x)
+}
+
+@inline(never)
+public func makeArray() -> [Int] {
+  var a = [Int]()
+  a.append(1)
+  a.append(2)
+  return a
+}
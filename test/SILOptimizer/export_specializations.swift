@@ -0,0 +1,7 @@
+// RUN: %target-swift-frontend -O -export-specializations -emit-sil %S/Inputs/exported_specializations.swift -module-name Exported | FileCheck %s
+
+// Specializations of the module's own generic functions are exported. The
+// ones of generics from other modules, like the standard library, stay
+// shared: any other module could export the same symbol.
+// CHECK-DAG: sil {{(\[[a-z_]+\] )*}}@_TTSg5Si___TF8Exported8identityurFxx :
+// CHECK-DAG: sil shared {{.*}}@_TTSg5Si___TFSa6append
@@ -0,0 +1,54 @@
+// RUN: %target-swift-frontend -O -emit-sil %s -print-stats 2>&1 | FileCheck %s
+// RUN: %target-swift-frontend -emit-sil %s | %target-sil-opt -side-effects-dump -escapes-dump -closure-specialize -capture-prop -side-effects-dump -escapes-dump -stats -o /dev/null > %t.stats 2>&1
+// RUN: FileCheck --check-prefix=PASSES %s < %t.stats
+// RUN: FileCheck --check-prefix=NOWHOLE %s < %t.stats
+// REQUIRES: asserts
+
+// The side-effect and escape analysis only recompute the functions which were
+// invalidated (and their callers), not the whole call graph.
+
+// CHECK-DAG: {{[0-9]+}} sil-escape{{ +}}- Number of functions visited in escape analysis recomputations
+// CHECK-DAG: {{[0-9]+}} sil-escape{{ +}}- Number of functions whose connection graphs were recomputed
+// CHECK-DAG: {{[0-9]+}} sil-escape{{ +}}- Number of functions whose connection graphs were invalidated, including callers
+// CHECK-DAG: {{[0-9]+}} sil-sea{{ +}}- Number of functions visited in side-effect recomputations
+// CHECK-DAG: {{[0-9]+}} sil-sea{{ +}}- Number of functions whose side-effects were recomputed
+// CHECK-DAG: {{[0-9]+}} sil-sea{{ +}}- Number of functions whose side-effects were invalidated, including callers
+
+// Closure specialization only invalidates the functions it changed. The
+// dumps after it recompute those and reuse the other summaries.
+// PASSES-DAG: {{[1-9][0-9]*}} closure-specialization{{ +}}- Number of functions with closures specialized
+// PASSES-DAG: {{[1-9][0-9]*}} sil-escape{{ +}}- Number of functions whose connection graphs were invalidated, including callers
+// PASSES-DAG: {{[1-9][0-9]*}} sil-sea{{ +}}- Number of functions whose side-effects were invalidated, including callers
+// NOWHOLE-NOT: Number of invalidations of all side-effect information
+// NOWHOLE-NOT: Number of invalidations of all connection graphs
+
+final class Node {
+  var next: Node?
+  var value: Int
+
+  init(_ value: Int, _ next: Node?) {
+    self.value = value
+    self.next = next
+  }
+}
+
+@inline(never)
+func sum(_ n: Node?) -> Int {
+  var result = 0
+  var current = n
+  while let c = current {
+    result += c.value
+    current = c.next
+  }
+  return result
+}
+
+@inline(never)
+func apply(_ f: (Int) -> Int, _ x: Int) -> Int {
+  return f(x)
+}
+
+public func run(_ x: Int) -> Int {
+  let list = Node(x, Node(x + 1, nil))
+  return apply({ $0 + sum(list) }, x)
+}
@@ -0,0 +1,37 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-build-swift %s -profile-generate -module-name pgo -o %t/main
+// RUN: env LLVM_PROFILE_FILE=%t/default.profraw %target-run %t/main
+// RUN: %llvm-profdata merge %t/default.profraw -o %t/default.profdata
+// RUN: %target-swift-frontend %s -emit-silgen -profile-use=%t/default.profdata -module-name pgo | FileCheck %s --check-prefix=SILGEN
+// RUN: %target-swift-frontend %s -O -emit-sil -profile-use=%t/default.profdata -module-name pgo | FileCheck %s --check-prefix=OPT
+// RUN: rm -rf %t
+
+// REQUIRES: profile_runtime
+// REQUIRES: OS=macosx
+// REQUIRES: executable_test
+
+@inline(never)
+func describe<T>(x: T) -> String {
+  return "value: \(x)"
+}
+
+// SILGEN-LABEL: sil @_TF3pgo3run
+// SILGEN: bb0({{.*}}):{{ *}}// Count: 1
+// SILGEN-DAG: // Count: 100
+// SILGEN-DAG: // Count: 0
+
+// The profile never saw the negative path, so the generic call on it is left
+// alone instead of being specialized.
+// OPT-NOT: sil {{.*}}@_TTSg{{.*}}8describe
+public func run(n: Int) -> Int {
+  var total = 0
+  for i in 0..<n {
+    total = total &+ i
+  }
+  if n < 0 {
+    print(describe(x: n))
+  }
+  return total
+}
+
+print(run(n: Int(Process.argc) * 100))
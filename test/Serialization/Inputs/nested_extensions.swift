@@ -0,0 +1,64 @@
+public struct Index {
+  public init() {}
+}
+
+public struct Outer {
+  public struct Index {
+    public init() {}
+  }
+}
+
+extension Outer {
+  public struct Nested {
+    public init() {}
+  }
+}
+
+extension Index {
+  public func topLevelIndexMethod() {}
+}
+
+extension Outer.Index {
+  public func outerIndexMethod() {}
+}
+
+extension Outer.Nested {
+  public func nestedMethod() {}
+}
+
+// Deserializing this extension deserializes all of these protocols.
+public protocol P0 {}
+public protocol P1 {}
+public protocol P2 {}
+public protocol P3 {}
+public protocol P4 {}
+public protocol P5 {}
+public protocol P6 {}
+public protocol P7 {}
+public protocol P8 {}
+public protocol P9 {}
+public protocol P10 {}
+public protocol P11 {}
+public protocol P12 {}
+public protocol P13 {}
+public protocol P14 {}
+public protocol P15 {}
+public protocol P16 {}
+public protocol P17 {}
+public protocol P18 {}
+public protocol P19 {}
+public protocol P20 {}
+public protocol P21 {}
+public protocol P22 {}
+public protocol P23 {}
+public protocol P24 {}
+public protocol P25 {}
+public protocol P26 {}
+public protocol P27 {}
+public protocol P28 {}
+public protocol P29 {}
+
+extension Outer.Index :
+    P0, P1, P2, P3, P4, P5, P6, P7, P8, P9,
+    P10, P11, P12, P13, P14, P15, P16, P17, P18, P19,
+    P20, P21, P22, P23, P24, P25, P26, P27, P28, P29 {}
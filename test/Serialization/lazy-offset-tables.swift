@@ -0,0 +1,16 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/def_func.swift
+// RUN: %target-swift-frontend -parse -I %t %s -print-stats 2>&1 | FileCheck %s
+// REQUIRES: asserts
+
+// Offset tables are decoded on demand, and each deserialized entity is
+// counted.
+
+// CHECK-DAG: {{[0-9]+}} Serialization - Number of decls deserialized
+// CHECK-DAG: {{[0-9]+}} Serialization - Number of identifiers deserialized
+// CHECK-DAG: {{[0-9]+}} Serialization - Number of types deserialized
+
+import def_func
+
+let zero = getZero()
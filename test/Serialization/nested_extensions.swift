@@ -0,0 +1,27 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/nested_extensions.swift
+// RUN: %target-swift-frontend -parse -verify -I %t %s
+
+// Extensions are found for the type they extend, and not for other types
+// with the same name.
+
+import nested_extensions
+
+struct Index {}
+extension Index {
+  func localMethod() {}
+}
+
+func test() {
+  nested_extensions.Index().topLevelIndexMethod()
+  nested_extensions.Index().outerIndexMethod() // expected-error {{value of type 'nested_extensions.Index' has no member 'outerIndexMethod'}}
+
+  Outer.Index().outerIndexMethod()
+  Outer.Index().topLevelIndexMethod() // expected-error {{value of type 'Outer.Index' has no member 'topLevelIndexMethod'}}
+
+  Outer.Nested().nestedMethod()
+
+  Index().localMethod()
+  Index().topLevelIndexMethod() // expected-error {{value of type 'Index' has no member 'topLevelIndexMethod'}}
+}
@@ -0,0 +1,17 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -parse-stdlib -o %t %S/Inputs/nested_extensions.swift
+// RUN: %target-swift-frontend -parse -parse-stdlib -I %t %s -print-stats 2>&1 | FileCheck %s
+// REQUIRES: asserts
+
+// Looking up the extensions of nested_extensions.Index must not deserialize
+// the extensions of Outer.Index. One of those conforms to 30 protocols, which
+// would all be deserialized with it.
+
+// CHECK: {{^ *([0-9]|[12][0-9])}} Serialization - Number of decls deserialized
+
+import nested_extensions
+
+func test() {
+  nested_extensions.Index().topLevelIndexMethod()
+}
@@ -15,15 +15,22 @@
 //===----------------------------------------------------------------------===//
 
 #include "swift/Basic/DemangleWrappers.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
-#include "llvm/Support/Regex.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <thread>
+#include <vector>
 
 static llvm::cl::opt<bool>
 ExpandMode("expand",
@@ -49,10 +56,20 @@ static llvm::cl::opt<bool>
 Simplified("simplified",
            llvm::cl::desc("Don't display module names or implicit self types"));
 
+static llvm::cl::opt<unsigned>
+BenchmarkIterations("benchmark",
+           llvm::cl::desc("Demangle the inputs this many times and report the throughput instead of the demangled names"),
+           llvm::cl::init(0));
+
 static llvm::cl::list<std::string>
 InputNames(llvm::cl::Positional, llvm::cl::desc("[mangled name...]"),
                llvm::cl::ZeroOrMore);
 
+static llvm::cl::opt<unsigned>
+NumThreads("j",
+           llvm::cl::desc("Number of threads to demangle standard input with"),
+           llvm::cl::init(1));
+
 static void demangle(llvm::raw_ostream &os, llvm::StringRef name,
                      const swift::Demangle::DemangleOptions &options) {
   bool hadLeadingUnderscore = false;
@@ -63,37 +80,204 @@ static void demangle(llvm::raw_ostream &os, llvm::StringRef name,
   swift::Demangle::NodePointer pointer =
       swift::demangle_wrappers::demangleSymbolAsNode(name);
   if (ExpandMode || TreeOnly) {
-    llvm::outs() << "Demangling for " << name << '\n';
-    swift::demangle_wrappers::NodeDumper(pointer).print(llvm::outs());
+    os << "Demangling for " << name << '\n';
+    swift::demangle_wrappers::NodeDumper(pointer).print(os);
   }
   if (RemangleMode) {
-    if (hadLeadingUnderscore) llvm::outs() << '_';
+    if (hadLeadingUnderscore) os << '_';
     // Just reprint the original mangled name if it didn't demangle.
     // This makes it easier to share the same database between the
     // mangling and demangling tests.
     if (!pointer) {
-      llvm::outs() << name;
+      os << name;
     } else {
-      llvm::outs() << swift::Demangle::mangleNode(pointer);
+      os << swift::Demangle::mangleNode(pointer);
     }
     return;
   }
   if (!TreeOnly) {
     std::string string = swift::Demangle::nodeToString(pointer, options);
     if (!CompactMode)
-      llvm::outs() << name << " ---> ";
-    llvm::outs() << (string.empty() ? name : llvm::StringRef(string));
+      os << name << " ---> ";
+    os << (string.empty() ? name : llvm::StringRef(string));
   }
 }
 
-static llvm::StringRef substrBefore(llvm::StringRef whole,
-                                    llvm::StringRef part) {
-  return whole.slice(0, part.data() - whole.data());
+static bool isMangledNameChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
+
+namespace {
+/// The state of one of the threads demangling standard input.
+struct DemangleWorker {
+  /// The demanglings of the names this worker has seen, since names tend to
+  /// repeat throughout logs and symbol dumps.
+  llvm::StringMap<std::string> Cache;
+
+  /// The output for the piece of the current block given to this worker.
+  std::string Output;
+
+  /// The number of mangled names found in the current block.
+  size_t NumNames = 0;
+
+  /// Copies \p text to \c Output, replacing each span that looks like a
+  /// mangled name with its demangling.
+  ///
+  /// The spans are those matched by the regular expression
+  /// "_T[_a-zA-Z0-9$]+". This doesn't handle Unicode symbols, but maybe
+  /// that's okay.
+  void run(llvm::StringRef text,
+           const swift::Demangle::DemangleOptions &options) {
+    // Bound the cache, in case the input doesn't repeat itself.
+    if (Cache.size() > (1 << 16))
+      Cache.clear();
+
+    Output.clear();
+    NumNames = 0;
+    llvm::raw_string_ostream os(Output);
+    size_t copied = 0;
+    size_t pos = 0;
+    while ((pos = text.find("_T", pos)) != llvm::StringRef::npos) {
+      size_t end = pos + 2;
+      while (end != text.size() && isMangledNameChar(text[end]))
+        ++end;
+      if (end == pos + 2) {
+        pos = end;
+        continue;
+      }
+
+      llvm::StringRef name = text.slice(pos, end);
+      auto cached = Cache.insert({name, std::string()});
+      if (cached.second) {
+        llvm::raw_string_ostream demangled(cached.first->getValue());
+        demangle(demangled, name, options);
+      }
+      os << text.slice(copied, pos) << cached.first->getValue();
+      ++NumNames;
+      copied = pos = end;
+    }
+    os << text.substr(copied);
+  }
+};
+} // end anonymous namespace
+
+/// Splits \p text among \p workers at line boundaries, which mangled names
+/// never span, and demangles the pieces in parallel.
+///
+/// \returns the number of mangled names found
+static size_t demangleBlock(llvm::StringRef text,
+                            std::vector<DemangleWorker> &workers,
+                            const swift::Demangle::DemangleOptions &options) {
+  std::vector<llvm::StringRef> pieces;
+  size_t pieceSize = text.size() / workers.size() + 1;
+  while (!text.empty()) {
+    size_t split = text.find('\n', pieceSize);
+    split = (split == llvm::StringRef::npos) ? text.size() : split + 1;
+    pieces.push_back(text.substr(0, split));
+    text = text.substr(split);
+  }
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < pieces.size(); ++i) {
+    threads.emplace_back([&, i] { workers[i].run(pieces[i], options); });
+  }
+  if (!pieces.empty())
+    workers[0].run(pieces[0], options);
+  for (std::thread &thread : threads)
+    thread.join();
+
+  size_t numNames = 0;
+  for (size_t i = 0; i != pieces.size(); ++i)
+    numNames += workers[i].NumNames;
+  return numNames;
+}
+
+/// Copies standard input to standard output, replacing mangled names with
+/// their demanglings.
+///
+/// The input is read in large blocks, each of which is split among
+/// \c NumThreads threads; the output keeps the order of the input.
+static bool demangleSTDIN(const swift::Demangle::DemangleOptions &options) {
+  const size_t blockSizePerThread = 1 << 20;
+  std::vector<DemangleWorker> workers(std::max(1U, unsigned(NumThreads)));
+  std::vector<char> buffer;
+  size_t carried = 0;
+
+  while (true) {
+    // Read the next block after whatever was left over from the last one.
+    buffer.resize(carried + workers.size() * blockSizePerThread);
+    size_t read = std::fread(buffer.data() + carried, 1,
+                             buffer.size() - carried, stdin);
+    if (std::ferror(stdin)) {
+      llvm::errs() << "error reading standard input\n";
+      return false;
+    }
+    bool atEnd = read != buffer.size() - carried;
+    llvm::StringRef block(buffer.data(), carried + read);
+
+    // Hold back a trailing partial line, which may be cut off mid-name.
+    llvm::StringRef rest;
+    if (!atEnd) {
+      size_t lastNewline = block.rfind('\n');
+      if (lastNewline == llvm::StringRef::npos) {
+        carried = block.size();
+        continue;
+      }
+      rest = block.substr(lastNewline + 1);
+      block = block.substr(0, lastNewline + 1);
+    }
+
+    demangleBlock(block, workers, options);
+    for (const DemangleWorker &worker : workers)
+      llvm::outs() << worker.Output;
+    for (DemangleWorker &worker : workers)
+      worker.Output.clear();
+
+    if (atEnd)
+      return true;
+    std::memmove(buffer.data(), rest.data(), rest.size());
+    carried = rest.size();
+  }
 }
 
-static llvm::StringRef substrAfter(llvm::StringRef whole,
-                                   llvm::StringRef part) {
-  return whole.substr((part.data() - whole.data()) + part.size());
+/// Demangles \p names \c BenchmarkIterations times with one thread, and then
+/// again with \c NumThreads threads if that's more, and reports the
+/// throughput of each.
+static void benchmark(llvm::ArrayRef<llvm::StringRef> names,
+                      const swift::Demangle::DemangleOptions &options) {
+  std::string text;
+  for (llvm::StringRef name : names) {
+    text += name;
+    text += '\n';
+  }
+
+  auto run = [&](unsigned numThreads) {
+    size_t numNames = 0;
+    size_t totalLength = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i != BenchmarkIterations; ++i) {
+      // Start each iteration cold, so repeating the input doesn't just
+      // measure the cache.
+      std::vector<DemangleWorker> workers(numThreads);
+      numNames += demangleBlock(text, workers, options);
+      for (const DemangleWorker &worker : workers)
+        totalLength += worker.Output.size();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    llvm::outs() << "Demangled " << numNames << " symbols ("
+                 << totalLength << " characters) in "
+                 << llvm::format("%.3f", elapsed.count()) << " s: "
+                 << llvm::format("%.0f", numNames / elapsed.count())
+                 << " symbols/s with " << numThreads
+                 << (numThreads == 1 ? " thread\n" : " threads\n");
+  };
+
+  run(1);
+  if (NumThreads > 1)
+    run(NumThreads);
 }
 
 int main(int argc, char **argv) {
@@ -109,25 +293,37 @@ int main(int argc, char **argv) {
   if (Simplified)
     options = swift::Demangle::DemangleOptions::SimplifiedUIDemangleOptions();
 
-  if (InputNames.empty()) {
+  if (BenchmarkIterations) {
     CompactMode = true;
-    auto input = llvm::MemoryBuffer::getSTDIN();
-    if (!input) {
-      llvm::errs() << input.getError().message() << '\n';
-      return EXIT_FAILURE;
-    }
-    llvm::StringRef inputContents = input.get()->getBuffer();
-
-    // This doesn't handle Unicode symbols, but maybe that's okay.
-    llvm::Regex maybeSymbol("_T[_a-zA-Z0-9$]+");
-    llvm::SmallVector<llvm::StringRef, 1> matches;
-    while (maybeSymbol.match(inputContents, &matches)) {
-      llvm::outs() << substrBefore(inputContents, matches.front());
-      demangle(llvm::outs(), matches.front(), options);
-      inputContents = substrAfter(inputContents, matches.front());
+    std::vector<llvm::StringRef> names(InputNames.begin(), InputNames.end());
+    std::unique_ptr<llvm::MemoryBuffer> input;
+    if (names.empty()) {
+      auto inputOrError = llvm::MemoryBuffer::getSTDIN();
+      if (!inputOrError) {
+        llvm::errs() << inputOrError.getError().message() << '\n';
+        return EXIT_FAILURE;
+      }
+      input = std::move(inputOrError.get());
+
+      // Take the first word of each line, so that test inputs in the
+      // "mangled ---> demangled" format can be used as is.
+      llvm::SmallVector<llvm::StringRef, 0> lines;
+      input->getBuffer().split(lines, "\n", /*MaxSplit=*/-1,
+                               /*KeepEmpty=*/false);
+      for (llvm::StringRef line : lines) {
+        llvm::StringRef name = line.trim().split(' ').first;
+        if (!name.empty())
+          names.push_back(name);
+      }
     }
-    llvm::outs() << inputContents;
+    benchmark(names, options);
+    return EXIT_SUCCESS;
+  }
 
+  if (InputNames.empty()) {
+    CompactMode = true;
+    if (!demangleSTDIN(options))
+      return EXIT_FAILURE;
   } else {
     for (llvm::StringRef name : InputNames) {
       demangle(llvm::outs(), name, options);
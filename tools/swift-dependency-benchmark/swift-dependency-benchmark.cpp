@@ -0,0 +1,148 @@
+//===--- swift-dependency-benchmark.cpp - Dependency loading benchmark ----===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Compares how long the driver takes to load a whole module's dependency
+// graph from YAML and from binary dependency files, for synthetic modules of
+// several sizes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/DependencyFileFormat.h"
+#include "swift/Driver/DependencyGraph.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace swift;
+namespace format = swift::dependency_file;
+
+static llvm::cl::list<unsigned>
+FileCounts("files",
+           llvm::cl::desc("The numbers of files in the synthetic modules "
+                          "(default: 1000,5000,10000)"),
+           llvm::cl::CommaSeparated);
+
+static llvm::cl::opt<unsigned>
+Iterations("iterations",
+           llvm::cl::desc("Load each module this many times and report the "
+                          "fastest"),
+           llvm::cl::init(3));
+
+/// Generates the dependencies of file \p i in a synthetic module of \p count
+/// files, in which every file provides a type and a few top-level names and
+/// uses names from a handful of other files.
+static format::Writer makeSyntheticFile(unsigned i, unsigned count) {
+  format::Writer writer;
+  std::string type = "V4main4Type" + std::to_string(i);
+
+  writer.beginSection(format::Section::ProvidesTopLevel);
+  for (unsigned j = 0; j != 10; ++j)
+    writer.addName("name" + std::to_string(i) + "_" + std::to_string(j));
+  writer.beginSection(format::Section::ProvidesNominal);
+  writer.addName(type);
+  writer.beginSection(format::Section::ProvidesMember);
+  writer.addMember(type, "");
+  for (unsigned j = 0; j != 10; ++j)
+    writer.addMember(type, "member" + std::to_string(j));
+
+  writer.beginSection(format::Section::DependsTopLevel);
+  for (unsigned j = 1; j != 20; ++j) {
+    unsigned other = (i * 7 + j * 13) % count;
+    writer.addName("name" + std::to_string(other) + "_" +
+                     std::to_string(j % 10),
+                   j % 3 != 0);
+  }
+  writer.beginSection(format::Section::DependsMember);
+  for (unsigned j = 1; j != 20; ++j) {
+    unsigned other = (i * 11 + j * 17) % count;
+    writer.addMember("V4main4Type" + std::to_string(other),
+                     "member" + std::to_string(j % 10), j % 3 != 0);
+  }
+  writer.beginSection(format::Section::DependsNominal);
+  for (unsigned j = 1; j != 20; ++j)
+    writer.addName("V4main4Type" + std::to_string((i * 11 + j * 17) % count));
+  writer.beginSection(format::Section::DependsExternal);
+  writer.addName("/usr/lib/swift/Swift.swiftmodule");
+
+  writer.setInterfaceHash("hash" + std::to_string(i));
+  return writer;
+}
+
+/// Loads \p files into a new graph \c Iterations times, and returns the
+/// fastest time in milliseconds, or a negative value if a file failed to
+/// load.
+static double timeLoad(const std::vector<std::string> &files) {
+  double best = 0;
+  for (unsigned iteration = 0; iteration != Iterations; ++iteration) {
+    auto start = std::chrono::steady_clock::now();
+    DependencyGraph<uintptr_t> graph;
+    for (uintptr_t i = 0, e = files.size(); i != e; ++i)
+      if (graph.loadFromString(i, files[i]) ==
+            DependencyGraphImpl::LoadResult::HadError)
+        return -1;
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (iteration == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv);
+
+  std::vector<unsigned> counts(FileCounts.begin(), FileCounts.end());
+  if (counts.empty())
+    counts = { 1000, 5000, 10000 };
+  if (Iterations == 0)
+    Iterations = 1;
+
+  for (unsigned count : counts) {
+    std::vector<std::string> yamlFiles, binaryFiles;
+    size_t yamlSize = 0, binarySize = 0;
+    for (unsigned i = 0; i != count; ++i) {
+      format::Writer writer = makeSyntheticFile(i, count);
+      {
+        std::string yaml;
+        llvm::raw_string_ostream out(yaml);
+        writer.writeYAML(out);
+        yamlFiles.push_back(std::move(out.str()));
+      }
+      {
+        std::string binary;
+        llvm::raw_string_ostream out(binary);
+        writer.writeBinary(out);
+        binaryFiles.push_back(std::move(out.str()));
+      }
+      yamlSize += yamlFiles.back().size();
+      binarySize += binaryFiles.back().size();
+    }
+
+    double yamlTime = timeLoad(yamlFiles);
+    double binaryTime = timeLoad(binaryFiles);
+    if (yamlTime < 0 || binaryTime < 0) {
+      llvm::errs() << "error: a synthetic dependency file failed to load\n";
+      return EXIT_FAILURE;
+    }
+
+    llvm::outs() << count << " files: YAML " << yamlSize << " bytes, "
+                 << llvm::format("%.1f", yamlTime) << " ms; binary "
+                 << binarySize << " bytes, "
+                 << llvm::format("%.1f", binaryTime) << " ms\n";
+  }
+  return EXIT_SUCCESS;
+}
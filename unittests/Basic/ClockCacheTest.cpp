@@ -0,0 +1,91 @@
+//===--- ClockCacheTest.cpp -----------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/ClockCache.h"
+#include "gtest/gtest.h"
+
+using namespace swift;
+
+TEST(ClockCache, LookupAndInsert) {
+  ClockCache<int, int> Cache(4);
+  EXPECT_EQ(nullptr, Cache.lookup(1));
+  Cache.insert(1, 10);
+  Cache.insert(2, 20);
+  ASSERT_NE(nullptr, Cache.lookup(1));
+  EXPECT_EQ(10, *Cache.lookup(1));
+  EXPECT_EQ(20, *Cache.lookup(2));
+
+  Cache.insert(1, 11);
+  EXPECT_EQ(11, *Cache.lookup(1));
+  EXPECT_EQ(2u, Cache.size());
+
+  EXPECT_EQ(4u, Cache.getNumHits());
+  EXPECT_EQ(1u, Cache.getNumMisses());
+  EXPECT_EQ(0u, Cache.getNumEvictions());
+}
+
+TEST(ClockCache, SizeIsBounded) {
+  ClockCache<int, int> Cache(8);
+  for (int i = 0; i < 100; ++i)
+    Cache.insert(i, i);
+  EXPECT_EQ(8u, Cache.size());
+  EXPECT_EQ(92u, Cache.getNumEvictions());
+  // The most recent insertion is always kept.
+  ASSERT_NE(nullptr, Cache.lookup(99));
+  EXPECT_EQ(99, *Cache.lookup(99));
+}
+
+TEST(ClockCache, ReferencedEntriesSurvive) {
+  ClockCache<int, int> Cache(4);
+  for (int i = 0; i < 4; ++i)
+    Cache.insert(i, i);
+
+  // Keep using entry 0 while streaming other entries through the cache.
+  for (int i = 4; i < 20; ++i) {
+    ASSERT_NE(nullptr, Cache.lookup(0));
+    Cache.insert(i, i);
+  }
+  EXPECT_NE(nullptr, Cache.lookup(0));
+  EXPECT_EQ(nullptr, Cache.lookup(4));
+}
+
+TEST(ClockCache, RemoveIf) {
+  ClockCache<int, int> Cache(16);
+  for (int i = 0; i < 10; ++i)
+    Cache.insert(i, i % 3);
+
+  Cache.remove_if([](int Key, int Value) { return Value == 0; });
+  EXPECT_EQ(6u, Cache.size());
+  for (int i = 0; i < 10; ++i) {
+    if (i % 3 == 0)
+      EXPECT_EQ(nullptr, Cache.lookup(i));
+    else
+      EXPECT_EQ(i % 3, *Cache.lookup(i));
+  }
+
+  // The cache can be filled up again after removing entries.
+  for (int i = 10; i < 40; ++i)
+    Cache.insert(i, i);
+  EXPECT_EQ(16u, Cache.size());
+  EXPECT_EQ(39, *Cache.lookup(39));
+}
+
+TEST(ClockCache, Clear) {
+  ClockCache<int, int> Cache(4);
+  Cache.insert(1, 1);
+  Cache.insert(2, 2);
+  Cache.clear();
+  EXPECT_TRUE(Cache.empty());
+  EXPECT_EQ(nullptr, Cache.lookup(1));
+  Cache.insert(3, 3);
+  EXPECT_EQ(3, *Cache.lookup(3));
+}
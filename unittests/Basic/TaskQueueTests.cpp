@@ -0,0 +1,50 @@
+//===--- TaskQueueTests.cpp - for swift/Basic/TaskQueue.h -----------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/TaskQueue.h"
+#include "gtest/gtest.h"
+
+using namespace swift;
+using namespace swift::sys;
+
+TEST(TaskPriorityQueue, Order) {
+  TaskPriorityQueue<int> queue;
+  EXPECT_TRUE(queue.empty());
+
+  queue.push(llvm::make_unique<int>(1), 0);
+  queue.push(llvm::make_unique<int>(2), 10);
+  queue.push(llvm::make_unique<int>(3), 0);
+  queue.push(llvm::make_unique<int>(4), 10);
+  queue.push(llvm::make_unique<int>(5), 5);
+
+  // Highest priority first; ties in the order they were pushed.
+  std::vector<int> order;
+  while (!queue.empty())
+    order.push_back(*queue.pop());
+  EXPECT_EQ((std::vector<int>{2, 4, 5, 1, 3}), order);
+}
+
+TEST(TaskQueue, DummyPriorities) {
+  DummyTaskQueue queue(/*NumberOfParallelTasks=*/1);
+  int contexts[4];
+  queue.addTask("a", {}, llvm::None, &contexts[0]);
+  queue.addTask("b", {}, llvm::None, &contexts[1], /*Priority=*/3);
+  queue.addTask("c", {}, llvm::None, &contexts[2], /*Priority=*/1);
+  queue.addTask("d", {}, llvm::None, &contexts[3], /*Priority=*/3);
+
+  std::vector<void *> began;
+  queue.execute([&](ProcessId, void *context) { began.push_back(context); });
+  EXPECT_EQ((std::vector<void *>{&contexts[1], &contexts[3], &contexts[2],
+                                 &contexts[0]}),
+            began);
+  EXPECT_FALSE(queue.hasRemainingTasks());
+}
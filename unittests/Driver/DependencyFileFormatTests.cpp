@@ -0,0 +1,192 @@
+#include "swift/Driver/DependencyFileFormat.h"
+#include "swift/Driver/DependencyGraph.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace swift;
+using LoadResult = DependencyGraphImpl::LoadResult;
+namespace format = swift::dependency_file;
+
+static std::string writeYAML(const format::Writer &writer) {
+  std::string result;
+  llvm::raw_string_ostream out(result);
+  writer.writeYAML(out);
+  return out.str();
+}
+
+static std::string writeBinary(const format::Writer &writer) {
+  std::string result;
+  llvm::raw_string_ostream out(result);
+  writer.writeBinary(out);
+  return out.str();
+}
+
+TEST(DependencyFileFormat, YAMLOutput) {
+  format::Writer writer;
+  writer.beginSection(format::Section::ProvidesTopLevel);
+  writer.addName("a");
+  writer.addName("+");
+  writer.beginSection(format::Section::ProvidesMember);
+  writer.addMember("V4main1S", "");
+  writer.beginSection(format::Section::DependsTopLevel);
+  writer.addName("b", /*isCascading=*/false);
+  writer.beginSection(format::Section::DependsMember);
+  writer.addMember("V4main1S", "foo", /*isCascading=*/false);
+  writer.beginSection(format::Section::DependsExternal);
+  writer.setInterfaceHash("abc");
+
+  EXPECT_EQ("### Swift dependencies file v0 ###\n"
+            "provides-top-level:\n"
+            "- \"a\"\n"
+            "- \"+\"\n"
+            "provides-member:\n"
+            "- [\"V4main1S\", \"\"]\n"
+            "depends-top-level:\n"
+            "- !private \"b\"\n"
+            "depends-member:\n"
+            "- !private [\"V4main1S\", \"foo\"]\n"
+            "depends-external:\n"
+            "interface-hash: \"abc\"\n",
+            writeYAML(writer));
+}
+
+TEST(DependencyFileFormat, BinaryMagic) {
+  format::Writer writer;
+  EXPECT_TRUE(format::isBinaryDependencyFile(writeBinary(writer)));
+  EXPECT_FALSE(format::isBinaryDependencyFile(writeYAML(writer)));
+  EXPECT_FALSE(format::isBinaryDependencyFile(""));
+}
+
+/// Builds the same small graph from either encoding and checks that marking
+/// behaves identically.
+static void checkChainedGraph(bool binary) {
+  auto load = [binary](DependencyGraph<uintptr_t> &graph, uintptr_t node,
+                       const format::Writer &writer) {
+    return graph.loadFromString(node, binary ? writeBinary(writer)
+                                             : writeYAML(writer));
+  };
+
+  format::Writer a;
+  a.beginSection(format::Section::ProvidesNominal);
+  a.addName("V4main1A");
+  a.beginSection(format::Section::ProvidesMember);
+  a.addMember("V4main1A", "");
+  a.addMember("V4main1A", "foo");
+  a.setInterfaceHash("a");
+
+  format::Writer b;
+  b.beginSection(format::Section::ProvidesTopLevel);
+  b.addName("b");
+  b.beginSection(format::Section::DependsMember);
+  b.addMember("V4main1A", "foo");
+  b.setInterfaceHash("b");
+
+  format::Writer c;
+  c.beginSection(format::Section::DependsTopLevel);
+  c.addName("b", /*isCascading=*/false);
+  c.beginSection(format::Section::DependsExternal);
+  c.addName("/foo");
+  c.setInterfaceHash("c");
+
+  DependencyGraph<uintptr_t> graph;
+  EXPECT_EQ(LoadResult::UpToDate, load(graph, 0, a));
+  EXPECT_EQ(LoadResult::UpToDate, load(graph, 1, b));
+  EXPECT_EQ(LoadResult::UpToDate, load(graph, 2, c));
+
+  EXPECT_EQ(1, std::distance(graph.getExternalDependencies().begin(),
+                             graph.getExternalDependencies().end()));
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(2u, marked.size());
+  EXPECT_TRUE(graph.isMarked(0));
+  EXPECT_TRUE(graph.isMarked(1));
+  EXPECT_FALSE(graph.isMarked(2));
+
+  // A changed interface hash is reported as affecting downstream nodes.
+  a.setInterfaceHash("a2");
+  EXPECT_EQ(LoadResult::AffectsDownstream, load(graph, 0, a));
+}
+
+TEST(DependencyFileFormat, YAMLGraph) {
+  checkChainedGraph(/*binary=*/false);
+}
+
+TEST(DependencyFileFormat, BinaryGraph) {
+  checkChainedGraph(/*binary=*/true);
+}
+
+TEST(DependencyFileFormat, MalformedBinary) {
+  format::Writer writer;
+  writer.beginSection(format::Section::DependsTopLevel);
+  writer.addName("a");
+  writer.addName("b");
+  writer.setInterfaceHash("hash");
+  std::string valid = writeBinary(writer);
+
+  {
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_EQ(LoadResult::UpToDate, graph.loadFromString(0, valid));
+  }
+
+  // Truncated in the header, and in the string data.
+  for (size_t length : { size_t(6), valid.size() - 1 }) {
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_EQ(LoadResult::HadError,
+              graph.loadFromString(0, valid.substr(0, length)));
+  }
+
+  // Wrong version.
+  {
+    std::string data = valid;
+    data[4] = 99;
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_EQ(LoadResult::HadError, graph.loadFromString(0, data));
+  }
+
+  // Out-of-range string index in the first entry.
+  {
+    std::string data = valid;
+    size_t firstEntry = 4 + 4 * (format::HeaderWords + 3 +
+                                 format::SectionWords);
+    data[firstEntry] = 42;
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_EQ(LoadResult::HadError, graph.loadFromString(0, data));
+  }
+}
+
+static std::string encodeAsBinary(StringRef data, bool &ok) {
+  auto buffer = llvm::MemoryBuffer::getMemBuffer(data);
+  std::string result;
+  llvm::raw_string_ostream out(result);
+  ok = DependencyGraphImpl::encodeAsBinary(*buffer, out);
+  return out.str();
+}
+
+TEST(DependencyFileFormat, EncodeAsBinary) {
+  format::Writer writer;
+  writer.beginSection(format::Section::ProvidesTopLevel);
+  writer.addName("a");
+  writer.addName("+");
+  writer.beginSection(format::Section::ProvidesMember);
+  writer.addMember("V4main1S", "");
+  writer.beginSection(format::Section::DependsTopLevel);
+  writer.addName("b", /*isCascading=*/false);
+  writer.beginSection(format::Section::DependsMember);
+  writer.addMember("V4main1S", "foo", /*isCascading=*/false);
+  writer.setInterfaceHash("abc");
+  std::string binary = writeBinary(writer);
+
+  bool ok;
+  EXPECT_EQ(binary, encodeAsBinary(writeYAML(writer), ok));
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(binary, encodeAsBinary(binary, ok));
+  EXPECT_TRUE(ok);
+
+  encodeAsBinary("provides-top-level: [a]\nbogus-key: [b]\n", ok);
+  EXPECT_FALSE(ok);
+  encodeAsBinary(binary.substr(0, binary.size() - 1), ok);
+  EXPECT_FALSE(ok);
+}
@@ -0,0 +1,186 @@
+#include "swift/Driver/DependencyGraphCache.h"
+#include "swift/Driver/DependencyGraph.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace swift;
+using llvm::sys::TimeValue;
+
+namespace {
+
+/// A scratch directory holding one dependencies file and one cache file.
+class DependencyGraphCacheTest : public ::testing::Test {
+protected:
+  SmallString<128> Dir;
+  SmallString<128> DepsPath;
+  SmallString<128> CachePath;
+
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory(
+        "DependencyGraphCacheTests", Dir));
+    DepsPath = Dir;
+    llvm::sys::path::append(DepsPath, "main.swiftdeps");
+    CachePath = Dir;
+    llvm::sys::path::append(CachePath, "main~buildrecord.swiftdeps.graph");
+  }
+
+  void TearDown() override {
+    llvm::sys::fs::remove(DepsPath);
+    llvm::sys::fs::remove(CachePath);
+    llvm::sys::fs::remove(Dir);
+  }
+
+  void writeDeps(StringRef contents) {
+    std::error_code error;
+    llvm::raw_fd_ostream out(DepsPath, error, llvm::sys::fs::F_None);
+    ASSERT_FALSE(error);
+    out << contents;
+  }
+
+  /// Returns the binary encoding of the dependencies file.
+  std::string encodeDeps() {
+    auto buffer = llvm::MemoryBuffer::getFile(DepsPath);
+    EXPECT_TRUE(bool(buffer));
+    if (!buffer)
+      return std::string();
+    std::string result;
+    llvm::raw_string_ostream out(result);
+    EXPECT_TRUE(DependencyGraphImpl::encodeAsBinary(**buffer, out));
+    return out.str();
+  }
+
+  /// Reads the dependencies file into \p cache, as the driver does.
+  void readDepsInto(DependencyGraphCache &cache) {
+    llvm::sys::fs::file_status status;
+    ASSERT_FALSE(llvm::sys::fs::status(DepsPath, status));
+    cache.update(DepsPath, status,
+                 llvm::MemoryBuffer::getMemBufferCopy(encodeDeps()));
+  }
+
+  /// A build time safely after the dependencies file was written.
+  static TimeValue later() {
+    return TimeValue::now() + TimeValue(60, 0);
+  }
+};
+
+} // end anonymous namespace
+
+TEST_F(DependencyGraphCacheTest, RoundTrip) {
+  writeDeps("provides-top-level: [a]\n");
+  {
+    DependencyGraphCache cache;
+    readDepsInto(cache);
+    cache.writeToPath(CachePath, later());
+  }
+
+  std::string encoded = encodeDeps();
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromPath(CachePath));
+  auto cached = cache.lookup(DepsPath);
+  ASSERT_TRUE(bool(cached));
+  EXPECT_EQ(encoded, cached->getBuffer());
+
+  // Rewriting the cache while it is loaded must not disturb the entries.
+  llvm::sys::fs::file_status status;
+  ASSERT_FALSE(llvm::sys::fs::status(DepsPath, status));
+  SmallString<128> otherPath = Dir;
+  llvm::sys::path::append(otherPath, "other.swiftdeps");
+  cache.update(otherPath, status,
+               llvm::MemoryBuffer::getMemBufferCopy(encoded));
+  ASSERT_TRUE(cache.isOutOfDate());
+  cache.writeToPath(CachePath, later());
+  cached = cache.lookup(DepsPath);
+  ASSERT_TRUE(bool(cached));
+  EXPECT_EQ(encoded, cached->getBuffer());
+}
+
+TEST_F(DependencyGraphCacheTest, UnchangedCacheIsNotWritten) {
+  writeDeps("provides-top-level: [a]\n");
+  {
+    DependencyGraphCache cache;
+    readDepsInto(cache);
+    EXPECT_TRUE(cache.isOutOfDate());
+    cache.writeToPath(CachePath, later());
+  }
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromPath(CachePath));
+  ASSERT_TRUE(bool(cache.lookup(DepsPath)));
+  EXPECT_FALSE(cache.isOutOfDate());
+
+  // Reading the same contents again doesn't change the cache either.
+  readDepsInto(cache);
+  EXPECT_FALSE(cache.isOutOfDate());
+
+  ASSERT_FALSE(llvm::sys::fs::remove(CachePath));
+  cache.writeToPath(CachePath, later());
+  EXPECT_FALSE(llvm::sys::fs::exists(CachePath));
+}
+
+TEST_F(DependencyGraphCacheTest, UnusedEntriesArePruned) {
+  writeDeps("provides-top-level: [a]\n");
+  {
+    DependencyGraphCache cache;
+    readDepsInto(cache);
+    cache.writeToPath(CachePath, later());
+  }
+
+  // A build without this input doesn't look it up.
+  {
+    DependencyGraphCache cache;
+    ASSERT_TRUE(cache.loadFromPath(CachePath));
+    EXPECT_TRUE(cache.isOutOfDate());
+    cache.writeToPath(CachePath, later());
+  }
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromPath(CachePath));
+  EXPECT_FALSE(bool(cache.lookup(DepsPath)));
+}
+
+TEST_F(DependencyGraphCacheTest, ChangedFile) {
+  writeDeps("provides-top-level: [a]\n");
+  {
+    DependencyGraphCache cache;
+    readDepsInto(cache);
+    cache.writeToPath(CachePath, later());
+  }
+
+  writeDeps("provides-top-level: [a, b]\n");
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromPath(CachePath));
+  EXPECT_FALSE(bool(cache.lookup(DepsPath)));
+}
+
+TEST_F(DependencyGraphCacheTest, ModifiedDuringBuild) {
+  writeDeps("provides-top-level: [a]\n");
+  {
+    DependencyGraphCache cache;
+    readDepsInto(cache);
+    // The file is newer than the start of the build that read it.
+    cache.writeToPath(CachePath, TimeValue::MinTime());
+  }
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromPath(CachePath));
+  EXPECT_FALSE(bool(cache.lookup(DepsPath)));
+}
+
+TEST_F(DependencyGraphCacheTest, Malformed) {
+  DependencyGraphCache cache;
+  EXPECT_FALSE(cache.loadFromPath(CachePath));
+
+  {
+    std::error_code error;
+    llvm::raw_fd_ostream out(CachePath, error, llvm::sys::fs::F_None);
+    ASSERT_FALSE(error);
+    out << "provides-top-level: [a]\n";
+  }
+  EXPECT_FALSE(cache.loadFromPath(CachePath));
+  EXPECT_FALSE(bool(cache.lookup(DepsPath)));
+}
@@ -0,0 +1,201 @@
+//===--- CachingMemoryReaderTest.cpp - for swift/Remote -------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Remote/CMemoryReader.h"
+#include "swift/Remote/CachingMemoryReader.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+using namespace swift;
+using namespace swift::remote;
+
+// A stand-in for a remote process: four pages of local memory, of which only
+// the first three can be read, and a count of the requests made.
+static const uint64_t PageSize = CachingMemoryReader::PageSize;
+alignas(4096) static uint8_t Memory[4 * 4096];
+static unsigned NumReads;
+
+static uint8_t getPointerSize() { return sizeof(uintptr_t); }
+static uint8_t getSizeSize() { return sizeof(size_t); }
+
+static bool isReadable(addr_t address, uint64_t size) {
+  auto begin = reinterpret_cast<uintptr_t>(Memory);
+  return address >= begin && address + size <= begin + 3 * PageSize;
+}
+
+static bool readBytes(addr_t address, uint8_t *dest, uint64_t size) {
+  ++NumReads;
+  if (!isReadable(address, size))
+    return false;
+  std::memcpy(dest, reinterpret_cast<const void *>(address), size);
+  return true;
+}
+
+static uint64_t getStringLength(addr_t address) {
+  ++NumReads;
+  if (!isReadable(address, 1))
+    return 0;
+  return std::strlen(reinterpret_cast<const char *>(address));
+}
+
+static addr_t getSymbolAddress(const char *, uint64_t) { return 0; }
+
+static std::shared_ptr<MemoryReader> makeCountingReader() {
+  NumReads = 0;
+  for (size_t i = 0; i != sizeof(Memory); ++i)
+    Memory[i] = uint8_t(i * 7 + 1);
+  return std::make_shared<CMemoryReader>(MemoryReaderImpl{
+    getPointerSize, getSizeSize, readBytes, getStringLength, getSymbolAddress
+  });
+}
+
+static RemoteAddress at(uint64_t offset) {
+  return RemoteAddress(&Memory[offset]);
+}
+
+TEST(CachingMemoryReader, SmallReadsShareAPage) {
+  // Without the cache, every read is a request.
+  auto Counting = makeCountingReader();
+  uint32_t Value;
+  for (uint64_t offset = 0; offset < 2 * PageSize; offset += 64)
+    ASSERT_TRUE(Counting->readInteger(at(offset), &Value));
+  EXPECT_EQ(128u, NumReads);
+
+  CachingMemoryReader Reader(makeCountingReader());
+  for (uint64_t offset = 0; offset < 2 * PageSize; offset += 64) {
+    ASSERT_TRUE(Reader.readInteger(at(offset), &Value));
+    uint32_t Expected;
+    std::memcpy(&Expected, &Memory[offset], sizeof(Expected));
+    EXPECT_EQ(Expected, Value);
+  }
+  EXPECT_EQ(2u, NumReads);
+}
+
+TEST(CachingMemoryReader, PrefetchBatchesPages) {
+  CachingMemoryReader Reader(makeCountingReader());
+  Reader.prefetch(at(100), 2 * PageSize);
+  EXPECT_EQ(1u, NumReads);
+
+  // A read spanning all three prefetched pages needs no more requests.
+  uint8_t Buffer[2 * 4096];
+  ASSERT_TRUE(Reader.readBytes(at(100), Buffer, sizeof(Buffer)));
+  EXPECT_EQ(0, std::memcmp(Buffer, &Memory[100], sizeof(Buffer)));
+  EXPECT_EQ(1u, NumReads);
+}
+
+TEST(CachingMemoryReader, UnreadablePages) {
+  CachingMemoryReader Reader(makeCountingReader());
+
+  // The batch fails because the last page can't be read, so each page is
+  // tried on its own, and the readable ones are still cached.
+  Reader.prefetch(at(2 * PageSize), 2 * PageSize);
+  EXPECT_EQ(3u, NumReads);
+
+  uint64_t Value;
+  EXPECT_TRUE(Reader.readInteger(at(2 * PageSize + 8), &Value));
+  EXPECT_EQ(3u, NumReads);
+  EXPECT_FALSE(Reader.readInteger(at(3 * PageSize + 8), &Value));
+  EXPECT_FALSE(Reader.readInteger(at(3 * PageSize - 4), &Value));
+}
+
+TEST(CachingMemoryReader, PrefetchIsBounded) {
+  // A size read from corrupt metadata only prefetches a few pages.
+  CachingMemoryReader Reader(makeCountingReader());
+  Reader.prefetch(at(0), UINT64_MAX / 2);
+  EXPECT_EQ(1u + CachingMemoryReader::MaxPrefetchPages, NumReads);
+
+  uint64_t Value;
+  EXPECT_TRUE(Reader.readInteger(at(2 * PageSize), &Value));
+  EXPECT_EQ(1u + CachingMemoryReader::MaxPrefetchPages, NumReads);
+}
+
+TEST(CachingMemoryReader, LargeReadsBypassCache) {
+  CachingMemoryReader Reader(makeCountingReader());
+  uint64_t Size = (CachingMemoryReader::MaxCachedReadPages + 1) * PageSize;
+  std::unique_ptr<uint8_t[]> Buffer(new uint8_t[Size]);
+  EXPECT_FALSE(Reader.readBytes(at(0), Buffer.get(), Size));
+  EXPECT_EQ(1u, NumReads);
+
+  // Nothing was cached by it.
+  uint64_t Value;
+  EXPECT_TRUE(Reader.readInteger(at(0), &Value));
+  EXPECT_EQ(2u, NumReads);
+}
+
+// Reads zeroes from any address.
+static bool readAnyBytes(addr_t address, uint8_t *dest, uint64_t size) {
+  ++NumReads;
+  std::memset(dest, 0, size);
+  return true;
+}
+
+TEST(CachingMemoryReader, CacheIsBounded) {
+  NumReads = 0;
+  CachingMemoryReader Reader(std::make_shared<CMemoryReader>(MemoryReaderImpl{
+    getPointerSize, getSizeSize, readAnyBytes, getStringLength,
+    getSymbolAddress
+  }));
+
+  uint64_t Value;
+  uint64_t NumPages = CachingMemoryReader::MaxCachedPages;
+  for (uint64_t i = 0; i != NumPages; ++i)
+    ASSERT_TRUE(Reader.readInteger(RemoteAddress(i * PageSize), &Value));
+  ASSERT_TRUE(Reader.readInteger(RemoteAddress(uint64_t(0)), &Value));
+  EXPECT_EQ(NumPages, NumReads);
+
+  // Reading one more page empties the cache.
+  ASSERT_TRUE(Reader.readInteger(RemoteAddress(NumPages * PageSize), &Value));
+  ASSERT_TRUE(Reader.readInteger(RemoteAddress(uint64_t(0)), &Value));
+  EXPECT_EQ(NumPages + 2, NumReads);
+}
+
+TEST(CachingMemoryReader, RangesThatWrapAround) {
+  CachingMemoryReader Reader(makeCountingReader());
+  uint8_t Buffer[16];
+  EXPECT_FALSE(Reader.readBytes(RemoteAddress(UINT64_MAX - 8), Buffer,
+                                sizeof(Buffer)));
+  Reader.prefetch(RemoteAddress(UINT64_MAX - 8), sizeof(Buffer));
+  Reader.prefetch(at(0), UINT64_MAX);
+  EXPECT_EQ(0u, NumReads);
+}
+
+TEST(CachingMemoryReader, Strings) {
+  CachingMemoryReader Reader(makeCountingReader());
+  const char Name[] = "_TtV4main5Point";
+  std::memcpy(&Memory[PageSize - 4], Name, sizeof(Name));
+  std::memcpy(&Memory[PageSize + 32], Name, sizeof(Name));
+
+  // The first string crosses into the second page, where the other is.
+  std::string Result;
+  ASSERT_TRUE(Reader.readString(at(PageSize - 4), Result));
+  EXPECT_EQ(Name, Result);
+  ASSERT_TRUE(Reader.readString(at(PageSize + 32), Result));
+  EXPECT_EQ(Name, Result);
+  EXPECT_EQ(2u, NumReads);
+}
+
+TEST(CachingMemoryReader, ClearCache) {
+  CachingMemoryReader Reader(makeCountingReader());
+  uint8_t Value;
+  ASSERT_TRUE(Reader.readInteger(at(0), &Value));
+  Memory[0] = Value + 1;
+  ASSERT_TRUE(Reader.readInteger(at(0), &Value));
+  EXPECT_EQ(Memory[0] - 1, Value);
+
+  Reader.clearCache();
+  ASSERT_TRUE(Reader.readInteger(at(0), &Value));
+  EXPECT_EQ(Memory[0], Value);
+  EXPECT_EQ(2u, NumReads);
+}
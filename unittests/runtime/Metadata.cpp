@@ -13,6 +13,7 @@
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Concurrent.h"
 #include "gtest/gtest.h"
+#include <atomic>
 #include <iterator>
 #include <functional>
 #include <sys/mman.h>
@@ -225,6 +226,7 @@ TEST(Concurrent, ConcurrentMap) {
     int compareWithKey(size_t key) const {
       return (key == Key ? 0 : (key < Key ? -1 : 1));
     }
+    static size_t getKeyHash(size_t key) { return key; }
     static size_t getExtraAllocationSize(size_t key) { return 0; }
   };
 
@@ -249,6 +251,48 @@ TEST(Concurrent, ConcurrentMap) {
 }
 
 
+// Look up keys from many threads at once, in maps of increasing size. Keys
+// are inserted in increasing order, which is the worst case for an ordered
+// tree. The lookup cost is measured by the GenericMetadataLookup benchmarks.
+TEST(Concurrent, ConcurrentMapConcurrentLookup) {
+  struct Entry {
+    size_t Key;
+    Entry(size_t key) : Key(key) {}
+    long getKeyIntValueForDump() const { return Key; }
+    int compareWithKey(size_t key) const {
+      return (key == Key ? 0 : (key < Key ? -1 : 1));
+    }
+    static size_t getKeyHash(size_t key) { return key; }
+    static size_t getExtraAllocationSize(size_t key) { return 0; }
+  };
+
+  const size_t numLookupsPerThread = 100000;
+
+  for (size_t numElem = 1024; numElem <= 65536; numElem *= 4) {
+    ConcurrentMap<Entry> Map;
+    for (size_t i = 0; i < numElem; i++)
+      Map.getOrInsert(i * 16);
+    EXPECT_EQ(numElem, Map.size());
+
+    std::atomic<size_t> misses(0);
+    RaceTest<int*, 16>(
+      [&]() -> int* {
+        size_t i = 0;
+        for (size_t n = 0; n < numLookupsPerThread; n++) {
+          // Stride through the keys so consecutive lookups do not hit the
+          // same node.
+          i = (i + 7919) % numElem;
+          if (!Map.find(i * 16))
+            misses.fetch_add(1, std::memory_order_relaxed);
+        }
+        return nullptr;
+      }
+    );
+
+    EXPECT_EQ(0u, misses.load());
+  }
+}
+
 TEST(MetadataTest, getGenericMetadata) {
   auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
 
@@ -289,6 +333,58 @@ TEST(MetadataTest, getGenericMetadata) {
     });
 }
 
+TEST(MetadataTest, getGenericMetadata_ManyInstantiations) {
+  auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
+
+  // Every thread instantiates the same set of distinct types, each starting
+  // at a different point so that threads race on (and wait for) entries
+  // that other threads are in the middle of building.
+  const unsigned numTypes = 4096;
+  static char typeArgs[numTypes];
+  static std::atomic<const Metadata *> instances[numTypes];
+  std::atomic<unsigned> nextStart(0);
+
+  RaceTest<void *, 32>([&]() -> void * {
+    unsigned start = nextStart.fetch_add(numTypes / 32);
+    for (unsigned n = 0; n < numTypes; ++n) {
+      unsigned i = (start + n) % numTypes;
+      void *args[] = { &typeArgs[i] };
+      auto inst = swift_getGenericMetadata(metadataTemplate, args);
+
+      auto fields = reinterpret_cast<void * const *>(inst);
+      EXPECT_EQ(MetadataKind::Struct, inst->getKind());
+      EXPECT_EQ(&typeArgs[i], fields[2]);
+
+      const Metadata *expected = nullptr;
+      if (!instances[i].compare_exchange_strong(expected, inst))
+        EXPECT_EQ(expected, inst);
+    }
+    return nullptr;
+  });
+}
+
+TEST(MetadataTest, getMetadataAllocationStats) {
+  auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
+
+  MetadataAllocationStats before;
+  ASSERT_TRUE(swift_getMetadataAllocationStats(
+      MetadataAllocationKind::GenericValue, &before));
+
+  static char typeArg;
+  void *args[] = { &typeArg };
+  swift_getGenericMetadata(metadataTemplate, args);
+
+  MetadataAllocationStats after;
+  ASSERT_TRUE(swift_getMetadataAllocationStats(
+      MetadataAllocationKind::GenericValue, &after));
+  EXPECT_LT(before.NumAllocations, after.NumAllocations);
+  EXPECT_LE(before.BytesAllocated + MetadataTest1.Header.MetadataSize,
+            after.BytesAllocated);
+
+  EXPECT_FALSE(swift_getMetadataAllocationStats(
+      MetadataAllocationKind::NumKinds, &after));
+}
+
 FullMetadata<ClassMetadata> MetadataTest2 = {
   { { nullptr }, { &_TWVBo } },
   { { { MetadataKind::Class } }, nullptr, 0, ClassFlags(), nullptr, 0, 0, 0, 0, 0 }
@@ -980,3 +1076,230 @@ TEST(WitnessTableTest, getGenericWitnessTable) {
       });
   }
 }
+
+extern "C" const Metadata *
+swift_getTypeByMangledName(const char *typeName, size_t typeNameLength);
+
+// Look up thousands of types by mangled name, each for the first time, so
+// that none of the lookups are answered by the per-name result cache.
+// Records are registered in two batches to check that sections registered
+// after the first lookup are still found.
+TEST(MetadataTest, getTypeByMangledName_ManyTypes) {
+  const unsigned numTypes = 16384;
+
+  struct TestType {
+    char Name[32];
+    // Stands in for a NominalTypeDescriptor, of which only the name is read.
+    int32_t DescriptorName;
+    alignas(StructMetadata) char MetadataStorage[sizeof(StructMetadata)];
+  };
+
+  struct TestTypeMetadataRecord {
+    int32_t DirectType;
+    uint32_t Flags;
+  };
+  static_assert(sizeof(TestTypeMetadataRecord) == sizeof(TypeMetadataRecord),
+                "test record layout does not match TypeMetadataRecord");
+
+  // Everything lives in one allocation so that the relative references stay
+  // in range. The runtime keeps pointers to registered records, so this is
+  // never freed.
+  struct TestTypes {
+    TestType Types[numTypes];
+    TestTypeMetadataRecord Records[numTypes];
+  };
+  auto storage = new TestTypes();
+
+  auto flags = TypeMetadataRecordFlags()
+    .withTypeKind(TypeMetadataRecordKind::UniqueDirectType);
+
+  std::vector<const Metadata *> metadata;
+  for (unsigned i = 0; i < numTypes; i++) {
+    auto &type = storage->Types[i];
+    snprintf(type.Name, sizeof(type.Name), "ManyTypesTest%u", i);
+    initializeRelativePointer(&type.DescriptorName, type.Name);
+
+    auto descriptor =
+      reinterpret_cast<const NominalTypeDescriptor *>(&type.DescriptorName);
+    metadata.push_back(new (type.MetadataStorage)
+                         StructMetadata(MetadataKind::Struct, descriptor,
+                                        nullptr));
+
+    initializeRelativePointer(&storage->Records[i].DirectType, metadata[i]);
+    storage->Records[i].Flags = flags.getValue();
+  }
+
+  auto records =
+    reinterpret_cast<const TypeMetadataRecord *>(storage->Records);
+  swift_registerTypeMetadataRecords(records, records + numTypes / 2);
+
+  auto lookup = [&](unsigned i) {
+    auto name = storage->Types[i].Name;
+    return swift_getTypeByMangledName(name, strlen(name));
+  };
+
+  EXPECT_EQ(metadata[0], lookup(0));
+  EXPECT_EQ(nullptr, lookup(numTypes - 1));
+
+  swift_registerTypeMetadataRecords(records + numTypes / 2,
+                                    records + numTypes);
+  EXPECT_EQ(metadata[numTypes - 1], lookup(numTypes - 1));
+
+  for (unsigned i = 1; i < numTypes - 1; i++)
+    EXPECT_EQ(metadata[i], lookup(i));
+}
+
+// If several registered records describe the same conformance, the one that
+// was registered last wins, both within a section and across sections.
+TEST(MetadataTest, conformsToProtocol_DuplicateConformances) {
+  struct TestConformanceRecord {
+    int32_t Protocol;
+    int32_t DirectType;
+    int32_t WitnessTable;
+    uint32_t Flags;
+  };
+  static_assert(sizeof(TestConformanceRecord)
+                  == sizeof(ProtocolConformanceRecord),
+                "test record layout does not match ProtocolConformanceRecord");
+
+  struct TestType {
+    // Stands in for a NominalTypeDescriptor, which is only used as a key.
+    int32_t Descriptor;
+    alignas(StructMetadata) char MetadataStorage[sizeof(StructMetadata)];
+  };
+
+  // Everything lives in one allocation so that the relative references stay
+  // in range. The runtime keeps pointers to registered records, so this is
+  // never freed.
+  struct TestConformances {
+    ProtocolDescriptor Protocol{"DuplicateConformancesProtocol", nullptr,
+                                ProtocolDescriptorFlags()};
+    TestType Types[2];
+    const void *WitnessTables[4][1];
+    TestConformanceRecord Records[4];
+  };
+  auto storage = new TestConformances();
+
+  const Metadata *metadata[2];
+  for (unsigned i = 0; i < 2; i++) {
+    auto &type = storage->Types[i];
+    auto descriptor =
+      reinterpret_cast<const NominalTypeDescriptor *>(&type.Descriptor);
+    metadata[i] = new (type.MetadataStorage)
+                    StructMetadata(MetadataKind::Struct, descriptor, nullptr);
+  }
+
+  auto flags = ProtocolConformanceFlags()
+    .withTypeKind(TypeMetadataRecordKind::UniqueDirectType)
+    .withConformanceKind(ProtocolConformanceReferenceKind::WitnessTable);
+
+  // The first section has two conformances of the first type and one of the
+  // second type; the second section has another one of the second type.
+  const unsigned recordTypes[4] = {0, 0, 1, 1};
+  for (unsigned i = 0; i < 4; i++) {
+    auto &record = storage->Records[i];
+    initializeRelativePointer(&record.Protocol, &storage->Protocol);
+    initializeRelativePointer(&record.DirectType, metadata[recordTypes[i]]);
+    initializeRelativePointer(&record.WitnessTable,
+                              storage->WitnessTables[i]);
+    record.Flags = flags.getValue();
+  }
+
+  auto records =
+    reinterpret_cast<const ProtocolConformanceRecord *>(storage->Records);
+  swift_registerProtocolConformances(records, records + 3);
+  swift_registerProtocolConformances(records + 3, records + 4);
+
+  auto witnessTable = [&](unsigned i) {
+    return reinterpret_cast<const WitnessTable *>(storage->WitnessTables[i]);
+  };
+  EXPECT_EQ(witnessTable(1),
+            swift_conformsToProtocol(metadata[0], &storage->Protocol));
+  EXPECT_EQ(witnessTable(3),
+            swift_conformsToProtocol(metadata[1], &storage->Protocol));
+}
+
+TEST(MetadataTest, conformsToProtocol_DuplicateConformancesConcurrent) {
+  struct TestConformanceRecord {
+    int32_t Protocol;
+    int32_t DirectType;
+    int32_t WitnessTable;
+    uint32_t Flags;
+  };
+  static_assert(sizeof(TestConformanceRecord)
+                  == sizeof(ProtocolConformanceRecord),
+                "test record layout does not match ProtocolConformanceRecord");
+
+  const unsigned numSections = 256;
+
+  // Every section has one conformance of the same type, so each one
+  // registered replaces the previous one.
+  struct TestConformances {
+    ProtocolDescriptor Protocol{"DuplicateConformancesConcurrentProtocol",
+                                nullptr, ProtocolDescriptorFlags()};
+    int32_t Descriptor;
+    alignas(StructMetadata) char MetadataStorage[sizeof(StructMetadata)];
+    const void *WitnessTables[numSections][1];
+    TestConformanceRecord Records[numSections];
+  };
+  auto storage = new TestConformances();
+
+  auto descriptor =
+    reinterpret_cast<const NominalTypeDescriptor *>(&storage->Descriptor);
+  const Metadata *metadata = new (storage->MetadataStorage)
+    StructMetadata(MetadataKind::Struct, descriptor, nullptr);
+
+  auto flags = ProtocolConformanceFlags()
+    .withTypeKind(TypeMetadataRecordKind::UniqueDirectType)
+    .withConformanceKind(ProtocolConformanceReferenceKind::WitnessTable);
+  for (unsigned i = 0; i < numSections; i++) {
+    auto &record = storage->Records[i];
+    initializeRelativePointer(&record.Protocol, &storage->Protocol);
+    initializeRelativePointer(&record.DirectType, metadata);
+    initializeRelativePointer(&record.WitnessTable,
+                              storage->WitnessTables[i]);
+    record.Flags = flags.getValue();
+  }
+
+  auto records =
+    reinterpret_cast<const ProtocolConformanceRecord *>(storage->Records);
+  auto indexOf = [&](const WitnessTable *table) -> long {
+    if (!table)
+      return -1;
+    return reinterpret_cast<const void * const (*)[1]>(table)
+             - storage->WitnessTables;
+  };
+
+  // One thread registers the sections one at a time while the others look
+  // the conformance up. A lookup never goes back to an older conformance,
+  // and once everything is registered every thread finds the last one.
+  std::atomic<unsigned> nextThread(0);
+  std::atomic<bool> registered(false);
+  std::atomic<size_t> failures(0);
+  RaceTest<int*, 16>(
+    [&]() -> int* {
+      if (nextThread.fetch_add(1) == 0) {
+        for (unsigned i = 0; i < numSections; i++)
+          swift_registerProtocolConformances(records + i, records + i + 1);
+        registered.store(true, std::memory_order_release);
+      } else {
+        long lastSeen = -1;
+        while (!registered.load(std::memory_order_acquire)) {
+          long seen = indexOf(
+            swift_conformsToProtocol(metadata, &storage->Protocol));
+          if (seen < lastSeen)
+            failures.fetch_add(1, std::memory_order_relaxed);
+          lastSeen = seen;
+        }
+      }
+
+      long seen = indexOf(
+        swift_conformsToProtocol(metadata, &storage->Protocol));
+      if (seen != long(numSections - 1))
+        failures.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  );
+
+  EXPECT_EQ(0u, failures.load());
+}
@@ -0,0 +1,38 @@
+// RUN: %target-build-swift %s -o %t.out -O
+// RUN: %target-run %t.out
+// REQUIRES: executable_test
+
+import SwiftPrivate
+import StdlibUnittest
+
+
+var PrintFloatRoundTrip = TestSuite("PrintFloatRoundTrip")
+
+// debugDescription must produce a string that parses back as exactly the
+// same value, for every finite bit pattern.
+
+PrintFloatRoundTrip.test("Float") {
+  for _ in 0..<1_000_000 {
+    let value = Float._fromBitPattern(rand32())
+    if value.isNaN || value.isInfinite {
+      continue
+    }
+    let printed = value.debugDescription
+    expectEqual(value._toBitPattern(), Float(printed)!._toBitPattern(),
+      "printed as \(printed)")
+  }
+}
+
+PrintFloatRoundTrip.test("Double") {
+  for _ in 0..<1_000_000 {
+    let value = Double._fromBitPattern(rand64())
+    if value.isNaN || value.isInfinite {
+      continue
+    }
+    let printed = value.debugDescription
+    expectEqual(value._toBitPattern(), Double(printed)!._toBitPattern(),
+      "printed as \(printed)")
+  }
+}
+
+runAllTests()